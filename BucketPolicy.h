@@ -0,0 +1,178 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#endif
+
+// Finalizer that spreads every input bit over the whole word, so that hashes
+// which are weak in their low bits (std::hash<int> is the identity on
+// libstdc++) still index power-of-two tables evenly.
+inline std::size_t hash_mix(std::size_t h)
+{
+    if constexpr (sizeof(std::size_t) >= 8)
+    {
+        h ^= h >> 33;
+        h *= static_cast<std::size_t>(0xff51afd7ed558ccdULL);
+        h ^= h >> 33;
+    }
+    else
+    {
+        h ^= h >> 16;
+        h *= 0x85ebca6bU;
+        h ^= h >> 13;
+    }
+    return h;
+}
+
+// Hashers declaring a member type is_avalanching promise that every input
+// bit already affects every output bit, so the tables use their results as
+// they are; anything else is passed through hash_mix first.
+template<typename Hash, typename = void>
+struct is_avalanching : std::false_type
+{
+};
+
+template<typename Hash>
+struct is_avalanching<Hash, std::void_t<typename Hash::is_avalanching>> : std::true_type
+{
+};
+
+template<typename Hash>
+inline std::size_t hash_finish(std::size_t h)
+{
+    if constexpr (is_avalanching<Hash>::value)
+        return h;
+    else
+        return hash_mix(h);
+}
+
+// Hints that the cache line holding p is about to be read. Never faults, so
+// any address (even nullptr) may be passed.
+inline void prefetch(const void* p)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_prefetch(p, 0, 3);
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    _mm_prefetch(static_cast<const char*>(p), _MM_HINT_T0);
+#else
+    (void)p;
+#endif
+}
+
+inline std::uint64_t mul_high_u64(std::uint64_t a, std::uint64_t b)
+{
+#if defined(__SIZEOF_INT128__)
+    return static_cast<std::uint64_t>((static_cast<unsigned __int128>(a) * b) >> 64);
+#elif defined(_MSC_VER) && defined(_M_X64)
+    return __umulh(a, b);
+#else
+    std::uint64_t a_lo = a & 0xffffffffu, a_hi = a >> 32;
+    std::uint64_t b_lo = b & 0xffffffffu, b_hi = b >> 32;
+    std::uint64_t mid = (a_lo * b_lo >> 32) + (a_hi * b_lo & 0xffffffffu) + a_lo * b_hi;
+    return a_hi * b_hi + (a_hi * b_lo >> 32) + (mid >> 32);
+#endif
+}
+
+// Index of the lowest set bit; word must not be zero.
+inline unsigned lowest_bit_index64(std::uint64_t word)
+{
+#if defined(_MSC_VER) && defined(_M_X64)
+    unsigned long index;
+    _BitScanForward64(&index, word);
+    return static_cast<unsigned>(index);
+#elif defined(_MSC_VER)
+    unsigned long index;
+    if (_BitScanForward(&index, static_cast<unsigned long>(word)))
+        return static_cast<unsigned>(index);
+    _BitScanForward(&index, static_cast<unsigned long>(word >> 32));
+    return static_cast<unsigned>(index) + 32;
+#else
+    return static_cast<unsigned>(__builtin_ctzll(word));
+#endif
+}
+
+// Bucket sizing policies used by HashTable. A policy rounds requested bucket
+// counts to the sizes it supports and maps a hash to a bucket index for the
+// count it was constructed with, so no operation pays for a division. The
+// hashes it gets have been through hash_finish, so every bit is usable.
+
+// Power-of-two counts: the index is the hash masked to the table size.
+class PowerOfTwoBuckets
+{
+public:
+    static std::size_t round_up(std::size_t n);
+
+    explicit PowerOfTwoBuckets(std::size_t count = 1);
+
+    std::size_t index(std::size_t hash) const;
+
+private:
+    std::size_t _mask;
+};
+
+inline std::size_t PowerOfTwoBuckets::round_up(std::size_t n)
+{
+    std::size_t count = 1;
+    while (count < n)
+        count *= 2;
+    return count;
+}
+
+inline PowerOfTwoBuckets::PowerOfTwoBuckets(std::size_t count)
+    : _mask(count - 1)
+{
+}
+
+inline std::size_t PowerOfTwoBuckets::index(std::size_t hash) const
+{
+    return hash & _mask;
+}
+
+// Prime counts from a fixed table: the hash is folded to 32 bits and reduced
+// with Lemire's fastmod, using a multiplier computed once per resize.
+class PrimeBuckets
+{
+public:
+    static std::size_t round_up(std::size_t n);
+
+    explicit PrimeBuckets(std::size_t count = 5);
+
+    std::size_t index(std::size_t hash) const;
+
+private:
+    std::uint64_t _multiplier;
+    std::uint32_t _count;
+};
+
+inline std::size_t PrimeBuckets::round_up(std::size_t n)
+{
+    static constexpr std::uint32_t primes[] = {
+        5u, 11u, 17u, 29u, 37u, 67u, 131u, 257u, 521u, 1031u, 2053u, 4099u, 8209u, 16411u,
+        32771u, 65537u, 131101u, 262147u, 524309u, 1048583u, 2097169u, 4194319u, 8388617u,
+        16777259u, 33554467u, 67108879u, 134217757u, 268435459u, 536870923u, 1073741827u,
+        2147483659u, 4294967291u
+    };
+
+    for (std::uint32_t prime : primes)
+        if (prime >= n)
+            return prime;
+    return primes[sizeof(primes) / sizeof(primes[0]) - 1];
+}
+
+inline PrimeBuckets::PrimeBuckets(std::size_t count)
+    : _multiplier(std::numeric_limits<std::uint64_t>::max() / static_cast<std::uint32_t>(count) + 1)
+    , _count(static_cast<std::uint32_t>(count))
+{
+}
+
+inline std::size_t PrimeBuckets::index(std::size_t hash) const
+{
+    std::uint64_t wide = hash;
+    std::uint32_t folded = static_cast<std::uint32_t>(wide ^ (wide >> 32));
+    return static_cast<std::size_t>(mul_high_u64(_multiplier * folded, _count));
+}
@@ -0,0 +1,241 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+
+#include "HashTable.h"
+
+// Thread-safe set built from independently locked HashTable stripes. A key
+// lives in the stripe picked by its hash, so writers to different stripes
+// never contend and readers only take a shared lock. Each stripe grows on
+// its own under its exclusive lock; reserve() and clear() lock every stripe.
+// There are no iterators: whole-set access goes through for_each(), and
+// per-key access to the stored element through visit().
+template<
+	typename Key,
+	typename Hash = std::hash<Key>,
+	typename KeyEqual = std::equal_to<Key>,
+	typename Allocator = std::allocator<Key>
+>
+class Concurrent_Unordered_Set
+{
+private:
+	using Table = HashTable<Key, EmptyStruct, Hash, KeyEqual, false, PowerOfTwoBuckets, Allocator>;
+
+	struct alignas(64) Stripe
+	{
+		mutable std::shared_mutex _mutex;
+		Table _table;
+	};
+
+	std::unique_ptr<Stripe[]> _stripes;
+	std::size_t _stripe_mask;
+	Hash _hash_fn;
+
+	static std::size_t default_stripe_count();
+
+	Stripe& stripe_for(const Key& key) const;
+
+public:
+	using key_type = Key;
+	using value_type = Key;
+	using hasher = Hash;
+	using key_equal = KeyEqual;
+	using allocator_type = Allocator;
+	using size_type = typename Table::size_type;
+
+	explicit Concurrent_Unordered_Set(size_type stripe_count = default_stripe_count(), size_type bucket_count = 16,
+		const hasher& hash = hasher(), const key_equal& equal = key_equal(), const allocator_type& alloc = allocator_type());
+
+	Concurrent_Unordered_Set(const Concurrent_Unordered_Set&) = delete;
+	Concurrent_Unordered_Set& operator=(const Concurrent_Unordered_Set&) = delete;
+
+	bool insert(const value_type& value);
+	bool insert(value_type&& value);
+
+	template<typename... Args>
+	bool emplace(Args&&... args);
+
+	size_type erase(const key_type& key);
+
+	bool contains(const key_type& key) const;
+	size_type count(const key_type& key) const;
+
+	// Calls f(const Key&) on the stored element under the stripe's shared
+	// lock. Returns whether the key was found.
+	template<typename F>
+	bool visit(const key_type& key, F&& f) const;
+
+	// Calls f(const Key&) on every element, one stripe at a time under that
+	// stripe's shared lock. Concurrent writes to other stripes may or may not
+	// be observed.
+	template<typename F>
+	void for_each(F&& f) const;
+
+	void clear();
+	void reserve(size_type count);
+
+	// Sum of the stripe sizes; only exact while no writer is active.
+	size_type size() const;
+	bool empty() const;
+
+	size_type stripe_count() const noexcept;
+};
+
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator>
+inline std::size_t Concurrent_Unordered_Set<Key, Hash, KeyEqual, Allocator>::default_stripe_count()
+{
+	std::size_t threads = std::thread::hardware_concurrency();
+	return PowerOfTwoBuckets::round_up(threads ? threads * 4 : 16);
+}
+
+// Stripes use bits of the mixed hash above the ones the stripe tables index
+// with, so keys stay evenly spread inside every stripe.
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator>
+inline typename Concurrent_Unordered_Set<Key, Hash, KeyEqual, Allocator>::Stripe&
+		Concurrent_Unordered_Set<Key, Hash, KeyEqual, Allocator>::stripe_for(const Key& key) const
+{
+	std::size_t h = hash_finish<Hash>(_hash_fn(key));
+	return _stripes[(h >> (sizeof(std::size_t) * 4)) & _stripe_mask];
+}
+
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator>
+Concurrent_Unordered_Set<Key, Hash, KeyEqual, Allocator>::Concurrent_Unordered_Set(size_type stripe_count,
+	size_type bucket_count, const hasher& hash, const key_equal& equal, const allocator_type& alloc)
+	: _hash_fn(hash)
+{
+	stripe_count = PowerOfTwoBuckets::round_up(stripe_count ? stripe_count : 1);
+	_stripe_mask = stripe_count - 1;
+	_stripes.reset(new Stripe[stripe_count]);
+
+	// Stripes are written concurrently, so each gets the allocator a copied
+	// container would: a PoolAllocator hands every stripe its own pool.
+	size_type per_stripe = bucket_count / stripe_count;
+	for (size_type i = 0; i < stripe_count; ++i)
+		_stripes[i]._table = Table(per_stripe, hash, equal,
+			std::allocator_traits<Allocator>::select_on_container_copy_construction(alloc));
+}
+
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator>
+inline bool Concurrent_Unordered_Set<Key, Hash, KeyEqual, Allocator>::insert(const value_type& value)
+{
+	Stripe& stripe = stripe_for(value);
+	std::unique_lock<std::shared_mutex> lock(stripe._mutex);
+	return stripe._table.insert(value).second;
+}
+
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator>
+inline bool Concurrent_Unordered_Set<Key, Hash, KeyEqual, Allocator>::insert(value_type&& value)
+{
+	Stripe& stripe = stripe_for(value);
+	std::unique_lock<std::shared_mutex> lock(stripe._mutex);
+	return stripe._table.insert(std::move(value)).second;
+}
+
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator>
+template<typename... Args>
+inline bool Concurrent_Unordered_Set<Key, Hash, KeyEqual, Allocator>::emplace(Args&&... args)
+{
+	return insert(value_type(std::forward<Args>(args)...));
+}
+
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator>
+inline typename Concurrent_Unordered_Set<Key, Hash, KeyEqual, Allocator>::size_type
+		Concurrent_Unordered_Set<Key, Hash, KeyEqual, Allocator>::erase(const key_type& key)
+{
+	Stripe& stripe = stripe_for(key);
+	std::unique_lock<std::shared_mutex> lock(stripe._mutex);
+	return stripe._table.erase(key);
+}
+
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator>
+inline bool Concurrent_Unordered_Set<Key, Hash, KeyEqual, Allocator>::contains(const key_type& key) const
+{
+	return count(key) != 0;
+}
+
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator>
+inline typename Concurrent_Unordered_Set<Key, Hash, KeyEqual, Allocator>::size_type
+		Concurrent_Unordered_Set<Key, Hash, KeyEqual, Allocator>::count(const key_type& key) const
+{
+	const Stripe& stripe = stripe_for(key);
+	std::shared_lock<std::shared_mutex> lock(stripe._mutex);
+	return stripe._table.count(key);
+}
+
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator>
+template<typename F>
+inline bool Concurrent_Unordered_Set<Key, Hash, KeyEqual, Allocator>::visit(const key_type& key, F&& f) const
+{
+	const Stripe& stripe = stripe_for(key);
+	std::shared_lock<std::shared_mutex> lock(stripe._mutex);
+	const Table& table = stripe._table;
+	auto it = table.find(key);
+	if (it == table.end())
+		return false;
+	f(*it);
+	return true;
+}
+
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator>
+template<typename F>
+void Concurrent_Unordered_Set<Key, Hash, KeyEqual, Allocator>::for_each(F&& f) const
+{
+	for (size_type i = 0; i <= _stripe_mask; ++i)
+	{
+		std::shared_lock<std::shared_mutex> lock(_stripes[i]._mutex);
+		const Table& table = _stripes[i]._table;
+		for (const Key& key : table)
+			f(key);
+	}
+}
+
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator>
+void Concurrent_Unordered_Set<Key, Hash, KeyEqual, Allocator>::clear()
+{
+	for (size_type i = 0; i <= _stripe_mask; ++i)
+	{
+		std::unique_lock<std::shared_mutex> lock(_stripes[i]._mutex);
+		_stripes[i]._table.clear();
+	}
+}
+
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator>
+void Concurrent_Unordered_Set<Key, Hash, KeyEqual, Allocator>::reserve(size_type count)
+{
+	size_type per_stripe = count / (_stripe_mask + 1) + 1;
+	for (size_type i = 0; i <= _stripe_mask; ++i)
+	{
+		std::unique_lock<std::shared_mutex> lock(_stripes[i]._mutex);
+		if (_stripes[i]._table.size() < per_stripe)
+			_stripes[i]._table.reserve(per_stripe);
+	}
+}
+
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator>
+typename Concurrent_Unordered_Set<Key, Hash, KeyEqual, Allocator>::size_type
+		Concurrent_Unordered_Set<Key, Hash, KeyEqual, Allocator>::size() const
+{
+	size_type total = 0;
+	for (size_type i = 0; i <= _stripe_mask; ++i)
+	{
+		std::shared_lock<std::shared_mutex> lock(_stripes[i]._mutex);
+		total += _stripes[i]._table.size();
+	}
+	return total;
+}
+
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator>
+inline bool Concurrent_Unordered_Set<Key, Hash, KeyEqual, Allocator>::empty() const
+{
+	return size() == 0;
+}
+
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator>
+inline typename Concurrent_Unordered_Set<Key, Hash, KeyEqual, Allocator>::size_type
+		Concurrent_Unordered_Set<Key, Hash, KeyEqual, Allocator>::stripe_count() const noexcept
+{
+	return _stripe_mask + 1;
+}
@@ -0,0 +1,1200 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "HashTable.h"
+
+// Dense backend for sets: the keys live in one vector in insertion order and
+// the hash index, linear probing over a power-of-two slot array, stores only
+// their positions. Iteration walks the keys contiguously and data() hands
+// them out as an array. erase() moves the last key into the gap, so it
+// reorders and needs a Key whose move assignment does not throw; bulk
+// removals (merge, erase_filtered) keep the order of the keys they leave.
+// Iterators are pointers into the array: an insert may invalidate all of
+// them, an erase the erased and the last one.
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+class DenseHashTable
+{
+    static_assert(std::is_same<T, EmptyStruct>::value, "DenseHashTable only stores set keys");
+
+public:
+    using key_type = Key;
+    using mapped_type = T;
+    using hasher = Hash;
+    using key_equal = KeyEqual;
+    using size_type = std::size_t;
+    using value_type = Key;
+    using allocator_type = Allocator;
+
+private:
+    static constexpr bool CACHE_HASH = cache_hash_code<Key, Hash>::value;
+
+    // Index entry: position + 1 of its key, or 0 while the slot is empty.
+    struct Slot : NodeHashCode<CACHE_HASH>
+    {
+        size_type _pos = 0;
+    };
+
+    using KeyAlloc = typename std::allocator_traits<Allocator>::template rebind_alloc<Key>;
+    using SlotAlloc = typename std::allocator_traits<Allocator>::template rebind_alloc<Slot>;
+    using SizeAlloc = typename std::allocator_traits<Allocator>::template rebind_alloc<size_type>;
+
+    static constexpr size_type MIN_CAPACITY = 8;
+    static constexpr size_type BATCH_SIZE = 32;     // keys hashed and prefetched together by the *_batch operations
+    // Fewest keys worth handing to one more thread.
+    static constexpr size_type PARALLEL_GRAIN = size_type(1) << 14;
+
+    std::vector<Key, KeyAlloc> _keys;
+    // Slot of each key, so the key erase() moves can be repointed.
+    std::vector<size_type, SizeAlloc> _slot_of;
+    std::vector<Slot, SlotAlloc> _slots;
+    size_type _mask = 0;
+    float _max_load = 0.75f;
+    float _min_load = 0.0f;
+    size_type _threads = 1;
+    Hash _hash_fn;
+    KeyEqual _key_eq;
+
+    static size_type capacity_for(size_type n, float max_load);
+
+    size_type npos() const;
+    size_type max_elements() const;
+    size_type worker_count(size_type keys) const;
+    void check_shrink();
+
+    template<typename K>
+    size_type hash_key(const K& key) const;
+    size_type hash_at(size_type pos) const;
+    size_type hash_from(const DenseHashTable& source, size_type pos) const;
+
+    template<typename K>
+    size_type find_slot(const K& key) const;
+    template<typename K>
+    size_type find_slot(const K& key, size_type h) const;
+
+    template<typename... Args>
+    size_type append(size_type h, Args&&... args);
+    template<typename K, typename... Args>
+    std::pair<size_type, bool> insert_hashed(size_type h, const K& key, Args&&... args);
+
+    void unlink_slot(size_type slot);
+    void erase_at(size_type slot);
+    void compact(const std::vector<size_type>& removed);
+
+    void rehash(size_type new_cap);
+
+    template<typename F>
+    void probe_batch(const key_type* keys, size_type count, F&& resolve) const;
+
+    template<typename K, typename R>
+    using if_transparent = std::enable_if_t<is_transparent_lookup<Hash, KeyEqual, K>::value, R>;
+
+public:
+    // Keys are immutable, so both are plain pointers into the key array.
+    using iterator = const Key*;
+    using const_iterator = const Key*;
+
+    // Holds a key taken out by extract(); moving the handle moves the key.
+    class NodeHandle
+    {
+        std::optional<Key> _key;
+
+        friend class DenseHashTable;
+
+    public:
+        using key_type = DenseHashTable::key_type;
+        using value_type = DenseHashTable::value_type;
+
+        NodeHandle() noexcept = default;
+        NodeHandle(NodeHandle&& other);
+        NodeHandle& operator=(NodeHandle&& other);
+
+        bool empty() const noexcept;
+        explicit operator bool() const noexcept;
+
+        key_type& key();
+        value_type& value();
+
+        void reset();
+        void swap(NodeHandle& other);
+    };
+
+    using node_type = NodeHandle;
+
+    struct insert_return_type
+    {
+        iterator position;
+        bool inserted;
+        node_type node;
+    };
+
+    explicit DenseHashTable(size_type capacity = 16, const hasher& hash = Hash(), const key_equal& equal = KeyEqual(),
+        const allocator_type& alloc = allocator_type());
+    // Copies take the index as it is, so they never call Hash or KeyEqual.
+    DenseHashTable(const DenseHashTable& other);
+    DenseHashTable(DenseHashTable&& other) noexcept;
+
+    DenseHashTable& operator=(const DenseHashTable& other);
+    DenseHashTable& operator=(DenseHashTable&& other) noexcept;
+
+    allocator_type get_allocator() const;
+    hasher hash_function() const;
+    key_equal key_eq() const;
+
+    std::pair<iterator, bool> insert(const value_type& value);
+    std::pair<iterator, bool> insert(value_type&& value);
+
+    template<typename... Args>
+    std::pair<iterator, bool> emplace(Args&&... args);
+
+    template<typename K>
+    if_transparent<K, std::pair<iterator, bool>> try_emplace(K&& key);
+
+    // A forward range is counted first, so the keys and the index grow once.
+    template<typename InputIt>
+    void insert_range(InputIt first, InputIt last);
+
+    template<typename OutputIt>
+    OutputIt find_batch(const key_type* keys, size_type count, OutputIt out) const;
+    template<typename OutputIt>
+    OutputIt contains_batch(const key_type* keys, size_type count, OutputIt out) const;
+
+    size_type insert_batch(const value_type* values, size_type count);
+
+    node_type extract(const_iterator pos);
+    node_type extract(const key_type& key);
+
+    // On a duplicate key the element stays in the returned handle.
+    insert_return_type insert(node_type&& node);
+
+    // Moves the keys of source missing here to the end of this table, in
+    // source's order; the duplicates stay in source, still in order.
+    void merge(DenseHashTable& source);
+    void merge(DenseHashTable&& source);
+
+    // Set algebra as in the other backends; with a stateless Hash each
+    // key's hash is reused (cached, or computed once) for both tables.
+    void insert_filtered(const DenseHashTable& source, const DenseHashTable& probe, bool present);
+    void erase_filtered(const DenseHashTable& probe, bool present);
+    bool is_subset_of(const DenseHashTable& other) const;
+
+    size_type erase(const key_type& key);
+    template<typename K>
+    if_transparent<K, size_type> erase(const K& key);
+
+    const_iterator find(const key_type& key) const;
+    template<typename K>
+    if_transparent<K, const_iterator> find(const K& key) const;
+
+    size_type count(const key_type& key) const;
+    template<typename K>
+    if_transparent<K, size_type> count(const K& key) const;
+
+    std::pair<const_iterator, const_iterator> equal_range(const key_type& key) const;
+    template<typename K>
+    if_transparent<K, std::pair<const_iterator, const_iterator>> equal_range(const K& key) const;
+
+    void clear() noexcept;
+    size_type size() const noexcept;
+    bool empty() const noexcept;
+
+    // The keys as one array of size() elements, in iteration order.
+    const key_type* data() const noexcept;
+    const std::vector<Key, KeyAlloc>& values() const noexcept;
+
+    // Buckets are index slots; a key's bucket is its home slot.
+    size_type bucket_count() const;
+    size_type bucket_size(size_type index) const;
+    size_type bucket(const key_type& key) const;
+
+    float load_factor() const;
+    float max_load_factor() const;
+    void max_load_factor(float new_max);
+    float min_load_factor() const;
+    void min_load_factor(float new_min);
+
+    // Also trims the key array to size().
+    void shrink_to_fit();
+    void reserve(size_type n);
+
+    void parallelism(size_type threads);
+    size_type parallelism() const;
+
+    // Contiguous slices of the key array.
+    std::pair<const_iterator, const_iterator> subrange(size_type index, size_type parts) const;
+    size_type scan_parts() const;
+
+    template<typename F>
+    void parallel_for_each(F f) const;
+
+    // Bytes each element takes: its key and its entry in the slot list.
+    static constexpr size_type node_size = sizeof(Key) + sizeof(size_type);
+
+    // Heap bytes the table holds (see MemoryUsage.h); the index counts as
+    // buckets. key_bytes sums what the keys own themselves.
+    MemoryUsage memory_usage() const;
+    template<typename KeyBytes>
+    MemoryUsage memory_usage(KeyBytes key_bytes) const;
+
+    void swap(DenseHashTable& other) noexcept;
+
+    const_iterator begin() const;
+    const_iterator end() const;
+    const_iterator cbegin() const;
+    const_iterator cend() const;
+
+    bool operator==(const DenseHashTable& other) const;
+    bool operator!=(const DenseHashTable& other) const;
+};
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+inline typename DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::size_type
+            DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::capacity_for(size_type n, float max_load)
+{
+    size_type cap = MIN_CAPACITY;
+    while (static_cast<float>(cap) * max_load < static_cast<float>(n))
+        cap *= 2;
+    return cap;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+inline typename DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::size_type DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::npos() const
+{
+    return _slots.size();
+}
+
+// At least one slot always stays empty, which ends every probe.
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+inline typename DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::size_type DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::max_elements() const
+{
+    if (_slots.empty())
+        return 0;
+    size_type limit = static_cast<size_type>(static_cast<float>(_slots.size()) * _max_load);
+    return std::min(limit, _slots.size() - 1);
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+inline typename DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::size_type
+            DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::worker_count(size_type keys) const
+{
+    return std::max<size_type>(1, std::min(_threads, keys / PARALLEL_GRAIN));
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+void DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::check_shrink()
+{
+    float floor = std::min(_min_load, _max_load / 4);
+    if (floor <= 0 || _slots.size() <= MIN_CAPACITY || static_cast<float>(_keys.size()) >= _slots.size() * floor)
+        return;
+    size_type new_cap = capacity_for(_keys.size() * 2, _max_load);
+    if (new_cap < _slots.size())
+        rehash(new_cap);
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+template<typename K>
+inline typename DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::size_type
+            DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::hash_key(const K& key) const
+{
+    return hash_finish<Hash>(_hash_fn(key));
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+inline typename DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::size_type
+            DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::hash_at(size_type pos) const
+{
+    if constexpr (CACHE_HASH)
+        return _slots[_slot_of[pos]]._hash;
+    else
+        return hash_key(_keys[pos]);
+}
+
+// Hash under our Hash of the key at pos in source; a stateless Hash gives
+// every table of this type the same values, so a cached one is taken as is.
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+inline typename DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::size_type
+            DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::hash_from(const DenseHashTable& source, size_type pos) const
+{
+    if constexpr (std::is_empty<Hash>::value)
+        return source.hash_at(pos);
+    else
+        return hash_key(source._keys[pos]);
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+template<typename K>
+inline typename DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::size_type
+            DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::find_slot(const K& key) const
+{
+    return find_slot(key, hash_key(key));
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+template<typename K>
+typename DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::size_type
+            DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::find_slot(const K& key, size_type h) const
+{
+    if (_slots.empty())
+        return npos();
+    for (size_type i = h & _mask; _slots[i]._pos; i = (i + 1) & _mask)
+    {
+        if constexpr (CACHE_HASH)
+        {
+            if (_slots[i]._hash != h)
+                continue;
+        }
+        if (_key_eq(_keys[_slots[i]._pos - 1], key))
+            return i;
+    }
+    return npos();
+}
+
+// Builds the key at the end of the array and indexes it; the index must
+// already have room. Nothing changes if the key's constructor throws.
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+template<typename... Args>
+typename DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::size_type
+            DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::append(size_type h, Args&&... args)
+{
+    size_type slot = h & _mask;
+    while (_slots[slot]._pos)
+        slot = (slot + 1) & _mask;
+    _slot_of.push_back(slot);
+    try
+    {
+        _keys.emplace_back(std::forward<Args>(args)...);
+    }
+    catch (...)
+    {
+        _slot_of.pop_back();
+        throw;
+    }
+    _slots[slot]._pos = _keys.size();
+    if constexpr (CACHE_HASH)
+        _slots[slot]._hash = h;
+    return _keys.size() - 1;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+template<typename K, typename... Args>
+std::pair<typename DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::size_type, bool>
+            DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::insert_hashed(size_type h, const K& key, Args&&... args)
+{
+    size_type slot = find_slot(key, h);
+    if (slot != npos())
+        return { _slots[slot]._pos - 1, false };
+    if (_keys.size() >= max_elements())
+        rehash(std::max(_slots.size() * 2, capacity_for(_keys.size() + 1, _max_load)));
+    return { append(h, std::forward<Args>(args)...), true };
+}
+
+// Backward-shift deletion: each later entry of the probe run whose home is
+// not past the gap moves up into it, so no tombstones are left behind.
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+void DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::unlink_slot(size_type slot)
+{
+    size_type gap = slot;
+    for (size_type i = (slot + 1) & _mask; _slots[i]._pos; i = (i + 1) & _mask)
+    {
+        size_type home = hash_at(_slots[i]._pos - 1) & _mask;
+        if (((i - home) & _mask) >= ((i - gap) & _mask))
+        {
+            _slots[gap] = _slots[i];
+            _slot_of[_slots[gap]._pos - 1] = gap;
+            gap = i;
+        }
+    }
+    _slots[gap] = Slot();
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+void DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::erase_at(size_type slot)
+{
+    size_type pos = _slots[slot]._pos - 1;
+    size_type last = _keys.size() - 1;
+    unlink_slot(slot);
+    if (pos != last)
+    {
+        _keys[pos] = std::move(_keys[last]);
+        size_type moved = _slot_of[last];
+        _slots[moved]._pos = pos + 1;
+        _slot_of[pos] = moved;
+    }
+    _keys.pop_back();
+    _slot_of.pop_back();
+}
+
+// Drops the keys at the ascending positions in removed, already unlinked
+// from the index, and closes up the others in order.
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+void DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::compact(const std::vector<size_type>& removed)
+{
+    if (removed.empty())
+        return;
+    size_type out = removed.front();
+    size_type next = 0;
+    for (size_type pos = out; pos < _keys.size(); ++pos)
+    {
+        if (next < removed.size() && removed[next] == pos)
+        {
+            ++next;
+            continue;
+        }
+        _keys[out] = std::move(_keys[pos]);
+        _slot_of[out] = _slot_of[pos];
+        _slots[_slot_of[out]]._pos = out + 1;
+        ++out;
+    }
+    _keys.erase(_keys.begin() + out, _keys.end());
+    _slot_of.resize(out);
+}
+
+// The new index is built aside, so a throwing Hash leaves the table as it was.
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+void DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::rehash(size_type new_cap)
+{
+    std::vector<Slot, SlotAlloc> slots(new_cap, Slot(), _slots.get_allocator());
+    std::vector<size_type, SizeAlloc> slot_of(_keys.size(), 0, _slot_of.get_allocator());
+    size_type mask = new_cap - 1;
+    for (size_type pos = 0; pos < _keys.size(); ++pos)
+    {
+        size_type h = hash_at(pos);
+        size_type slot = h & mask;
+        while (slots[slot]._pos)
+            slot = (slot + 1) & mask;
+        slots[slot]._pos = pos + 1;
+        if constexpr (CACHE_HASH)
+            slots[slot]._hash = h;
+        slot_of[pos] = slot;
+    }
+    _slots.swap(slots);
+    _slot_of.swap(slot_of);
+    _mask = mask;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+template<typename F>
+void DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::probe_batch(const key_type* keys, size_type count, F&& resolve) const
+{
+    size_type hashes[BATCH_SIZE];
+
+    for (size_type base = 0; base < count; base += BATCH_SIZE)
+    {
+        size_type n = std::min(BATCH_SIZE, count - base);
+        for (size_type i = 0; i < n; ++i)
+        {
+            hashes[i] = hash_key(keys[base + i]);
+            prefetch(_slots.data() + (hashes[i] & _mask));
+        }
+        for (size_type i = 0; i < n; ++i)
+            resolve(find_slot(keys[base + i], hashes[i]));
+    }
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+inline DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::NodeHandle::NodeHandle(NodeHandle&& other)
+    : _key(std::move(other._key))
+{
+    other._key.reset();
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+inline typename DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::NodeHandle&
+            DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::NodeHandle::operator=(NodeHandle&& other)
+{
+    if (this != &other)
+    {
+        _key = std::move(other._key);
+        other._key.reset();
+    }
+    return *this;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+inline bool DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::NodeHandle::empty() const noexcept
+{
+    return !_key;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+inline DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::NodeHandle::operator bool() const noexcept
+{
+    return _key.has_value();
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+inline typename DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::key_type&
+            DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::NodeHandle::key()
+{
+    return *_key;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+inline typename DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::value_type&
+            DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::NodeHandle::value()
+{
+    return *_key;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+inline void DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::NodeHandle::reset()
+{
+    _key.reset();
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+inline void DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::NodeHandle::swap(NodeHandle& other)
+{
+    _key.swap(other._key);
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+inline DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::DenseHashTable(size_type capacity, const hasher& hash, const key_equal& equal,
+            const allocator_type& alloc)
+    : _keys(KeyAlloc(alloc))
+    , _slot_of(SizeAlloc(alloc))
+    , _slots(SlotAlloc(alloc))
+    , _hash_fn(hash)
+    , _key_eq(equal)
+{
+    size_type cap = MIN_CAPACITY;
+    while (cap < capacity)
+        cap *= 2;
+    _slots.assign(cap, Slot());
+    _mask = cap - 1;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+inline DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::DenseHashTable(const DenseHashTable& other)
+    : _keys(other._keys)
+    , _slot_of(other._slot_of)
+    , _slots(other._slots)
+    , _mask(other._mask)
+    , _max_load(other._max_load)
+    , _min_load(other._min_load)
+    , _threads(other._threads)
+    , _hash_fn(other._hash_fn)
+    , _key_eq(other._key_eq)
+{
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+inline DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::DenseHashTable(DenseHashTable&& other) noexcept
+    : _keys(std::move(other._keys))
+    , _slot_of(std::move(other._slot_of))
+    , _slots(std::move(other._slots))
+    , _mask(other._mask)
+    , _max_load(other._max_load)
+    , _min_load(other._min_load)
+    , _threads(other._threads)
+    , _hash_fn(std::move(other._hash_fn))
+    , _key_eq(std::move(other._key_eq))
+{
+    // other keeps its allocator and has no slots; the next insert grows it.
+    other._mask = 0;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+inline DenseHashTable<Key, T, Hash, KeyEqual, Allocator>& DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::operator=(const DenseHashTable& other)
+{
+    if (this != &other)
+    {
+        DenseHashTable copy(other);
+        swap(copy);
+    }
+    return *this;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+inline DenseHashTable<Key, T, Hash, KeyEqual, Allocator>& DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::operator=(DenseHashTable&& other) noexcept
+{
+    if (this != &other)
+        swap(other);
+    return *this;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+inline typename DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::allocator_type
+            DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::get_allocator() const
+{
+    return allocator_type(_keys.get_allocator());
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+inline typename DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::hasher
+            DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::hash_function() const
+{
+    return _hash_fn;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+inline typename DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::key_equal
+            DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::key_eq() const
+{
+    return _key_eq;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+inline std::pair<typename DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::iterator, bool>
+            DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::insert(const value_type& value)
+{
+    auto [pos, inserted] = insert_hashed(hash_key(value), value, value);
+    return { _keys.data() + pos, inserted };
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+inline std::pair<typename DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::iterator, bool>
+            DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::insert(value_type&& value)
+{
+    auto [pos, inserted] = insert_hashed(hash_key(value), value, std::move(value));
+    return { _keys.data() + pos, inserted };
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+template<typename... Args>
+inline std::pair<typename DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::iterator, bool>
+            DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::emplace(Args&&... args)
+{
+    if constexpr (emplace_key_extractable<Key, T, Args...>::value)
+    {
+        const key_type& key = emplace_key<Key>(args...);
+        auto [pos, inserted] = insert_hashed(hash_key(key), key, std::forward<Args>(args)...);
+        return { _keys.data() + pos, inserted };
+    }
+    else
+    {
+        return insert(value_type(std::forward<Args>(args)...));
+    }
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+template<typename K>
+inline typename DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::template if_transparent<K, std::pair<typename DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::iterator, bool>>
+            DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::try_emplace(K&& key)
+{
+    auto [pos, inserted] = insert_hashed(hash_key(key), key, std::forward<K>(key));
+    return { _keys.data() + pos, inserted };
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+template<typename InputIt>
+void DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::insert_range(InputIt first, InputIt last)
+{
+    using category = typename std::iterator_traits<InputIt>::iterator_category;
+    if constexpr (std::is_base_of<std::forward_iterator_tag, category>::value)
+        reserve(_keys.size() + static_cast<size_type>(std::distance(first, last)));
+    for (; first != last; ++first)
+        emplace(*first);
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+template<typename OutputIt>
+OutputIt DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::find_batch(const key_type* keys, size_type count, OutputIt out) const
+{
+    probe_batch(keys, count, [&](size_type slot) {
+        *out++ = slot == npos() ? end() : _keys.data() + _slots[slot]._pos - 1;
+    });
+    return out;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+template<typename OutputIt>
+OutputIt DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::contains_batch(const key_type* keys, size_type count, OutputIt out) const
+{
+    probe_batch(keys, count, [&](size_type slot) {
+        *out++ = slot != npos();
+    });
+    return out;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+typename DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::size_type
+            DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::insert_batch(const value_type* values, size_type count)
+{
+    if (_keys.size() + count > max_elements())
+        reserve(_keys.size() + count);
+
+    size_type hashes[BATCH_SIZE];
+    size_type inserted = 0;
+
+    for (size_type base = 0; base < count; base += BATCH_SIZE)
+    {
+        size_type n = std::min(BATCH_SIZE, count - base);
+        for (size_type i = 0; i < n; ++i)
+        {
+            hashes[i] = hash_key(values[base + i]);
+            prefetch(_slots.data() + (hashes[i] & _mask));
+        }
+        for (size_type i = 0; i < n; ++i)
+            if (insert_hashed(hashes[i], values[base + i], values[base + i]).second)
+                ++inserted;
+    }
+    return inserted;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+typename DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::node_type
+            DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::extract(const_iterator pos)
+{
+    size_type index = static_cast<size_type>(pos - _keys.data());
+    node_type nh;
+    nh._key.emplace(std::move(_keys[index]));
+    erase_at(_slot_of[index]);
+    check_shrink();
+    return nh;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+typename DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::node_type
+            DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::extract(const key_type& key)
+{
+    size_type slot = find_slot(key);
+    if (slot == npos())
+        return node_type();
+    return extract(_keys.data() + _slots[slot]._pos - 1);
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+typename DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::insert_return_type
+            DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::insert(node_type&& nh)
+{
+    if (nh.empty())
+        return { end(), false, node_type() };
+
+    Key& key = *nh._key;
+    auto [pos, inserted] = insert_hashed(hash_key(key), key, std::move(key));
+    if (!inserted)
+        return { _keys.data() + pos, false, std::move(nh) };
+    nh.reset();
+    return { _keys.data() + pos, true, node_type() };
+}
+
+// Keys are moved over in source's order and unlinked from its index as they
+// go, then source closes up what is left in one pass.
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+void DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::merge(DenseHashTable& source)
+{
+    if (&source == this)
+        return;
+
+    std::vector<size_type> taken;
+    for (size_type pos = 0; pos < source._keys.size(); ++pos)
+    {
+        if (find_slot(source._keys[pos], hash_from(source, pos)) == npos())
+            taken.push_back(pos);
+    }
+    reserve(_keys.size() + taken.size());
+
+    for (size_type pos : taken)
+    {
+        append(hash_from(source, pos), std::move(source._keys[pos]));
+        source.unlink_slot(source._slot_of[pos]);
+    }
+    source.compact(taken);
+    source.check_shrink();
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+inline void DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::merge(DenseHashTable&& source)
+{
+    merge(source);
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+void DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::insert_filtered(const DenseHashTable& source, const DenseHashTable& probe, bool present)
+{
+    const DenseHashTable* scan = &source;
+    const DenseHashTable* other = &probe;
+    if (present && probe._keys.size() < source._keys.size())
+        std::swap(scan, other);
+    if (scan == this || (other == this && present))
+        return;
+
+    if (_keys.size() + scan->_keys.size() > max_elements())
+        reserve(_keys.size() + scan->_keys.size());
+
+    for (size_type pos = 0; pos < scan->_keys.size(); ++pos)
+    {
+        const Key& key = scan->_keys[pos];
+        size_type h = hash_from(*scan, pos);
+        size_type probe_hash = std::is_empty<Hash>::value ? h : other->hash_key(key);
+        if ((other->find_slot(key, probe_hash) != other->npos()) != present)
+            continue;
+        insert_hashed(h, key, key);
+    }
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+void DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::erase_filtered(const DenseHashTable& probe, bool present)
+{
+    if (&probe == this)
+    {
+        if (present)
+            clear();
+        return;
+    }
+
+    std::vector<size_type> removed;
+    if (present && probe._keys.size() < _keys.size())
+    {
+        // Taking away a smaller table: look its keys up here instead.
+        for (size_type pos = 0; pos < probe._keys.size(); ++pos)
+        {
+            size_type slot = find_slot(probe._keys[pos], hash_from(probe, pos));
+            if (slot != npos())
+                removed.push_back(_slots[slot]._pos - 1);
+        }
+        std::sort(removed.begin(), removed.end());
+    }
+    else
+    {
+        for (size_type pos = 0; pos < _keys.size(); ++pos)
+        {
+            if ((probe.find_slot(_keys[pos], probe.hash_from(*this, pos)) != probe.npos()) == present)
+                removed.push_back(pos);
+        }
+    }
+
+    for (size_type pos : removed)
+        unlink_slot(_slot_of[pos]);
+    compact(removed);
+    check_shrink();
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+bool DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::is_subset_of(const DenseHashTable& other) const
+{
+    if (_keys.size() > other._keys.size())
+        return false;
+    for (size_type pos = 0; pos < _keys.size(); ++pos)
+    {
+        if (other.find_slot(_keys[pos], other.hash_from(*this, pos)) == other.npos())
+            return false;
+    }
+    return true;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+typename DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::size_type DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::erase(const key_type& key)
+{
+    size_type slot = find_slot(key);
+    if (slot == npos())
+        return 0;
+    erase_at(slot);
+    check_shrink();
+    return 1;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+template<typename K>
+typename DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::template if_transparent<K, typename DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::size_type>
+            DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::erase(const K& key)
+{
+    size_type slot = find_slot(key);
+    if (slot == npos())
+        return 0;
+    erase_at(slot);
+    check_shrink();
+    return 1;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+inline typename DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::const_iterator
+            DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::find(const key_type& key) const
+{
+    size_type slot = find_slot(key);
+    return slot == npos() ? end() : _keys.data() + _slots[slot]._pos - 1;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+template<typename K>
+inline typename DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::template if_transparent<K, typename DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::const_iterator>
+            DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::find(const K& key) const
+{
+    size_type slot = find_slot(key);
+    return slot == npos() ? end() : _keys.data() + _slots[slot]._pos - 1;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+inline typename DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::size_type
+            DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::count(const key_type& key) const
+{
+    return find_slot(key) != npos();
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+template<typename K>
+inline typename DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::template if_transparent<K, typename DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::size_type>
+            DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::count(const K& key) const
+{
+    return find_slot(key) != npos();
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+inline std::pair<typename DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::const_iterator, typename DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::const_iterator>
+            DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::equal_range(const key_type& key) const
+{
+    const_iterator it = find(key);
+    return { it, it == end() ? it : it + 1 };
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+template<typename K>
+inline typename DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::template if_transparent<K, std::pair<typename DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::const_iterator, typename DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::const_iterator>>
+            DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::equal_range(const K& key) const
+{
+    const_iterator it = find(key);
+    return { it, it == end() ? it : it + 1 };
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+void DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::clear() noexcept
+{
+    _keys.clear();
+    _slot_of.clear();
+    std::fill(_slots.begin(), _slots.end(), Slot());
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+inline typename DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::size_type DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::size() const noexcept
+{
+    return _keys.size();
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+inline bool DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::empty() const noexcept
+{
+    return _keys.empty();
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+inline const typename DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::key_type*
+            DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::data() const noexcept
+{
+    return _keys.data();
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+inline const std::vector<Key, typename DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::KeyAlloc>&
+            DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::values() const noexcept
+{
+    return _keys;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+inline typename DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::size_type DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::bucket_count() const
+{
+    return _slots.size();
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+typename DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::size_type
+            DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::bucket_size(size_type index) const
+{
+    size_type count = 0;
+    for (size_type i = index; _slots[i]._pos; i = (i + 1) & _mask)
+    {
+        if ((hash_at(_slots[i]._pos - 1) & _mask) == index)
+            ++count;
+    }
+    return count;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+inline typename DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::size_type DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::bucket(const key_type& key) const
+{
+    return hash_key(key) & _mask;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+inline float DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::load_factor() const
+{
+    return _slots.empty() ? 0.0f : static_cast<float>(_keys.size()) / _slots.size();
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+inline float DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::max_load_factor() const
+{
+    return _max_load;
+}
+
+// Linear probing degrades sharply near a full table, so the limit is capped.
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+void DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::max_load_factor(float new_max)
+{
+    _max_load = std::min(new_max, 0.9375f);
+    if (_keys.size() > max_elements())
+        rehash(capacity_for(_keys.size(), _max_load));
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+inline float DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::min_load_factor() const
+{
+    return _min_load;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+void DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::min_load_factor(float new_min)
+{
+    _min_load = new_min;
+    check_shrink();
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+void DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::shrink_to_fit()
+{
+    size_type new_cap = capacity_for(_keys.size(), _max_load);
+    if (new_cap < _slots.size())
+        rehash(new_cap);
+    _keys.shrink_to_fit();
+    _slot_of.shrink_to_fit();
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+void DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::reserve(size_type n)
+{
+    size_type new_cap = capacity_for(std::max(n, _keys.size()), _max_load);
+    if (new_cap != _slots.size())
+        rehash(new_cap);
+    _keys.reserve(n);
+    _slot_of.reserve(n);
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+inline void DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::parallelism(size_type threads)
+{
+    _threads = threads ? threads : std::max<size_type>(1, std::thread::hardware_concurrency());
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+inline typename DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::size_type
+            DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::parallelism() const
+{
+    return _threads;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+std::pair<typename DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::const_iterator, typename DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::const_iterator>
+            DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::subrange(size_type index, size_type parts) const
+{
+    return { _keys.data() + slice_begin(_keys.size(), parts, index),
+        _keys.data() + slice_begin(_keys.size(), parts, index + 1) };
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+inline typename DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::size_type
+            DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::scan_parts() const
+{
+    return worker_count(_keys.size());
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+template<typename F>
+void DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::parallel_for_each(F f) const
+{
+    size_type parts = scan_parts();
+    run_parallel(parts, [&](size_type i) {
+        auto [first, last] = subrange(i, parts);
+        for (; first != last; ++first)
+            f(*first);
+    });
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+MemoryUsage DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::memory_usage() const
+{
+    MemoryUsage usage;
+    add_allocation(usage, &MemoryUsage::nodes, _keys, _keys.size());
+    add_allocation(usage, &MemoryUsage::nodes, _slot_of, _slot_of.size());
+    add_allocation(usage, &MemoryUsage::buckets, _slots, _slots.size());
+    return usage;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+template<typename KeyBytes>
+MemoryUsage DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::memory_usage(KeyBytes key_bytes) const
+{
+    MemoryUsage usage = memory_usage();
+    for (const Key& key : _keys)
+        usage.key_heap += key_bytes(key);
+    return usage;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+inline void DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::swap(DenseHashTable& other) noexcept
+{
+    std::swap(_keys, other._keys);
+    std::swap(_slot_of, other._slot_of);
+    std::swap(_slots, other._slots);
+    std::swap(_mask, other._mask);
+    std::swap(_max_load, other._max_load);
+    std::swap(_min_load, other._min_load);
+    std::swap(_threads, other._threads);
+    std::swap(_hash_fn, other._hash_fn);
+    std::swap(_key_eq, other._key_eq);
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+inline typename DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::const_iterator DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::begin() const
+{
+    return _keys.data();
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+inline typename DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::const_iterator DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::end() const
+{
+    return _keys.data() + _keys.size();
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+inline typename DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::const_iterator DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::cbegin() const
+{
+    return begin();
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+inline typename DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::const_iterator DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::cend() const
+{
+    return end();
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+inline bool DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::operator==(const DenseHashTable& other) const
+{
+    if (_keys.size() != other._keys.size())
+        return false;
+    for (const Key& key : _keys)
+    {
+        if (other.find_slot(key) == other.npos())
+            return false;
+    }
+    return true;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+inline bool DenseHashTable<Key, T, Hash, KeyEqual, Allocator>::operator!=(const DenseHashTable& other) const
+{
+    return !(*this == other);
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+inline void swap(DenseHashTable<Key, T, Hash, KeyEqual, Allocator>& lhs, DenseHashTable<Key, T, Hash, KeyEqual, Allocator>& rhs) noexcept
+{
+    lhs.swap(rhs);
+}
+
+// Storage tag for Unordered_Set.
+struct DenseStorage
+{
+    template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+    using table = DenseHashTable<Key, T, Hash, KeyEqual, Allocator>;
+};
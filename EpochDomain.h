@@ -0,0 +1,243 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Process-wide epoch-based reclamation. Readers bracket their accesses with
+// an EpochGuard, which only stores to a per-thread slot, so entering and
+// leaving a read section never waits and never shares a written cache line.
+// Writers unlink an object first and then retire() it; it is destroyed once
+// the global epoch has advanced twice, as by then no reader that could still
+// see it is active.
+class EpochDomain
+{
+public:
+    using deleter_type = void (*)(void*);
+
+    static EpochDomain& instance();
+
+    EpochDomain(const EpochDomain&) = delete;
+    EpochDomain& operator=(const EpochDomain&) = delete;
+
+    void enter();
+    void leave();
+
+    // Schedules deleter(p) for when no current reader can hold p.
+    void retire(void* p, deleter_type deleter);
+
+    // Advances the epoch if every active reader has seen the current one and
+    // frees what became safe. Never blocks on readers.
+    void collect();
+
+    // Blocks until everything retired so far has been freed.
+    void synchronize();
+
+    std::size_t pending() const;
+
+private:
+    struct alignas(64) Record
+    {
+        // 0 while quiescent, otherwise (observed epoch << 1) | 1.
+        std::atomic<std::uint64_t> _state{0};
+        std::atomic<bool> _owned{true};
+        std::size_t _depth = 0;
+        Record* _next = nullptr;
+    };
+
+    struct Retired
+    {
+        void* _ptr;
+        deleter_type _deleter;
+        std::uint64_t _epoch;
+    };
+
+    struct ThreadSlot
+    {
+        Record* _record = nullptr;
+        ~ThreadSlot();
+    };
+
+    static constexpr std::size_t COLLECT_THRESHOLD = 64;
+
+    std::atomic<std::uint64_t> _epoch{1};
+    std::atomic<Record*> _records{nullptr};
+    mutable std::mutex _retired_mutex;
+    std::vector<Retired> _retired;
+
+    EpochDomain() = default;
+    ~EpochDomain();
+
+    Record& record();
+    Record* acquire_record();
+    bool try_advance();
+    void free_expired();
+};
+
+// Read-side critical section on the global domain. Guards nest.
+class EpochGuard
+{
+public:
+    EpochGuard();
+    ~EpochGuard();
+
+    EpochGuard(const EpochGuard&) = delete;
+    EpochGuard& operator=(const EpochGuard&) = delete;
+};
+
+inline EpochDomain& EpochDomain::instance()
+{
+    static EpochDomain domain;
+    return domain;
+}
+
+inline EpochDomain::~EpochDomain()
+{
+    for (const Retired& r : _retired)
+        r._deleter(r._ptr);
+
+    Record* rec = _records.load(std::memory_order_acquire);
+    while (rec)
+    {
+        Record* next = rec->_next;
+        delete rec;
+        rec = next;
+    }
+}
+
+inline EpochDomain::ThreadSlot::~ThreadSlot()
+{
+    if (_record)
+    {
+        _record->_state.store(0, std::memory_order_release);
+        _record->_owned.store(false, std::memory_order_release);
+    }
+}
+
+// Records are never unlinked; a thread that exits hands its own back for
+// reuse, so the list is bounded by the peak number of threads.
+inline EpochDomain::Record* EpochDomain::acquire_record()
+{
+    for (Record* rec = _records.load(std::memory_order_acquire); rec; rec = rec->_next)
+    {
+        bool expected = false;
+        if (!rec->_owned.load(std::memory_order_relaxed)
+            && rec->_owned.compare_exchange_strong(expected, true, std::memory_order_acquire))
+            return rec;
+    }
+
+    Record* rec = new Record;
+    Record* head = _records.load(std::memory_order_relaxed);
+    do
+        rec->_next = head;
+    while (!_records.compare_exchange_weak(head, rec, std::memory_order_release, std::memory_order_relaxed));
+    return rec;
+}
+
+inline EpochDomain::Record& EpochDomain::record()
+{
+    thread_local ThreadSlot slot;
+    if (!slot._record)
+        slot._record = acquire_record();
+    return *slot._record;
+}
+
+inline void EpochDomain::enter()
+{
+    Record& rec = record();
+    if (rec._depth++ == 0)
+    {
+        std::uint64_t epoch = _epoch.load(std::memory_order_relaxed);
+        rec._state.store((epoch << 1) | 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+    }
+}
+
+inline void EpochDomain::leave()
+{
+    Record& rec = record();
+    if (--rec._depth == 0)
+        rec._state.store(0, std::memory_order_release);
+}
+
+inline void EpochDomain::retire(void* p, deleter_type deleter)
+{
+    bool full;
+    {
+        std::lock_guard<std::mutex> lock(_retired_mutex);
+        _retired.push_back({p, deleter, _epoch.load(std::memory_order_seq_cst)});
+        full = _retired.size() >= COLLECT_THRESHOLD;
+    }
+    if (full)
+        collect();
+}
+
+inline bool EpochDomain::try_advance()
+{
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    std::uint64_t epoch = _epoch.load(std::memory_order_seq_cst);
+    std::uint64_t current = (epoch << 1) | 1;
+    for (Record* rec = _records.load(std::memory_order_acquire); rec; rec = rec->_next)
+    {
+        std::uint64_t state = rec->_state.load(std::memory_order_seq_cst);
+        if (state != 0 && state != current)
+            return false;
+    }
+    return _epoch.compare_exchange_strong(epoch, epoch + 1, std::memory_order_seq_cst);
+}
+
+inline void EpochDomain::free_expired()
+{
+    std::vector<Retired> expired;
+    {
+        std::lock_guard<std::mutex> lock(_retired_mutex);
+        std::uint64_t epoch = _epoch.load(std::memory_order_seq_cst);
+        auto keep = _retired.begin();
+        for (auto it = _retired.begin(); it != _retired.end(); ++it)
+        {
+            if (it->_epoch + 2 <= epoch)
+                expired.push_back(*it);
+            else
+                *keep++ = *it;
+        }
+        _retired.erase(keep, _retired.end());
+    }
+
+    for (const Retired& r : expired)
+        r._deleter(r._ptr);
+}
+
+inline void EpochDomain::collect()
+{
+    try_advance();
+    free_expired();
+}
+
+inline void EpochDomain::synchronize()
+{
+    std::uint64_t target = _epoch.load(std::memory_order_seq_cst) + 2;
+    while (_epoch.load(std::memory_order_seq_cst) < target)
+        if (!try_advance())
+            std::this_thread::yield();
+    free_expired();
+}
+
+inline std::size_t EpochDomain::pending() const
+{
+    std::lock_guard<std::mutex> lock(_retired_mutex);
+    return _retired.size();
+}
+
+inline EpochGuard::EpochGuard()
+{
+    EpochDomain::instance().enter();
+}
+
+inline EpochGuard::~EpochGuard()
+{
+    EpochDomain::instance().leave();
+}
@@ -0,0 +1,1702 @@
+#pragma once
+
+#include <vector>
+#include <utility>
+#include <functional>
+#include <type_traits>
+#include <iterator>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <algorithm>
+#include <memory>
+#include <tuple>
+
+#include "HashTable.h"
+#include "BucketPolicy.h"
+#include "ProbeGroup.h"
+#include "Parallel.h"
+
+// Open-addressing backend: elements live inline in one contiguous slot array,
+// collisions are resolved by linear probing and erase uses backward-shift
+// deletion, so there are no tombstones and no per-element allocation.
+// Each slot has a control byte (7 bits of its hash, or CTRL_EMPTY) so probes
+// compare a whole ProbeGroup of tags at once and only call KeyEqual on a tag
+// match, plus a distance byte used to backward-shift without re-hashing.
+// The first ProbeGroup::WIDTH control bytes are mirrored past the end so a
+// group can be loaded at any slot without wrapping.
+template<
+    typename Key,
+    typename T = EmptyStruct,
+    typename Hash = std::hash<Key>,
+    typename KeyEqual = std::equal_to<Key>,
+    typename Allocator = std::allocator<std::pair<const Key, T>>
+>
+class FlatHashTable
+{
+public:
+    using key_type = Key;
+    using mapped_type = T;
+    using hasher = Hash;
+    using key_equal = KeyEqual;
+    using size_type = std::size_t;
+    using value_type = table_value_t<Key, T>;
+    using allocator_type = Allocator;
+
+private:
+    static constexpr bool IS_SET = std::is_same<T, EmptyStruct>::value;
+    // Elements that can be moved with memcpy and dropped without a
+    // destructor call, such as integer and pointer keys.
+    static constexpr bool TRIVIAL_VALUES =
+        std::is_trivially_copyable<value_type>::value && std::is_trivially_destructible<value_type>::value;
+
+    struct Slot
+    {
+        alignas(value_type) unsigned char _storage[sizeof(value_type)];
+
+        value_type& value() { return *std::launder(reinterpret_cast<value_type*>(_storage)); }
+        const value_type& value() const { return *std::launder(reinterpret_cast<const value_type*>(_storage)); }
+    };
+
+    static constexpr std::uint8_t SATURATED = 0xFF;    // distance too large to store, recomputed from the hash
+    static constexpr size_type MIN_CAPACITY = 8;
+    static constexpr size_type BATCH_SIZE = 32;     // keys hashed and prefetched together by the *_batch operations
+
+    using SlotAlloc = typename std::allocator_traits<Allocator>::template rebind_alloc<Slot>;
+    using ByteAlloc = typename std::allocator_traits<Allocator>::template rebind_alloc<std::uint8_t>;
+
+    std::vector<Slot, SlotAlloc> _slots;
+    std::vector<ctrl_t, ByteAlloc> _ctrl;
+    std::vector<std::uint8_t, ByteAlloc> _dist;
+    size_type _size = 0;
+    size_type _mask = 0;
+    float _max_load = 0.75f;
+    float _min_load = 0.0f;
+    size_type _threads = 1;
+    Hash _hash_fn;
+    KeyEqual _key_eq;
+
+    const key_type& get_key(const value_type& val) const;
+
+    // Fewest elements worth handing to one more thread.
+    static constexpr size_type PARALLEL_GRAIN = size_type(1) << 14;
+
+    static ctrl_t tag_of(size_type h);
+    static size_type capacity_for(size_type n, float max_load);
+
+    size_type npos() const;
+    void check_shrink();
+    size_type worker_count(size_type elements) const;
+    size_type max_elements() const;
+    template<typename K>
+    size_type hash_key(const K& key) const;
+    size_type home_index(const key_type& key) const;
+    size_type distance_at(size_type index) const;
+    void set_distance(size_type index, size_type dist);
+    void set_ctrl(size_type index, ctrl_t value);
+
+    template<typename K>
+    size_type find_index(const K& key) const;
+    template<typename K>
+    size_type find_index(const K& key, size_type h) const;
+    size_type find_empty(size_type index, size_type& dist) const;
+
+    template<typename K, typename... Args>
+    std::pair<size_type, bool> insert_unique(const K& key, Args&&... args);
+    template<typename K, typename... Args>
+    std::pair<size_type, bool> insert_hashed(size_type h, const K& key, Args&&... args);
+
+    template<typename F>
+    void probe_batch(const key_type* keys, size_type count, F&& resolve) const;
+
+    // Both move the key out of val as well, which is about to be destroyed.
+    static void construct_moved(void* where, value_type& val);
+    std::pair<size_type, bool> insert_moved(value_type& val);
+
+    void place(value_type&& val);
+    void relocate(size_type from, size_type to);
+    void erase_at(size_type index);
+
+    void rehash(size_type new_cap);
+    void reset(size_type cap);
+
+    template<typename K, typename R>
+    using if_transparent = std::enable_if_t<is_transparent_lookup<Hash, KeyEqual, K>::value, R>;
+
+public:
+    template<bool IsConst>
+    class HashIterator
+    {
+        using SlotPtr = std::conditional_t<IsConst, const Slot*, Slot*>;
+
+        const ctrl_t* _ctrl = nullptr;
+        const ctrl_t* _ctrl_end = nullptr;
+        SlotPtr _slot = nullptr;
+
+        void skip_empty();
+
+        friend class FlatHashTable;
+
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = FlatHashTable::value_type;
+        using difference_type = std::ptrdiff_t;
+        using reference = std::conditional_t<IsConst || IS_SET, const value_type&, value_type&>;
+        using pointer = std::conditional_t<IsConst || IS_SET, const value_type*, value_type*>;
+
+        HashIterator() = default;
+        HashIterator(const ctrl_t* ctrl, const ctrl_t* end, SlotPtr slot, bool skip = true);
+
+        reference operator*() const;
+        pointer operator->() const;
+
+        HashIterator& operator++();
+        HashIterator operator++(int);
+
+        bool operator==(const HashIterator& rhs) const;
+        bool operator!=(const HashIterator& rhs) const;
+    };
+
+    using iterator = HashIterator<false>;
+    using const_iterator = HashIterator<true>;
+
+    // Holds an element taken out by extract(). Slots are inline, so the
+    // handle keeps the value itself and moving the handle moves the value;
+    // nothing is allocated on either side.
+    class NodeHandle
+    {
+        Slot _slot;
+        bool _engaged = false;
+
+        void take(value_type& val);
+
+        friend class FlatHashTable;
+
+    public:
+        using key_type = FlatHashTable::key_type;
+        using mapped_type = FlatHashTable::mapped_type;
+        using value_type = FlatHashTable::value_type;
+
+        NodeHandle() noexcept = default;
+        NodeHandle(NodeHandle&& other);
+        NodeHandle& operator=(NodeHandle&& other);
+        ~NodeHandle();
+
+        bool empty() const noexcept;
+        explicit operator bool() const noexcept;
+
+        key_type& key();
+        mapped_type& mapped();
+        value_type& value();
+
+        void reset();
+        void swap(NodeHandle& other);
+    };
+
+    using node_type = NodeHandle;
+
+    struct insert_return_type
+    {
+        iterator position;
+        bool inserted;
+        node_type node;
+    };
+
+    FlatHashTable(size_type capacity = 16, const hasher& hash = Hash(), const key_equal& equal = KeyEqual(),
+        const allocator_type& alloc = allocator_type());
+    FlatHashTable(const FlatHashTable& other);
+    FlatHashTable(FlatHashTable&& other) noexcept;
+    ~FlatHashTable();
+
+    FlatHashTable& operator=(const FlatHashTable& other);
+    FlatHashTable& operator=(FlatHashTable&& other) noexcept;
+
+    allocator_type get_allocator() const;
+    hasher hash_function() const;
+    key_equal key_eq() const;
+
+    std::pair<iterator, bool> insert(const key_type& key, const mapped_type& value);
+    std::pair<iterator, bool> insert(const value_type& kv);
+    std::pair<iterator, bool> insert(value_type&& kv);
+
+    std::pair<iterator, bool> insert_or_assign(const key_type& key, mapped_type&& val);
+
+    template<typename... Args>
+    std::pair<iterator, bool> emplace(Args&&... args);
+
+    template<typename... Args>
+    std::pair<iterator, bool> try_emplace(const Key& key, Args&&... args);
+
+    template<typename K, typename... Args>
+    if_transparent<K, std::pair<iterator, bool>> try_emplace(K&& key, Args&&... args);
+
+    iterator find(const key_type& key);
+    const_iterator find(const key_type& key) const;
+
+    template<typename K>
+    if_transparent<K, iterator> find(const K& key);
+    template<typename K>
+    if_transparent<K, const_iterator> find(const K& key) const;
+
+    size_type erase(const key_type& key);
+
+    template<typename K>
+    if_transparent<K, size_type> erase(const K& key);
+
+    // Batched find/contains/insert: a group of keys is hashed and its first
+    // probe groups prefetched before any is compared, so the misses overlap.
+    // Results go to out in key order.
+    template<typename OutputIt>
+    OutputIt find_batch(const key_type* keys, size_type count, OutputIt out);
+    template<typename OutputIt>
+    OutputIt find_batch(const key_type* keys, size_type count, OutputIt out) const;
+    template<typename OutputIt>
+    OutputIt contains_batch(const key_type* keys, size_type count, OutputIt out) const;
+
+    size_type insert_batch(const value_type* values, size_type count);
+
+    // Bulk load; a forward range is counted first so the slots grow once.
+    template<typename InputIt>
+    void insert_range(InputIt first, InputIt last);
+
+    node_type extract(const_iterator pos);
+    node_type extract(iterator pos);
+    node_type extract(const key_type& key);
+
+    // On a duplicate key the element stays in the returned handle.
+    insert_return_type insert(node_type&& node);
+
+    // Moves every element of source whose key is not present here yet; the
+    // others stay in source.
+    void merge(FlatHashTable& source);
+    void merge(FlatHashTable&& source);
+
+    // Set algebra against tables of the same type; with a stateless Hash
+    // each key is hashed once for both. insert_filtered() adds the elements
+    // of source whose key is in probe (present) or is not, walking the
+    // smaller of the two for an intersection and growing once for the most
+    // it can add; probe may be this table. erase_filtered() drops the
+    // elements whose key is in probe (present) or is not.
+    void insert_filtered(const FlatHashTable& source, const FlatHashTable& probe, bool present);
+    void erase_filtered(const FlatHashTable& probe, bool present);
+    bool is_subset_of(const FlatHashTable& other) const;
+
+    mapped_type& operator[](const Key& key);
+    mapped_type& operator[](Key&& key);
+
+    mapped_type& at(const Key& key);
+    const mapped_type& at(const Key& key) const;
+
+    std::pair<iterator, iterator> equal_range(const Key& key);
+    std::pair<const_iterator, const_iterator> equal_range(const Key& key) const;
+
+    template<typename K>
+    if_transparent<K, std::pair<iterator, iterator>> equal_range(const K& key);
+    template<typename K>
+    if_transparent<K, std::pair<const_iterator, const_iterator>> equal_range(const K& key) const;
+
+    void clear();
+
+    size_type size() const;
+    bool empty() const;
+
+    size_type count(const Key& key) const;
+
+    template<typename K>
+    if_transparent<K, size_type> count(const K& key) const;
+
+    size_type bucket_count() const;
+    size_type bucket_size(size_type index) const;
+    size_type bucket(const Key& key) const;
+
+    float load_factor() const;
+    float max_load_factor() const;
+
+    void max_load_factor(float new_max);
+
+    // Opt-in downsizing: once erases leave the load under min_load_factor()
+    // the table shrinks to half of max_load_factor(), which invalidates
+    // iterators like any rehash. The floor is held to a quarter of the
+    // maximum, so after any resize the size has to double or halve before
+    // the next one. 0, the default, never shrinks.
+    float min_load_factor() const;
+    void min_load_factor(float new_min);
+
+    // Resizes to the fewest slots that hold size() under max_load_factor().
+    void shrink_to_fit();
+
+    void reserve(size_type n);
+
+    // Threads used by scans; 0 picks the hardware concurrency. Resizes stay
+    // serial.
+    void parallelism(size_type threads);
+    size_type parallelism() const;
+
+    // Splitting for parallel scans: subrange(i, parts) for i in [0, parts)
+    // are disjoint and together visit every element once. scan_parts() is
+    // how many pieces parallelism() and size() make worth running at once.
+    std::pair<iterator, iterator> subrange(size_type index, size_type parts);
+    std::pair<const_iterator, const_iterator> subrange(size_type index, size_type parts) const;
+    size_type scan_parts() const;
+
+    // Calls f on every element from up to scan_parts() threads at once; f
+    // must not throw or change the table.
+    template<typename F>
+    void parallel_for_each(F f);
+    template<typename F>
+    void parallel_for_each(F f) const;
+
+    // Bytes of the slot each element lives in; every slot also has a
+    // control and a distance byte.
+    static constexpr size_type node_size = sizeof(Slot);
+
+    // Heap bytes the table holds (see MemoryUsage.h); empty slots count as
+    // slack. key_bytes sums what the keys own themselves.
+    MemoryUsage memory_usage() const;
+    template<typename KeyBytes>
+    MemoryUsage memory_usage(KeyBytes key_bytes) const;
+
+    void swap(FlatHashTable& other) noexcept;
+
+    iterator begin();
+    iterator end();
+    const_iterator begin() const;
+    const_iterator end() const;
+    const_iterator cbegin() const;
+    const_iterator cend() const;
+
+    bool operator==(const FlatHashTable& other) const;
+    bool operator!=(const FlatHashTable& other) const;
+};
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+inline const typename FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::key_type&
+            FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::get_key(const value_type& val) const
+{
+    if constexpr (IS_SET)
+        return val;
+    else
+        return val.first;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+inline ctrl_t FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::tag_of(size_type h)
+{
+    return static_cast<ctrl_t>(h >> (sizeof(size_type) * 8 - 7));
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+inline typename FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::size_type
+            FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::capacity_for(size_type n, float max_load)
+{
+    size_type cap = MIN_CAPACITY;
+    while (static_cast<float>(cap) * max_load < static_cast<float>(n))
+        cap *= 2;
+    return cap;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+inline typename FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::size_type FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::npos() const
+{
+    return _slots.size();
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+inline typename FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::size_type FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::max_elements() const
+{
+    if (_slots.empty())
+        return 0;
+    size_type limit = static_cast<size_type>(static_cast<float>(_slots.size()) * _max_load);
+    return std::min(limit, _slots.size() - 1);
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+template<typename K>
+inline typename FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::size_type
+            FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::hash_key(const K& key) const
+{
+    return hash_finish<Hash>(_hash_fn(key));
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+inline typename FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::size_type
+            FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::home_index(const key_type& key) const
+{
+    return hash_key(key) & _mask;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+inline typename FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::size_type
+            FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::distance_at(size_type index) const
+{
+    if (_dist[index] == SATURATED)
+        return (index - home_index(get_key(_slots[index].value()))) & _mask;
+    return _dist[index];
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+inline void FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::set_distance(size_type index, size_type dist)
+{
+    _dist[index] = dist < SATURATED ? static_cast<std::uint8_t>(dist) : SATURATED;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+inline void FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::set_ctrl(size_type index, ctrl_t value)
+{
+    _ctrl[index] = value;
+    for (size_type mirror = index + _slots.size(); mirror < _ctrl.size(); mirror += _slots.size())
+        _ctrl[mirror] = value;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+template<typename K>
+typename FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::size_type
+            FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::find_index(const K& key) const
+{
+    if (_size == 0)
+        return npos();
+    return find_index(key, hash_key(key));
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+template<typename K>
+typename FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::size_type
+            FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::find_index(const K& key, size_type h) const
+{
+    if (_size == 0)
+        return npos();
+
+    ctrl_t tag = tag_of(h);
+    size_type pos = h & _mask;
+    while (true)
+    {
+        ProbeGroup group(_ctrl.data() + pos);
+        for (std::uint32_t match = group.match(tag); match; match &= match - 1)
+        {
+            size_type index = (pos + lowest_bit_index(match)) & _mask;
+            if (_key_eq(get_key(_slots[index].value()), key))
+                return index;
+        }
+        if (group.match_empty())
+            return npos();
+        pos = (pos + ProbeGroup::WIDTH) & _mask;
+    }
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+typename FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::size_type
+            FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::find_empty(size_type index, size_type& dist) const
+{
+    dist = 0;
+    while (true)
+    {
+        std::uint32_t empty = ProbeGroup(_ctrl.data() + index).match_empty();
+        if (empty)
+        {
+            size_type offset = lowest_bit_index(empty);
+            dist += offset;
+            return (index + offset) & _mask;
+        }
+        dist += ProbeGroup::WIDTH;
+        index = (index + ProbeGroup::WIDTH) & _mask;
+    }
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+template<typename K, typename... Args>
+std::pair<typename FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::size_type, bool>
+            FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::insert_unique(const K& key, Args&&... args)
+{
+    return insert_hashed(hash_key(key), key, std::forward<Args>(args)...);
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+template<typename K, typename... Args>
+std::pair<typename FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::size_type, bool>
+            FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::insert_hashed(size_type h, const K& key, Args&&... args)
+{
+    size_type found = find_index(key, h);
+    if (found != npos())
+        return { found, false };
+
+    if (_size + 1 > max_elements())
+        rehash(_slots.empty() ? MIN_CAPACITY : _slots.size() * 2);
+
+    size_type dist;
+    size_type index = find_empty(h & _mask, dist);
+
+    ::new (static_cast<void*>(_slots[index]._storage)) value_type(std::forward<Args>(args)...);
+    set_ctrl(index, tag_of(h));
+    set_distance(index, dist);
+    ++_size;
+    return { index, true };
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+inline void FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::construct_moved(void* where, value_type& val)
+{
+    if constexpr (TRIVIAL_VALUES)
+        std::memcpy(where, static_cast<const void*>(std::addressof(val)), sizeof(value_type));
+    else if constexpr (IS_SET)
+        ::new (where) value_type(std::move(val));
+    else
+        ::new (where) value_type(std::move(const_cast<key_type&>(val.first)), std::move(val.second));
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+inline std::pair<typename FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::size_type, bool>
+            FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::insert_moved(value_type& val)
+{
+    if constexpr (IS_SET)
+        return insert_unique(val, std::move(val));
+    else
+        return insert_unique(val.first, std::move(const_cast<key_type&>(val.first)), std::move(val.second));
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+void FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::place(value_type&& val)
+{
+    size_type h = hash_key(get_key(val));
+    size_type dist;
+    size_type index = find_empty(h & _mask, dist);
+
+    construct_moved(_slots[index]._storage, val);
+    set_ctrl(index, tag_of(h));
+    set_distance(index, dist);
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+void FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::relocate(size_type from, size_type to)
+{
+    value_type& val = _slots[from].value();
+    construct_moved(_slots[to]._storage, val);
+    val.~value_type();
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+void FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::erase_at(size_type index)
+{
+    _slots[index].value().~value_type();
+    set_ctrl(index, CTRL_EMPTY);
+    --_size;
+
+    size_type hole = index;
+    size_type next = index;
+    while (true)
+    {
+        next = (next + 1) & _mask;
+        if (_ctrl[next] == CTRL_EMPTY)
+            break;
+
+        size_type dist = distance_at(next);
+        size_type gap = (next - hole) & _mask;
+        if (dist >= gap)
+        {
+            relocate(next, hole);
+            set_ctrl(hole, _ctrl[next]);
+            set_distance(hole, dist - gap);
+            set_ctrl(next, CTRL_EMPTY);
+            hole = next;
+        }
+    }
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+void FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::rehash(size_type new_cap)
+{
+    std::vector<Slot, SlotAlloc> old_slots = std::move(_slots);
+    std::vector<ctrl_t, ByteAlloc> old_ctrl = std::move(_ctrl);
+    reset(new_cap);
+
+    for (size_type i = 0; i < old_slots.size(); ++i)
+    {
+        if (old_ctrl[i] == CTRL_EMPTY)
+            continue;
+        value_type& val = old_slots[i].value();
+        place(std::move(val));
+        val.~value_type();
+    }
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+void FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::reset(size_type cap)
+{
+    _slots = std::vector<Slot, SlotAlloc>(cap, _slots.get_allocator());
+    _ctrl.assign(cap + ProbeGroup::WIDTH, CTRL_EMPTY);
+    _dist.assign(cap, 0);
+    _mask = cap - 1;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+template<bool IsConst>
+inline void FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::HashIterator<IsConst>::skip_empty()
+{
+    while (_ctrl != _ctrl_end && *_ctrl == CTRL_EMPTY)
+    {
+        ++_ctrl;
+        ++_slot;
+    }
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+template<bool IsConst>
+inline FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::HashIterator<IsConst>::HashIterator(const ctrl_t* ctrl, const ctrl_t* end, SlotPtr slot, bool skip)
+    : _ctrl(ctrl)
+    , _ctrl_end(end)
+    , _slot(slot)
+{
+    if (skip)
+        skip_empty();
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+template<bool IsConst>
+typename FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::HashIterator<IsConst>::reference
+            FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::HashIterator<IsConst>::operator*() const
+{
+    return _slot->value();
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+template<bool IsConst>
+typename FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::HashIterator<IsConst>::pointer
+            FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::HashIterator<IsConst>::operator->() const
+{
+    return &_slot->value();
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+template<bool IsConst>
+typename FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::HashIterator<IsConst>&
+            FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::HashIterator<IsConst>::operator++()
+{
+    ++_ctrl;
+    ++_slot;
+    skip_empty();
+    return *this;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+template<bool IsConst>
+typename FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::HashIterator<IsConst>
+            FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::HashIterator<IsConst>::operator++(int)
+{
+    HashIterator temp = *this;
+    ++(*this);
+    return temp;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+template<bool IsConst>
+inline bool FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::HashIterator<IsConst>::operator==(const HashIterator& rhs) const
+{
+    return _slot == rhs._slot;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+template<bool IsConst>
+inline bool FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::HashIterator<IsConst>::operator!=(const HashIterator& rhs) const
+{
+    return !(*this == rhs);
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+inline FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::FlatHashTable(size_type capacity, const hasher& hash, const key_equal& equal,
+            const allocator_type& alloc)
+    : _slots(SlotAlloc(alloc))
+    , _ctrl(ByteAlloc(alloc))
+    , _dist(ByteAlloc(alloc))
+    , _hash_fn(hash)
+    , _key_eq(equal)
+{
+    size_type cap = MIN_CAPACITY;
+    while (cap < capacity)
+        cap *= 2;
+    reset(cap);
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+inline FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::FlatHashTable(const FlatHashTable& other)
+    : _slots(other._slots.size(),
+        std::allocator_traits<SlotAlloc>::select_on_container_copy_construction(other._slots.get_allocator()))
+    , _ctrl(other._ctrl)
+    , _dist(other._dist)
+    , _mask(other._mask)
+    , _max_load(other._max_load)
+    , _min_load(other._min_load)
+    , _threads(other._threads)
+    , _hash_fn(other._hash_fn)
+    , _key_eq(other._key_eq)
+{
+    if constexpr (TRIVIAL_VALUES)
+    {
+        // Empty slots are copied too; one pass over the array beats
+        // testing each control byte.
+        std::memcpy(static_cast<void*>(_slots.data()), other._slots.data(), _slots.size() * sizeof(Slot));
+        _size = other._size;
+        return;
+    }
+    for (size_type i = 0; i < other._slots.size(); ++i)
+    {
+        if (other._ctrl[i] == CTRL_EMPTY)
+            continue;
+        ::new (static_cast<void*>(_slots[i]._storage)) value_type(other._slots[i].value());
+        ++_size;
+    }
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+inline FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::FlatHashTable(FlatHashTable&& other) noexcept
+    : _slots(std::move(other._slots))
+    , _ctrl(std::move(other._ctrl))
+    , _dist(std::move(other._dist))
+    , _size(other._size)
+    , _mask(other._mask)
+    , _max_load(other._max_load)
+    , _min_load(other._min_load)
+    , _threads(other._threads)
+    , _hash_fn(std::move(other._hash_fn))
+    , _key_eq(std::move(other._key_eq))
+{
+    // other keeps its allocator and has no slots; the next insert grows it.
+    other._size = 0;
+    other._mask = 0;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+inline FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::~FlatHashTable()
+{
+    if constexpr (!TRIVIAL_VALUES)
+        clear();
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+inline FlatHashTable<Key, T, Hash, KeyEqual, Allocator>& FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::operator=(const FlatHashTable& other)
+{
+    if (this != &other)
+    {
+        FlatHashTable copy(other);
+        swap(copy);
+    }
+    return *this;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+inline FlatHashTable<Key, T, Hash, KeyEqual, Allocator>& FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::operator=(FlatHashTable&& other) noexcept
+{
+    if (this != &other)
+        swap(other);
+    return *this;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+inline typename FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::allocator_type
+            FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::get_allocator() const
+{
+    return allocator_type(_slots.get_allocator());
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+inline typename FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::hasher 
+            FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::hash_function() const
+{
+    return _hash_fn;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+inline typename FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::key_equal 
+            FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::key_eq() const
+{
+    return _key_eq;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+inline std::pair<typename FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::iterator, bool>
+            FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::insert(const key_type& key, const mapped_type& value)
+{
+    auto [index, inserted] = insert_unique(key, key, value);
+    return { iterator(_ctrl.data() + index, _ctrl.data() + _slots.size(), _slots.data() + index, false), inserted };
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+inline std::pair<typename FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::iterator, bool>
+            FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::insert(const value_type& kv)
+{
+    auto [index, inserted] = insert_unique(get_key(kv), kv);
+    return { iterator(_ctrl.data() + index, _ctrl.data() + _slots.size(), _slots.data() + index, false), inserted };
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+inline std::pair<typename FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::iterator, bool>
+            FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::insert(value_type&& kv)
+{
+    auto [index, inserted] = insert_moved(kv);
+    return { iterator(_ctrl.data() + index, _ctrl.data() + _slots.size(), _slots.data() + index, false), inserted };
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+inline std::pair<typename FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::iterator, bool>
+            FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::insert_or_assign(const key_type& key, mapped_type&& val)
+{
+    size_type index = find_index(key);
+    if (index != npos())
+    {
+        _slots[index].value().second = std::move(val);
+        return { iterator(_ctrl.data() + index, _ctrl.data() + _slots.size(), _slots.data() + index, false), false };
+    }
+
+    index = insert_unique(key, key, std::move(val)).first;
+    return { iterator(_ctrl.data() + index, _ctrl.data() + _slots.size(), _slots.data() + index, false), true };
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+template<typename... Args>
+std::pair<typename FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::iterator, bool>
+            FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::emplace(Args&&... args)
+{
+    // With the key among the arguments the element is built straight into
+    // its slot, and only when the key is missing.
+    if constexpr (emplace_key_extractable<Key, T, Args...>::value)
+    {
+        const key_type& key = emplace_key<Key>(args...);
+        auto [index, inserted] = insert_unique(key, std::forward<Args>(args)...);
+        return { iterator(_ctrl.data() + index, _ctrl.data() + _slots.size(), _slots.data() + index, false), inserted };
+    }
+    else
+    {
+        return insert(value_type(std::forward<Args>(args)...));
+    }
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+template<typename... Args>
+inline std::pair<typename FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::iterator, bool>
+            FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::try_emplace(const Key& key, Args&&... args)
+{
+    std::pair<size_type, bool> result;
+    if constexpr (IS_SET)
+        result = insert_unique(key, key, std::forward<Args>(args)...);
+    else
+        result = insert_unique(key, std::piecewise_construct,
+            std::forward_as_tuple(key), std::forward_as_tuple(std::forward<Args>(args)...));
+    size_type index = result.first;
+    return { iterator(_ctrl.data() + index, _ctrl.data() + _slots.size(), _slots.data() + index, false), result.second };
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+template<typename K, typename... Args>
+inline typename FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::template if_transparent<K, std::pair<typename FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::iterator, bool>>
+            FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::try_emplace(K&& key, Args&&... args)
+{
+    std::pair<size_type, bool> result;
+    if constexpr (IS_SET)
+        result = insert_unique(key, std::forward<K>(key), std::forward<Args>(args)...);
+    else
+        result = insert_unique(key, std::piecewise_construct,
+            std::forward_as_tuple(std::forward<K>(key)), std::forward_as_tuple(std::forward<Args>(args)...));
+    size_type index = result.first;
+    return { iterator(_ctrl.data() + index, _ctrl.data() + _slots.size(), _slots.data() + index, false), result.second };
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+typename FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::iterator FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::find(const key_type& key)
+{
+    size_type index = find_index(key);
+    if (index == npos())
+        return end();
+    return iterator(_ctrl.data() + index, _ctrl.data() + _slots.size(), _slots.data() + index, false);
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+typename FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::const_iterator
+            FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::find(const key_type& key) const
+{
+    size_type index = find_index(key);
+    if (index == npos())
+        return end();
+    return const_iterator(_ctrl.data() + index, _ctrl.data() + _slots.size(), _slots.data() + index, false);
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+template<typename K>
+inline typename FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::template if_transparent<K, typename FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::iterator>
+            FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::find(const K& key)
+{
+    size_type index = find_index(key);
+    if (index == npos())
+        return end();
+    return iterator(_ctrl.data() + index, _ctrl.data() + _slots.size(), _slots.data() + index, false);
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+template<typename K>
+inline typename FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::template if_transparent<K, typename FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::const_iterator>
+            FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::find(const K& key) const
+{
+    size_type index = find_index(key);
+    if (index == npos())
+        return end();
+    return const_iterator(_ctrl.data() + index, _ctrl.data() + _slots.size(), _slots.data() + index, false);
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+typename FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::size_type FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::erase(const key_type& key)
+{
+    size_type index = find_index(key);
+    if (index == npos())
+        return 0;
+    erase_at(index);
+    check_shrink();
+    return 1;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+template<typename K>
+inline typename FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::template if_transparent<K, typename FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::size_type>
+            FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::erase(const K& key)
+{
+    size_type index = find_index(key);
+    if (index == npos())
+        return 0;
+    erase_at(index);
+    check_shrink();
+    return 1;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+template<typename F>
+void FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::probe_batch(const key_type* keys, size_type count, F&& resolve) const
+{
+    size_type hashes[BATCH_SIZE];
+
+    for (size_type base = 0; base < count; base += BATCH_SIZE)
+    {
+        size_type n = std::min(BATCH_SIZE, count - base);
+        for (size_type i = 0; i < n; ++i)
+        {
+            hashes[i] = hash_key(keys[base + i]);
+            prefetch(_ctrl.data() + (hashes[i] & _mask));
+            prefetch(_slots.data() + (hashes[i] & _mask));
+        }
+        for (size_type i = 0; i < n; ++i)
+            resolve(find_index(keys[base + i], hashes[i]));
+    }
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+template<typename OutputIt>
+OutputIt FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::find_batch(const key_type* keys, size_type count, OutputIt out)
+{
+    probe_batch(keys, count, [&](size_type index) {
+        *out++ = index == npos() ? end() : iterator(_ctrl.data() + index, _ctrl.data() + _slots.size(), _slots.data() + index, false);
+    });
+    return out;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+template<typename OutputIt>
+OutputIt FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::find_batch(const key_type* keys, size_type count, OutputIt out) const
+{
+    probe_batch(keys, count, [&](size_type index) {
+        *out++ = index == npos() ? end() : const_iterator(_ctrl.data() + index, _ctrl.data() + _slots.size(), _slots.data() + index, false);
+    });
+    return out;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+template<typename OutputIt>
+OutputIt FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::contains_batch(const key_type* keys, size_type count, OutputIt out) const
+{
+    probe_batch(keys, count, [&](size_type index) {
+        *out++ = index != npos();
+    });
+    return out;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+typename FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::size_type
+            FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::insert_batch(const value_type* values, size_type count)
+{
+    if (_size + count > max_elements())
+        reserve(_size + count);
+
+    size_type hashes[BATCH_SIZE];
+    size_type inserted = 0;
+
+    for (size_type base = 0; base < count; base += BATCH_SIZE)
+    {
+        size_type n = std::min(BATCH_SIZE, count - base);
+        for (size_type i = 0; i < n; ++i)
+        {
+            hashes[i] = hash_key(get_key(values[base + i]));
+            prefetch(_ctrl.data() + (hashes[i] & _mask));
+            prefetch(_slots.data() + (hashes[i] & _mask));
+        }
+        for (size_type i = 0; i < n; ++i)
+            if (insert_hashed(hashes[i], get_key(values[base + i]), values[base + i]).second)
+                ++inserted;
+    }
+    return inserted;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+template<typename InputIt>
+void FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::insert_range(InputIt first, InputIt last)
+{
+    using category = typename std::iterator_traits<InputIt>::iterator_category;
+    if constexpr (std::is_base_of<std::forward_iterator_tag, category>::value)
+    {
+        size_type n = static_cast<size_type>(std::distance(first, last));
+        if (_size + n > max_elements())
+            reserve(_size + n);
+    }
+    for (; first != last; ++first)
+        emplace(*first);
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+typename FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::node_type
+            FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::extract(const_iterator pos)
+{
+    size_type index = static_cast<size_type>(pos._slot - _slots.data());
+    value_type& val = _slots[index].value();
+    node_type nh;
+    nh.take(val);
+    erase_at(index);
+    check_shrink();
+    return nh;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+inline typename FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::node_type
+            FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::extract(iterator pos)
+{
+    return extract(const_iterator(pos._ctrl, pos._ctrl_end, pos._slot, false));
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+typename FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::node_type
+            FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::extract(const key_type& key)
+{
+    size_type index = find_index(key);
+    if (index == npos())
+        return node_type();
+    return extract(const_iterator(_ctrl.data() + index, _ctrl.data() + _slots.size(), _slots.data() + index, false));
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+typename FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::insert_return_type
+            FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::insert(node_type&& nh)
+{
+    if (nh.empty())
+        return { end(), false, node_type() };
+
+    auto [index, inserted] = insert_moved(nh.value());
+    if (!inserted)
+        return { iterator(_ctrl.data() + index, _ctrl.data() + _slots.size(), _slots.data() + index, false), false, std::move(nh) };
+
+    nh.reset();
+    return { iterator(_ctrl.data() + index, _ctrl.data() + _slots.size(), _slots.data() + index, false), true, node_type() };
+}
+
+// Backward-shift erase only ever moves elements towards lower slots (or
+// wraps them to the end), so re-checking the current slot after an erase
+// visits every element.
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+void FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::merge(FlatHashTable& source)
+{
+    if (&source == this)
+        return;
+
+    size_type i = 0;
+    while (i < source._slots.size())
+    {
+        if (source._ctrl[i] == CTRL_EMPTY)
+        {
+            ++i;
+            continue;
+        }
+
+        value_type& val = source._slots[i].value();
+        if (insert_moved(val).second)
+            source.erase_at(i);
+        else
+            ++i;
+    }
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+inline void FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::merge(FlatHashTable&& source)
+{
+    merge(source);
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+void FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::insert_filtered(const FlatHashTable& source, const FlatHashTable& probe, bool present)
+{
+    const FlatHashTable* scan = &source;
+    const FlatHashTable* other = &probe;
+    if (present && probe._size < source._size)
+        std::swap(scan, other);
+    if (scan == this || (other == this && present))
+        return;
+
+    if (_size + scan->_size > max_elements())
+        reserve(_size + scan->_size);
+
+    for (size_type i = 0; i < scan->_slots.size(); ++i)
+    {
+        if (scan->_ctrl[i] == CTRL_EMPTY)
+            continue;
+
+        const value_type& val = scan->_slots[i].value();
+        const key_type& key = get_key(val);
+        size_type h = hash_key(key);
+        size_type probe_hash = std::is_empty<Hash>::value ? h : other->hash_key(key);
+        if ((other->find_index(key, probe_hash) != other->npos()) != present)
+            continue;
+        insert_hashed(h, key, val);
+    }
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+void FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::erase_filtered(const FlatHashTable& probe, bool present)
+{
+    if (&probe == this)
+    {
+        if (present)
+            clear();
+        return;
+    }
+
+    // Taking away a smaller table: look its keys up here instead.
+    if (present && probe._size < _size)
+    {
+        for (size_type i = 0; i < probe._slots.size(); ++i)
+        {
+            if (probe._ctrl[i] == CTRL_EMPTY)
+                continue;
+            size_type index = find_index(get_key(probe._slots[i].value()));
+            if (index != npos())
+                erase_at(index);
+        }
+        check_shrink();
+        return;
+    }
+
+    // An erase shifts later elements back into i, so i is checked again.
+    size_type i = 0;
+    while (i < _slots.size())
+    {
+        if (_ctrl[i] != CTRL_EMPTY && (probe.find_index(get_key(_slots[i].value())) != probe.npos()) == present)
+            erase_at(i);
+        else
+            ++i;
+    }
+    check_shrink();
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+bool FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::is_subset_of(const FlatHashTable& other) const
+{
+    if (_size > other._size)
+        return false;
+    for (size_type i = 0; i < _slots.size(); ++i)
+    {
+        if (_ctrl[i] != CTRL_EMPTY && other.find_index(get_key(_slots[i].value())) == other.npos())
+            return false;
+    }
+    return true;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+typename FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::mapped_type& FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::operator[](const Key& key)
+{
+    size_type index = insert_unique(key, std::piecewise_construct,
+        std::forward_as_tuple(key), std::forward_as_tuple()).first;
+    return _slots[index].value().second;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+typename FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::mapped_type& FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::operator[](Key&& key)
+{
+    size_type index = find_index(key);
+    if (index == npos())
+        index = insert_unique(key, std::piecewise_construct,
+            std::forward_as_tuple(std::move(key)), std::forward_as_tuple()).first;
+    return _slots[index].value().second;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+typename FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::mapped_type& FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::at(const Key& key)
+{
+    size_type index = find_index(key);
+    if (index == npos())
+        throw std::out_of_range("FlatHashTable::at - key not found");
+    return _slots[index].value().second;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+const typename FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::mapped_type& FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::at(const Key& key) const
+{
+    size_type index = find_index(key);
+    if (index == npos())
+        throw std::out_of_range("FlatHashTable::at - key not found");
+    return _slots[index].value().second;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+inline std::pair<typename FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::iterator,
+    typename FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::iterator>
+    FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::equal_range(const Key& key)
+{
+    auto first = find(key);
+    if (first == end())
+        return { first, first };
+    auto last = first;
+    return { first, ++last };
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+inline std::pair<typename FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::const_iterator,
+    typename FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::const_iterator>
+    FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::equal_range(const Key& key) const
+{
+    auto first = find(key);
+    if (first == end())
+        return { first, first };
+    auto last = first;
+    return { first, ++last };
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+template<typename K>
+inline typename FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::template if_transparent<K, std::pair<typename FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::iterator,
+    typename FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::iterator>>
+    FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::equal_range(const K& key)
+{
+    auto first = find(key);
+    if (first == end())
+        return { first, first };
+    auto last = first;
+    return { first, ++last };
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+template<typename K>
+inline typename FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::template if_transparent<K, std::pair<typename FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::const_iterator,
+    typename FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::const_iterator>>
+    FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::equal_range(const K& key) const
+{
+    auto first = find(key);
+    if (first == end())
+        return { first, first };
+    auto last = first;
+    return { first, ++last };
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+void FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::clear()
+{
+    if constexpr (TRIVIAL_VALUES)
+    {
+        if (_size > 0)
+            std::fill(_ctrl.begin(), _ctrl.end(), CTRL_EMPTY);
+        _size = 0;
+        return;
+    }
+    for (size_type i = 0; i < _slots.size() && _size > 0; ++i)
+    {
+        if (_ctrl[i] == CTRL_EMPTY)
+            continue;
+        _slots[i].value().~value_type();
+        set_ctrl(i, CTRL_EMPTY);
+        --_size;
+    }
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+typename FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::size_type FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::size() const
+{
+    return _size;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+bool FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::empty() const
+{
+    return _size == 0;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+typename FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::size_type FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::count(const Key& key) const
+{
+    return find_index(key) != npos() ? 1 : 0;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+template<typename K>
+inline typename FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::template if_transparent<K, typename FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::size_type>
+            FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::count(const K& key) const
+{
+    return find_index(key) != npos() ? 1 : 0;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+typename FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::size_type FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::bucket_count() const
+{
+    return _slots.size();
+}
+
+// A key's bucket is its home slot; the elements of bucket i are the ones in
+// the probe run starting at i whose distance points back to i.
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+typename FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::size_type
+            FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::bucket_size(size_type index) const
+{
+    size_type count = 0;
+    size_type pos = index;
+    while (_ctrl[pos] != CTRL_EMPTY)
+    {
+        if (((pos - distance_at(pos)) & _mask) == index)
+            ++count;
+        pos = (pos + 1) & _mask;
+        if (pos == index)
+            break;
+    }
+    return count;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+typename FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::size_type FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::bucket(const Key& key) const
+{
+    return home_index(key);
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+float FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::load_factor() const
+{
+    return _slots.empty() ? 0.0f : static_cast<float>(_size) / _slots.size();
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+float FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::max_load_factor() const
+{
+    return _max_load;
+}
+
+// Linear probing degrades sharply near a full table, so the limit is capped.
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+void FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::max_load_factor(float new_max)
+{
+    _max_load = std::min(new_max, 0.9375f);
+    if (_size > max_elements())
+        rehash(capacity_for(_size, _max_load));
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+inline float FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::min_load_factor() const
+{
+    return _min_load;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+void FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::min_load_factor(float new_min)
+{
+    _min_load = new_min;
+    check_shrink();
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+void FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::check_shrink()
+{
+    float floor = std::min(_min_load, _max_load / 4);
+    if (floor <= 0 || _slots.size() <= MIN_CAPACITY || static_cast<float>(_size) >= _slots.size() * floor)
+        return;
+    size_type new_cap = capacity_for(_size * 2, _max_load);
+    if (new_cap < _slots.size())
+        rehash(new_cap);
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+void FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::shrink_to_fit()
+{
+    size_type new_cap = capacity_for(_size, _max_load);
+    if (new_cap < _slots.size())
+        rehash(new_cap);
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+void FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::reserve(size_type n)
+{
+    size_type new_cap = capacity_for(std::max(n, _size), _max_load);
+    if (new_cap != _slots.size())
+        rehash(new_cap);
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+inline typename FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::size_type 
+            FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::worker_count(size_type elements) const
+{
+    return std::max<size_type>(1, std::min(_threads, elements / PARALLEL_GRAIN));
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+inline void FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::parallelism(size_type threads)
+{
+    _threads = threads ? threads : std::max<size_type>(1, std::thread::hardware_concurrency());
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+inline typename FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::size_type 
+            FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::parallelism() const
+{
+    return _threads;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+typename FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::size_type 
+            FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::scan_parts() const
+{
+    return worker_count(_size);
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+template<typename F>
+void FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::parallel_for_each(F f)
+{
+    size_type parts = scan_parts();
+    run_parallel(parts, [&](size_type i) {
+        auto [first, last] = subrange(i, parts);
+        for (; first != last; ++first)
+            f(*first);
+    });
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+template<typename F>
+void FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::parallel_for_each(F f) const
+{
+    size_type parts = scan_parts();
+    run_parallel(parts, [&](size_type i) {
+        auto [first, last] = subrange(i, parts);
+        for (; first != last; ++first)
+            f(*first);
+    });
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+std::pair<typename FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::iterator, typename FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::iterator> 
+            FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::subrange(size_type index, size_type parts)
+{
+    size_type first = slice_begin(_slots.size(), parts, index);
+    size_type last = slice_begin(_slots.size(), parts, index + 1);
+    return { iterator(_ctrl.data() + first, _ctrl.data() + last, _slots.data() + first),
+        iterator(_ctrl.data() + last, _ctrl.data() + last, _slots.data() + last, false) };
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+std::pair<typename FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::const_iterator, typename FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::const_iterator> 
+            FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::subrange(size_type index, size_type parts) const
+{
+    size_type first = slice_begin(_slots.size(), parts, index);
+    size_type last = slice_begin(_slots.size(), parts, index + 1);
+    return { const_iterator(_ctrl.data() + first, _ctrl.data() + last, _slots.data() + first),
+        const_iterator(_ctrl.data() + last, _ctrl.data() + last, _slots.data() + last, false) };
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+MemoryUsage FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::memory_usage() const
+{
+    MemoryUsage usage;
+    add_allocation(usage, &MemoryUsage::nodes, _slots, _size);
+    add_allocation(usage, &MemoryUsage::buckets, _ctrl, _ctrl.size());
+    add_allocation(usage, &MemoryUsage::buckets, _dist, _dist.size());
+    return usage;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+template<typename KeyBytes>
+MemoryUsage FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::memory_usage(KeyBytes key_bytes) const
+{
+    MemoryUsage usage = memory_usage();
+    for (const value_type& val : *this)
+        usage.key_heap += key_bytes(get_key(val));
+    return usage;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+inline void FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::swap(FlatHashTable& other) noexcept
+{
+    std::swap(_slots, other._slots);
+    std::swap(_ctrl, other._ctrl);
+    std::swap(_dist, other._dist);
+    std::swap(_size, other._size);
+    std::swap(_mask, other._mask);
+    std::swap(_max_load, other._max_load);
+    std::swap(_min_load, other._min_load);
+    std::swap(_threads, other._threads);
+    std::swap(_hash_fn, other._hash_fn);
+    std::swap(_key_eq, other._key_eq);
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+typename FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::iterator FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::begin()
+{
+    return iterator(_ctrl.data(), _ctrl.data() + _slots.size(), _slots.data());
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+typename FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::iterator FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::end()
+{
+    return iterator(_ctrl.data() + _slots.size(), _ctrl.data() + _slots.size(), _slots.data() + _slots.size(), false);
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+typename FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::const_iterator FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::begin() const
+{
+    return const_iterator(_ctrl.data(), _ctrl.data() + _slots.size(), _slots.data());
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+typename FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::const_iterator FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::end() const
+{
+    return const_iterator(_ctrl.data() + _slots.size(), _ctrl.data() + _slots.size(), _slots.data() + _slots.size(), false);
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+typename FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::const_iterator FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::cbegin() const
+{
+    return begin();
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+typename FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::const_iterator FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::cend() const
+{
+    return end();
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+inline bool FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::operator==(const FlatHashTable& other) const
+{
+    if (_size != other._size)
+        return false;
+
+    for (const auto& kv : *this)
+    {
+        auto it = other.find(get_key(kv));
+        if (it == other.end() || !(kv == *it))
+            return false;
+    }
+
+    return true;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+inline bool FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::operator!=(const FlatHashTable& other) const
+{
+    return !(*this == other);
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+inline void FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::NodeHandle::take(value_type& val)
+{
+    construct_moved(_slot._storage, val);
+    _engaged = true;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+inline FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::NodeHandle::NodeHandle(NodeHandle&& other)
+{
+    if (other._engaged)
+    {
+        take(other.value());
+        other.reset();
+    }
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+inline typename FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::NodeHandle&
+            FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::NodeHandle::operator=(NodeHandle&& other)
+{
+    if (this != &other)
+    {
+        reset();
+        if (other._engaged)
+        {
+            take(other.value());
+            other.reset();
+        }
+    }
+    return *this;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+inline FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::NodeHandle::~NodeHandle()
+{
+    reset();
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+inline bool FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::NodeHandle::empty() const noexcept
+{
+    return !_engaged;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+inline FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::NodeHandle::operator bool() const noexcept
+{
+    return _engaged;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+inline typename FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::key_type& FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::NodeHandle::key()
+{
+    if constexpr (IS_SET)
+        return _slot.value();
+    else
+        return const_cast<key_type&>(_slot.value().first);
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+inline typename FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::mapped_type& FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::NodeHandle::mapped()
+{
+    return _slot.value().second;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+inline typename FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::value_type& FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::NodeHandle::value()
+{
+    return _slot.value();
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+inline void FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::NodeHandle::reset()
+{
+    if (_engaged)
+    {
+        _slot.value().~value_type();
+        _engaged = false;
+    }
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+inline void FlatHashTable<Key, T, Hash, KeyEqual, Allocator>::NodeHandle::swap(NodeHandle& other)
+{
+    NodeHandle temp(std::move(other));
+    other = std::move(*this);
+    *this = std::move(temp);
+}
+
+template<typename K, typename M, typename H, typename E, typename A>
+inline void swap(FlatHashTable<K, M, H, E, A>& lhs, FlatHashTable<K, M, H, E, A>& rhs) noexcept
+{
+    lhs.swap(rhs);
+}
+
+struct FlatStorage
+{
+    template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+    using table = FlatHashTable<Key, T, Hash, KeyEqual, Allocator>;
+};
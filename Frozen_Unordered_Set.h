@@ -0,0 +1,554 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <numeric>
+#include <stdexcept>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "Unordered_Set.h"
+
+// Read-only sets placed by a minimal perfect hash (PTHash style): keys are
+// split into buckets of about four by their hash, and every bucket stores a
+// pilot that sends each of its keys to a distinct slot of a key array just
+// as long as the set. A lookup reads one pilot and compares one key; there
+// are no chains, no empty slots and no probing.
+
+enum class FrozenBuild
+{
+	Done,
+	// Two keys compare equal.
+	Duplicate,
+	// Two keys that differ have the same hash, no pilot can part them.
+	Collision,
+	// Some bucket found no pilot, try again with another seed.
+	Retry,
+};
+
+constexpr std::uint64_t frozen_mix(std::uint64_t h)
+{
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdull;
+	h ^= h >> 33;
+	h *= 0xc4ceb9fe1a85ec53ull;
+	h ^= h >> 33;
+	return h;
+}
+
+// Maps h onto [0, n) by its high bits.
+constexpr std::uint64_t frozen_reduce(std::uint64_t h, std::uint64_t n)
+{
+#if defined(__SIZEOF_INT128__)
+	return static_cast<std::uint64_t>((static_cast<unsigned __int128>(h) * n) >> 64);
+#else
+	std::uint64_t h_lo = h & 0xffffffffull, h_hi = h >> 32;
+	std::uint64_t n_lo = n & 0xffffffffull, n_hi = n >> 32;
+	std::uint64_t mid = ((h_lo * n_lo) >> 32) + ((h_hi * n_lo) & 0xffffffffull) + h_lo * n_hi;
+	return h_hi * n_hi + ((h_hi * n_lo) >> 32) + (mid >> 32);
+#endif
+}
+
+constexpr std::uint64_t frozen_key_hash(std::uint64_t raw, std::uint64_t seed)
+{
+	return frozen_mix(raw ^ (seed * 0x9e3779b97f4a7c15ull));
+}
+
+constexpr std::size_t frozen_slot(std::uint64_t hash, std::uint32_t pilot, std::size_t n)
+{
+	return static_cast<std::size_t>(frozen_reduce(frozen_mix(hash ^ ((pilot + 1ull) * 0x9e3779b97f4a7c15ull)), n));
+}
+
+constexpr std::size_t frozen_bucket_count(std::size_t n)
+{
+	return n / 4 + 1;
+}
+
+// Finds a pilot for every bucket of keys[0, n), largest buckets first, and
+// the slot each key lands in. Works in caller-provided arrays so the same
+// code runs at compile time: order[n], bucket_start[buckets + 1], taken[n],
+// slot_of[n] and pilots[buckets].
+template<typename Key, typename KeyEqual>
+constexpr FrozenBuild frozen_build(const Key* keys, const std::uint64_t* hashes, std::size_t n, const KeyEqual& equal,
+	std::size_t* order, std::size_t* bucket_start, bool* taken, std::size_t* slot_of, std::uint32_t* pilots)
+{
+	if (n == 0)
+		return FrozenBuild::Done;
+	std::size_t buckets = frozen_bucket_count(n);
+
+	// Counting sort of the keys by bucket; bucket b ends up as
+	// order[bucket_start[b], bucket_start[b + 1]).
+	for (std::size_t b = 0; b <= buckets; ++b)
+		bucket_start[b] = 0;
+	for (std::size_t i = 0; i < n; ++i)
+		++bucket_start[frozen_reduce(hashes[i], buckets)];
+	std::size_t largest = 0;
+	for (std::size_t b = 0, end = 0; b < buckets; ++b)
+	{
+		largest = bucket_start[b] > largest ? bucket_start[b] : largest;
+		end += bucket_start[b];
+		bucket_start[b] = end;
+	}
+	bucket_start[buckets] = n;
+	for (std::size_t i = n; i-- > 0;)
+		order[--bucket_start[frozen_reduce(hashes[i], buckets)]] = i;
+
+	for (std::size_t i = 0; i < n; ++i)
+		taken[i] = false;
+
+	// The last singletons see one free slot in n, so allow a few times that.
+	std::uint64_t limit = 8ull * n + 1024;
+	for (std::size_t length = largest; length > 0; --length)
+	{
+		for (std::size_t b = 0; b < buckets; ++b)
+		{
+			std::size_t first = bucket_start[b];
+			if (bucket_start[b + 1] - first != length)
+				continue;
+
+			for (std::size_t i = first; i < first + length; ++i)
+			{
+				for (std::size_t j = first; j < i; ++j)
+				{
+					if (hashes[order[i]] == hashes[order[j]])
+						return equal(keys[order[i]], keys[order[j]]) ? FrozenBuild::Duplicate : FrozenBuild::Collision;
+				}
+			}
+
+			std::uint64_t pilot = 0;
+			for (; pilot < limit; ++pilot)
+			{
+				bool fits = true;
+				for (std::size_t i = first; fits && i < first + length; ++i)
+				{
+					std::size_t slot = frozen_slot(hashes[order[i]], static_cast<std::uint32_t>(pilot), n);
+					fits = !taken[slot];
+					for (std::size_t j = first; fits && j < i; ++j)
+						fits = slot_of[order[j]] != slot;
+					slot_of[order[i]] = slot;
+				}
+				if (fits)
+					break;
+			}
+			if (pilot == limit)
+				return FrozenBuild::Retry;
+
+			pilots[b] = static_cast<std::uint32_t>(pilot);
+			for (std::size_t i = first; i < first + length; ++i)
+				taken[slot_of[order[i]]] = true;
+		}
+	}
+	return FrozenBuild::Done;
+}
+
+// Immutable set built once from its keys, e.g. with freeze(). Iterates the
+// key array, so in no particular order. A key whose Hash value another key
+// already has cannot get a slot of its own; such keys follow the placed
+// ones, sorted by hash, and are searched there when the placed key differs.
+template<
+	typename Key,
+	typename Hash = std::hash<Key>,
+	typename KeyEqual = std::equal_to<Key>
+>
+class Frozen_Unordered_Set
+{
+private:
+	// In slot order, then the keys of shared hashes, whose hashes are in
+	// _tail_hashes.
+	std::vector<Key> _keys;
+	std::vector<std::uint64_t> _tail_hashes;
+	std::vector<std::uint32_t> _pilots;
+	std::uint64_t _seed = 0;
+	Hash _hash_fn;
+	KeyEqual _key_eq;
+
+	void build();
+	void split_shared_hashes(std::vector<std::uint64_t>& raw);
+
+public:
+	using key_type = Key;
+	using value_type = Key;
+	using hasher = Hash;
+	using key_equal = KeyEqual;
+	using size_type = std::size_t;
+	using const_iterator = typename std::vector<Key>::const_iterator;
+	using iterator = const_iterator;
+
+	Frozen_Unordered_Set() = default;
+
+	template<typename InputIt>
+	Frozen_Unordered_Set(InputIt first, InputIt last, const hasher& hash = hasher(), const key_equal& equal = key_equal());
+
+	Frozen_Unordered_Set(std::initializer_list<Key> ilist, const hasher& hash = hasher(), const key_equal& equal = key_equal());
+
+	const_iterator find(const key_type& key) const;
+	bool contains(const key_type& key) const;
+	size_type count(const key_type& key) const;
+
+	size_type size() const noexcept;
+	bool empty() const noexcept;
+
+	const_iterator begin() const noexcept;
+	const_iterator end() const noexcept;
+
+	hasher hash_function() const;
+	key_equal key_eq() const;
+
+	void swap(Frozen_Unordered_Set& other) noexcept;
+};
+
+template<typename Key, typename Hash, typename KeyEqual>
+template<typename InputIt>
+Frozen_Unordered_Set<Key, Hash, KeyEqual>::Frozen_Unordered_Set(InputIt first, InputIt last, const hasher& hash, const key_equal& equal)
+	: _keys(first, last)
+	, _hash_fn(hash)
+	, _key_eq(equal)
+{
+	build();
+}
+
+template<typename Key, typename Hash, typename KeyEqual>
+Frozen_Unordered_Set<Key, Hash, KeyEqual>::Frozen_Unordered_Set(std::initializer_list<Key> ilist, const hasher& hash, const key_equal& equal)
+	: _keys(ilist)
+	, _hash_fn(hash)
+	, _key_eq(equal)
+{
+	build();
+}
+
+template<typename Key, typename Hash, typename KeyEqual>
+void Frozen_Unordered_Set<Key, Hash, KeyEqual>::build()
+{
+	std::vector<std::uint64_t> raw(_keys.size());
+	for (std::size_t i = 0; i < _keys.size(); ++i)
+		raw[i] = _hash_fn(_keys[i]);
+	split_shared_hashes(raw);
+
+	// The placed keys now have distinct hashes, so Retry is the only way
+	// the build can fail.
+	std::size_t n = raw.size();
+	std::vector<std::uint64_t> hashes(n);
+	std::vector<std::size_t> order(n), bucket_start(frozen_bucket_count(n) + 1), slot_of(n);
+	std::unique_ptr<bool[]> taken(new bool[n]);
+	_pilots.assign(frozen_bucket_count(n), 0);
+
+	for (std::uint64_t seed = 0;; ++seed)
+	{
+		for (std::size_t i = 0; i < n; ++i)
+			hashes[i] = frozen_key_hash(raw[i], seed);
+
+		FrozenBuild result = frozen_build(_keys.data(), hashes.data(), n, _key_eq,
+			order.data(), bucket_start.data(), taken.get(), slot_of.data(), _pilots.data());
+		if (result == FrozenBuild::Retry)
+			continue;
+
+		// Move every key into its slot by following the permutation's cycles.
+		for (std::size_t i = 0; i < n; ++i)
+		{
+			while (slot_of[i] != i)
+			{
+				std::size_t target = slot_of[i];
+				std::swap(_keys[i], _keys[target]);
+				std::swap(slot_of[i], slot_of[target]);
+			}
+		}
+		_seed = seed;
+		return;
+	}
+}
+
+// Keeps the first key of every hash in front, in its order, and leaves raw
+// holding their hashes. Further keys of a hash are dropped if they equal
+// one before them and otherwise go to the tail, which is sorted by hash.
+template<typename Key, typename Hash, typename KeyEqual>
+void Frozen_Unordered_Set<Key, Hash, KeyEqual>::split_shared_hashes(std::vector<std::uint64_t>& raw)
+{
+	std::size_t n = _keys.size();
+	std::vector<std::size_t> by_hash(n);
+	std::iota(by_hash.begin(), by_hash.end(), std::size_t(0));
+	std::stable_sort(by_hash.begin(), by_hash.end(), [&](std::size_t a, std::size_t b) { return raw[a] < raw[b]; });
+
+	enum Place : unsigned char { Front, Tail, Drop };
+	std::vector<Place> place(n, Front);
+	std::size_t tail = 0, dropped = 0;
+	for (std::size_t first = 0, end; first < n; first = end)
+	{
+		for (end = first + 1; end < n && raw[by_hash[end]] == raw[by_hash[first]]; ++end)
+		{
+			std::size_t key = by_hash[end];
+			place[key] = Tail;
+			for (std::size_t i = first; i < end && place[key] == Tail; ++i)
+				if (place[by_hash[i]] != Drop && _key_eq(_keys[by_hash[i]], _keys[key]))
+					place[key] = Drop;
+			tail += place[key] == Tail;
+			dropped += place[key] == Drop;
+		}
+	}
+	if (tail == 0 && dropped == 0)
+		return;
+
+	std::vector<Key> keys;
+	std::vector<std::uint64_t> front_hashes;
+	keys.reserve(n);
+	for (std::size_t i = 0; i < n; ++i)
+		if (place[i] == Front)
+		{
+			keys.push_back(std::move(_keys[i]));
+			front_hashes.push_back(raw[i]);
+		}
+	_tail_hashes.clear();
+	_tail_hashes.reserve(tail);
+	for (std::size_t i : by_hash)
+		if (place[i] == Tail)
+		{
+			keys.push_back(std::move(_keys[i]));
+			_tail_hashes.push_back(raw[i]);
+		}
+	_keys.swap(keys);
+	raw.swap(front_hashes);
+}
+
+template<typename Key, typename Hash, typename KeyEqual>
+inline typename Frozen_Unordered_Set<Key, Hash, KeyEqual>::const_iterator Frozen_Unordered_Set<Key, Hash, KeyEqual>::find(const key_type& key) const
+{
+	if (_keys.empty())
+		return _keys.end();
+	std::uint64_t raw = _hash_fn(key);
+	std::uint64_t hash = frozen_key_hash(raw, _seed);
+	std::size_t placed = _keys.size() - _tail_hashes.size();
+	std::size_t slot = frozen_slot(hash, _pilots[frozen_reduce(hash, _pilots.size())], placed);
+	if (_key_eq(_keys[slot], key))
+		return _keys.begin() + slot;
+	if (_tail_hashes.empty())
+		return _keys.end();
+
+	auto range = std::equal_range(_tail_hashes.begin(), _tail_hashes.end(), raw);
+	for (auto it = range.first; it != range.second; ++it)
+	{
+		std::size_t index = placed + static_cast<std::size_t>(it - _tail_hashes.begin());
+		if (_key_eq(_keys[index], key))
+			return _keys.begin() + index;
+	}
+	return _keys.end();
+}
+
+template<typename Key, typename Hash, typename KeyEqual>
+inline bool Frozen_Unordered_Set<Key, Hash, KeyEqual>::contains(const key_type& key) const
+{
+	return find(key) != end();
+}
+
+template<typename Key, typename Hash, typename KeyEqual>
+inline typename Frozen_Unordered_Set<Key, Hash, KeyEqual>::size_type Frozen_Unordered_Set<Key, Hash, KeyEqual>::count(const key_type& key) const
+{
+	return contains(key) ? 1 : 0;
+}
+
+template<typename Key, typename Hash, typename KeyEqual>
+inline typename Frozen_Unordered_Set<Key, Hash, KeyEqual>::size_type Frozen_Unordered_Set<Key, Hash, KeyEqual>::size() const noexcept
+{
+	return _keys.size();
+}
+
+template<typename Key, typename Hash, typename KeyEqual>
+inline bool Frozen_Unordered_Set<Key, Hash, KeyEqual>::empty() const noexcept
+{
+	return _keys.empty();
+}
+
+template<typename Key, typename Hash, typename KeyEqual>
+inline typename Frozen_Unordered_Set<Key, Hash, KeyEqual>::const_iterator Frozen_Unordered_Set<Key, Hash, KeyEqual>::begin() const noexcept
+{
+	return _keys.begin();
+}
+
+template<typename Key, typename Hash, typename KeyEqual>
+inline typename Frozen_Unordered_Set<Key, Hash, KeyEqual>::const_iterator Frozen_Unordered_Set<Key, Hash, KeyEqual>::end() const noexcept
+{
+	return _keys.end();
+}
+
+template<typename Key, typename Hash, typename KeyEqual>
+inline typename Frozen_Unordered_Set<Key, Hash, KeyEqual>::hasher Frozen_Unordered_Set<Key, Hash, KeyEqual>::hash_function() const
+{
+	return _hash_fn;
+}
+
+template<typename Key, typename Hash, typename KeyEqual>
+inline typename Frozen_Unordered_Set<Key, Hash, KeyEqual>::key_equal Frozen_Unordered_Set<Key, Hash, KeyEqual>::key_eq() const
+{
+	return _key_eq;
+}
+
+template<typename Key, typename Hash, typename KeyEqual>
+void Frozen_Unordered_Set<Key, Hash, KeyEqual>::swap(Frozen_Unordered_Set& other) noexcept
+{
+	_keys.swap(other._keys);
+	_tail_hashes.swap(other._tail_hashes);
+	_pilots.swap(other._pilots);
+	std::swap(_seed, other._seed);
+	std::swap(_hash_fn, other._hash_fn);
+	std::swap(_key_eq, other._key_eq);
+}
+
+// Read-only copy of set for lookup-heavy use once it stops changing.
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator, typename Storage>
+Frozen_Unordered_Set<Key, Hash, KeyEqual> freeze(const Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>& set)
+{
+	return Frozen_Unordered_Set<Key, Hash, KeyEqual>(set.begin(), set.end(), set.hash_function(), set.key_eq());
+}
+
+// Hashes usable in constant expressions, for Static_Frozen_Set: integers as
+// is (frozen_mix does the mixing) and FNV-1a over string_view.
+template<typename Key, typename = void>
+struct frozen_hash;
+
+template<typename Key>
+struct frozen_hash<Key, std::enable_if_t<std::is_integral<Key>::value || std::is_enum<Key>::value>>
+{
+	constexpr std::uint64_t operator()(Key key) const
+	{
+		return static_cast<std::uint64_t>(key);
+	}
+};
+
+template<>
+struct frozen_hash<std::string_view>
+{
+	constexpr std::uint64_t operator()(std::string_view key) const
+	{
+		std::uint64_t h = 0xcbf29ce484222325ull;
+		for (char c : key)
+		{
+			h ^= static_cast<unsigned char>(c);
+			h *= 0x100000001b3ull;
+		}
+		return h;
+	}
+};
+
+// Frozen set of N keys known at compile time, built inside a constant
+// expression:
+//   constexpr auto fruits = make_frozen_set<std::string_view>({ "apple", "banana", "cherry" });
+//   static_assert(fruits.contains("banana"));
+// A duplicate key fails the build. Lookups take anything Hash and KeyEqual
+// accept, so a std::string finds its string_view.
+template<
+	typename Key,
+	std::size_t N,
+	typename Hash = frozen_hash<Key>,
+	typename KeyEqual = std::equal_to<>
+>
+class Static_Frozen_Set
+{
+private:
+	std::array<Key, N> _keys{};
+	std::array<std::uint32_t, frozen_bucket_count(N)> _pilots{};
+	std::uint64_t _seed = 0;
+	Hash _hash_fn{};
+	KeyEqual _key_eq{};
+
+public:
+	using key_type = Key;
+	using value_type = Key;
+	using size_type = std::size_t;
+	using const_iterator = typename std::array<Key, N>::const_iterator;
+	using iterator = const_iterator;
+
+	constexpr explicit Static_Frozen_Set(const Key (&keys)[N]);
+
+	template<typename K>
+	constexpr bool contains(const K& key) const;
+	template<typename K>
+	constexpr size_type count(const K& key) const;
+
+	constexpr size_type size() const noexcept;
+	constexpr bool empty() const noexcept;
+
+	constexpr const_iterator begin() const noexcept;
+	constexpr const_iterator end() const noexcept;
+};
+
+template<typename Key, std::size_t N, typename Hash, typename KeyEqual>
+constexpr Static_Frozen_Set<Key, N, Hash, KeyEqual>::Static_Frozen_Set(const Key (&keys)[N])
+{
+	std::array<std::uint64_t, N> hashes{};
+	std::array<std::size_t, N> order{};
+	std::array<std::size_t, frozen_bucket_count(N) + 1> bucket_start{};
+	std::array<bool, N> taken{};
+	std::array<std::size_t, N> slot_of{};
+	for (std::uint64_t seed = 0;; ++seed)
+	{
+		for (std::size_t i = 0; i < N; ++i)
+			hashes[i] = frozen_key_hash(_hash_fn(keys[i]), seed);
+		FrozenBuild result = frozen_build(keys, hashes.data(), N, _key_eq,
+			order.data(), bucket_start.data(), taken.data(), slot_of.data(), _pilots.data());
+		if (result == FrozenBuild::Duplicate)
+			throw std::invalid_argument("Static_Frozen_Set: duplicate key");
+		if (result == FrozenBuild::Collision)
+			throw std::invalid_argument("Static_Frozen_Set: distinct keys with equal hashes");
+		if (result == FrozenBuild::Done)
+		{
+			_seed = seed;
+			break;
+		}
+	}
+	for (std::size_t i = 0; i < N; ++i)
+		_keys[slot_of[i]] = keys[i];
+}
+
+template<typename Key, std::size_t N, typename Hash, typename KeyEqual>
+template<typename K>
+constexpr bool Static_Frozen_Set<Key, N, Hash, KeyEqual>::contains(const K& key) const
+{
+	if (N == 0)
+		return false;
+	std::uint64_t hash = frozen_key_hash(_hash_fn(key), _seed);
+	std::size_t slot = frozen_slot(hash, _pilots[frozen_reduce(hash, _pilots.size())], N);
+	return _key_eq(_keys[slot], key);
+}
+
+template<typename Key, std::size_t N, typename Hash, typename KeyEqual>
+template<typename K>
+constexpr typename Static_Frozen_Set<Key, N, Hash, KeyEqual>::size_type Static_Frozen_Set<Key, N, Hash, KeyEqual>::count(const K& key) const
+{
+	return contains(key) ? 1 : 0;
+}
+
+template<typename Key, std::size_t N, typename Hash, typename KeyEqual>
+constexpr typename Static_Frozen_Set<Key, N, Hash, KeyEqual>::size_type Static_Frozen_Set<Key, N, Hash, KeyEqual>::size() const noexcept
+{
+	return N;
+}
+
+template<typename Key, std::size_t N, typename Hash, typename KeyEqual>
+constexpr bool Static_Frozen_Set<Key, N, Hash, KeyEqual>::empty() const noexcept
+{
+	return N == 0;
+}
+
+template<typename Key, std::size_t N, typename Hash, typename KeyEqual>
+constexpr typename Static_Frozen_Set<Key, N, Hash, KeyEqual>::const_iterator Static_Frozen_Set<Key, N, Hash, KeyEqual>::begin() const noexcept
+{
+	return _keys.begin();
+}
+
+template<typename Key, std::size_t N, typename Hash, typename KeyEqual>
+constexpr typename Static_Frozen_Set<Key, N, Hash, KeyEqual>::const_iterator Static_Frozen_Set<Key, N, Hash, KeyEqual>::end() const noexcept
+{
+	return _keys.end();
+}
+
+template<typename Key, std::size_t N>
+constexpr Static_Frozen_Set<Key, N> make_frozen_set(const Key (&keys)[N])
+{
+	return Static_Frozen_Set<Key, N>(keys);
+}
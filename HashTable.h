@@ -6,7 +6,20 @@
 #include <type_traits>
 #include <iterator>
 #include <cstddef>
+#include <cstdint>
 #include <stdexcept>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <optional>
+#include <tuple>
+
+#include "BucketPolicy.h"
+#include "Parallel.h"
+#include "PoolAllocator.h"
+#include "TableStats.h"
+#include "MemoryUsage.h"
 
 struct EmptyStruct
 {
@@ -22,15 +35,89 @@ inline bool operator!=(const EmptyStruct&, const EmptyStruct&)
     return false; 
 }
 
+// Whether HashTable nodes store the full hash of their key, so rehash never
+// calls Hash again and chain walks reject most mismatches before KeyEqual.
+// Only std::hash over scalar keys is cheap enough to recompute; specialize
+// this for other trivial hashers to save the extra word per node.
+template<typename Key, typename Hash>
+struct cache_hash_code
+    : std::bool_constant<!(std::is_scalar<Key>::value && std::is_same<Hash, std::hash<Key>>::value)>
+{
+};
+
+// Whether Hash and KeyEqual both declare is_transparent, so lookups may take
+// any K they accept instead of building a key_type. K only makes the check
+// depend on the caller's template argument.
+template<typename Hash, typename KeyEqual, typename K, typename = void>
+struct is_transparent_lookup : std::false_type
+{
+};
+
+template<typename Hash, typename KeyEqual, typename K>
+struct is_transparent_lookup<Hash, KeyEqual, K,
+        std::void_t<typename Hash::is_transparent, typename KeyEqual::is_transparent>>
+    : std::true_type
+{
+};
+
+// Element type of the tables: a set (T = EmptyStruct) stores the bare key,
+// with no pair and no padding for the empty mapped value.
+template<typename Key, typename T>
+using table_value_t = std::conditional_t<std::is_same<T, EmptyStruct>::value, Key, std::pair<const Key, T>>;
+
+// Whether emplace(args...) can read the key straight out of its arguments,
+// so a duplicate is rejected before anything is constructed: a lone key (in
+// a set) or pair, or a key followed by the mapped value.
+template<typename Key, typename T, typename... Args>
+struct emplace_key_extractable : std::false_type
+{
+};
+
+template<typename Key, typename T, typename A>
+struct emplace_key_extractable<Key, T, A>
+    : std::bool_constant<std::is_same<T, EmptyStruct>::value
+        ? std::is_same<std::decay_t<A>, Key>::value
+        : std::is_same<std::decay_t<A>, std::pair<const Key, T>>::value || std::is_same<std::decay_t<A>, std::pair<Key, T>>::value>
+{
+};
+
+template<typename Key, typename T, typename A, typename B>
+struct emplace_key_extractable<Key, T, A, B>
+    : std::bool_constant<!std::is_same<T, EmptyStruct>::value && std::is_same<std::decay_t<A>, Key>::value>
+{
+};
+
+template<typename Key, typename A, typename... Rest>
+inline const Key& emplace_key(const A& first, const Rest&...)
+{
+    if constexpr (std::is_same<std::decay_t<A>, Key>::value)
+        return first;
+    else
+        return first.first;
+}
+
+template<bool Cached>
+struct NodeHashCode
+{
+};
+
+template<>
+struct NodeHashCode<true>
+{
+    std::size_t _hash = 0;
+};
+
 
 template<
     typename Key, 
     typename T = EmptyStruct, 
     typename Hash = std::hash<Key>, 
     typename KeyEqual = std::equal_to<Key>, 
-    bool AllowDuplicates = false
+    bool AllowDuplicates = false,
+    typename BucketPolicy = PowerOfTwoBuckets,
+    typename Allocator = std::allocator<std::pair<const Key, T>>
 >
-class HashTable
+class HashTable : private TableCounters<HASHTABLE_STATS_ENABLED>
 {
 public:
     using key_type = Key;
@@ -38,32 +125,22 @@ public:
     using hasher = Hash;
     using key_equal = KeyEqual;
     using size_type = std::size_t;
-    using value_type = std::pair<const Key, T>;
+    using value_type = table_value_t<Key, T>;
+    using allocator_type = Allocator;
 
 private:
-    struct Node 
+    static constexpr bool IS_SET = std::is_same<T, EmptyStruct>::value;
+    static constexpr bool CACHE_HASH = cache_hash_code<Key, Hash>::value;
+
+    struct Node : NodeHashCode<CACHE_HASH>
     {
         Node* _next;
         value_type _data;
 
-        template<typename K, typename V>
-        Node(K&& key, V&& value, Node* next = nullptr)
-            : _next(next)
-            , _data(std::piecewise_construct,
-                std::forward_as_tuple(std::forward<K>(key)),
-                std::forward_as_tuple(std::forward<V>(value)))
-        {
-        }
-
-        explicit Node(const value_type& val, Node* next = nullptr)
-            : _next(next)
-            , _data(val)
-        {
-        }
-
-        explicit Node(value_type&& val, Node* next = nullptr)
-            : _next(next)
-            , _data(std::move(val))
+        template<typename... Args>
+        explicit Node(Args&&... args)
+            : _next(nullptr)
+            , _data(std::forward<Args>(args)...)
         {
         }
 
@@ -71,20 +148,100 @@ private:
     };
 
     using Bucket = Node*;
-
-    std::vector<Bucket> _buckets;
+    using NodeAlloc = typename std::allocator_traits<Allocator>::template rebind_alloc<Node>;
+    using NodeTraits = std::allocator_traits<NodeAlloc>;
+    using BucketAlloc = typename std::allocator_traits<Allocator>::template rebind_alloc<Bucket>;
+    using WordAlloc = typename std::allocator_traits<Allocator>::template rebind_alloc<std::uint64_t>;
+
+    NodeAlloc _node_alloc;
+    std::vector<Bucket, BucketAlloc> _buckets;
+    BucketPolicy _policy;
+    // Incremental rehash: the previous array and its policy stay alive while
+    // buckets before _migrate_pos (and any bucket emptied early) have moved.
+    std::vector<Bucket, BucketAlloc> _old_buckets;
+    BucketPolicy _old_policy;
+    size_type _migrate_pos = 0;
+    // One bit per bucket of _buckets, set while its chain is non-empty, so
+    // iteration jumps between populated buckets a word at a time. Every word
+    // before _first_word is zero, which keeps begin() cheap once the front of
+    // the table has emptied. Buckets of _old_buckets are not tracked.
+    std::vector<std::uint64_t, WordAlloc> _occupied;
+    size_type _first_word = 0;
+    bool _incremental = false;
+    size_type _threads = 1;
     size_type _size = 0;
     float _max_load = 0.75f;
+    float _min_load = 0.0f;
+    // Protection mode (chain_limit()); a non-zero salt is mixed into every
+    // hash, so the cached ones are only comparable between equal salts.
+    size_type _chain_limit = 0;
+    size_type _salt = 0;
     Hash _hash_fn;
     KeyEqual _key_eq;
 
     const key_type& get_key(const value_type& val) const;
 
-    void check_load();
+    static constexpr size_type REHASH_STEP = 8;
+    // Keys hashed and prefetched together by the *_batch operations; enough
+    // to keep a core's outstanding misses busy without spilling the arrays.
+    static constexpr size_type BATCH_SIZE = 32;
+    // Fewest nodes worth handing to one more thread.
+    static constexpr size_type PARALLEL_GRAIN = size_type(1) << 14;
+
+    bool check_load();
+    void check_shrink();
 
     void rehash(size_type new_cap);
 
-    Node* find_node(const key_type& key, size_type index) const;
+    bool chain_overflows(const Bucket& head, size_type hash) const;
+    void guard_chains();
+    void reseed();
+
+    size_type worker_count(size_type nodes) const;
+    template<bool Unique, typename Feed>
+    Node* parallel_link(std::vector<Bucket, BucketAlloc>& buckets, const BucketPolicy& policy,
+        size_type threads, Feed&& feed, size_type& linked);
+    bool destroy_values_parallel();
+
+    bool migrating() const;
+    void start_migration(size_type new_cap);
+    void migrate_bucket(size_type old_index);
+    void migrate_step();
+    void finish_migration();
+    void drop_old_buckets();
+    size_type insert_index(size_type hash);
+
+    void reset_occupancy();
+    void rebuild_occupancy();
+    void mark_occupied(size_type index);
+    void sync_occupied(const Bucket& head);
+
+    Bucket& chain_for(size_type hash);
+    const Bucket& chain_for(size_type hash) const;
+
+    template<typename K>
+    size_type hash_key(const K& key) const;
+    size_type hash_of(const Node* node) const;
+    size_type hash_from(const HashTable& source, const Node* node) const;
+    bool holds(const HashTable& source, const Node* node) const;
+    template<typename K>
+    bool matches(const Node* node, size_type hash, const K& key) const;
+
+    template<typename K>
+    Node* find_node(const K& key, size_type hash, const Bucket& head) const;
+
+    template<typename... Args>
+    Node* create_node(Args&&... args);
+    Node* create_moved_node(value_type& val);
+    void destroy_node(Node* node);
+    void reserve_nodes(size_type n);
+    bool pool_holds_only_nodes() const;
+
+    template<typename U, typename A>
+    static void fill_index(std::vector<U, A>& index, size_type n, U value);
+
+    template<typename MakeNode>
+    void clone_chains(const HashTable& other, MakeNode&& make);
 
     size_type bucket_index(const Key& key) const;
 
@@ -95,19 +252,30 @@ public:
         using NodePtr = std::conditional_t<IsConst, const Node*, Node*>;
         using BucketPtr = std::conditional_t<IsConst, const Bucket*, Bucket*>;
 
-        BucketPtr _bucket;
-        BucketPtr _bucket_end;
-        NodePtr _node;
+        BucketPtr _bucket = nullptr;
+        BucketPtr _bucket_end = nullptr;
+        // Buckets of the old array still to visit while a rehash is in progress.
+        BucketPtr _spill = nullptr;
+        BucketPtr _spill_end = nullptr;
+        NodePtr _node = nullptr;
+        // Occupancy of the array _bucket walks, or null to test each bucket.
+        BucketPtr _base = nullptr;
+        const std::uint64_t* _bits = nullptr;
 
         void skip_empty();
 
+        friend class HashTable;
+
     public:
         using iterator_category = std::forward_iterator_tag;
         using value_type = HashTable::value_type;
-        using reference = std::conditional_t<IsConst, const value_type&, value_type&>;
-        using pointer = std::conditional_t<IsConst, const value_type*, value_type*>;
+        using reference = std::conditional_t<IsConst || IS_SET, const value_type&, value_type&>;
+        using pointer = std::conditional_t<IsConst || IS_SET, const value_type*, value_type*>;
 
-        HashIterator(BucketPtr bucket, BucketPtr end, NodePtr node = nullptr);
+        HashIterator() = default;
+        HashIterator(BucketPtr bucket, BucketPtr end, NodePtr node = nullptr,
+            BucketPtr spill = nullptr, BucketPtr spill_end = nullptr,
+            BucketPtr base = nullptr, const std::uint64_t* bits = nullptr);
         ~HashIterator();
 
         reference operator*() const;
@@ -123,7 +291,86 @@ public:
     using iterator = HashIterator<false>;
     using const_iterator = HashIterator<true>;
 
-    HashTable(size_type capacity = 16, const hasher& = Hash(), const key_equal& equal = KeyEqual());
+    // Owns a node unlinked by extract() until it is inserted into a table or
+    // destroyed with the handle. Moving it around never touches the element.
+    class NodeHandle
+    {
+        Node* _node = nullptr;
+        std::optional<NodeAlloc> _alloc;
+
+        NodeHandle(Node* node, const NodeAlloc& alloc);
+        Node* release();
+        void reset();
+
+        friend class HashTable;
+
+    public:
+        using key_type = HashTable::key_type;
+        using mapped_type = HashTable::mapped_type;
+        using value_type = HashTable::value_type;
+        using allocator_type = HashTable::allocator_type;
+
+        NodeHandle() noexcept = default;
+        NodeHandle(NodeHandle&& other) noexcept;
+        NodeHandle& operator=(NodeHandle&& other) noexcept;
+        ~NodeHandle();
+
+        bool empty() const noexcept;
+        explicit operator bool() const noexcept;
+
+        key_type& key() const;
+        mapped_type& mapped() const;
+        value_type& value() const;
+
+        allocator_type get_allocator() const;
+
+        void swap(NodeHandle& other) noexcept;
+    };
+
+    using node_type = NodeHandle;
+
+    struct insert_return_type
+    {
+        iterator position;
+        bool inserted;
+        node_type node;
+    };
+
+private:
+    iterator insert_node(Node* node, size_type hash, size_type index);
+    void unlink(Node* node);
+
+    template<typename... Args>
+    std::pair<iterator, bool> emplace_unique(const key_type& key, Args&&... args);
+
+    iterator iterator_at(Bucket& head, Node* node);
+    const_iterator iterator_at(const Bucket& head, const Node* node) const;
+
+    template<typename K>
+    iterator find_key(const K& key);
+    template<typename K>
+    const_iterator find_key(const K& key) const;
+    template<typename K>
+    size_type count_key(const K& key) const;
+    template<typename K>
+    size_type erase_key(const K& key);
+    template<typename K>
+    size_type erase_hashed(const K& key, size_type hash);
+    template<typename K, typename... Args>
+    std::pair<iterator, bool> try_emplace_key(K&& key, Args&&... args);
+
+    template<typename F>
+    void probe_batch(const key_type* keys, size_type count, F&& resolve) const;
+
+    template<typename K, typename R>
+    using if_transparent = std::enable_if_t<is_transparent_lookup<Hash, KeyEqual, K>::value, R>;
+
+public:
+    HashTable(size_type capacity = 16, const hasher& = Hash(), const key_equal& equal = KeyEqual(),
+        const allocator_type& alloc = allocator_type());
+    // Copies keep other's bucket count and chain order, so they only call Hash
+    // to place nodes of an unfinished incremental rehash and never KeyEqual.
+    // Assignment refills the nodes this table already has before allocating.
     HashTable(const HashTable& other);
     HashTable(HashTable&& other) noexcept;
     ~HashTable();
@@ -131,6 +378,10 @@ public:
     HashTable& operator=(const HashTable& other);
     HashTable& operator=(HashTable&& other);
 
+    allocator_type get_allocator() const;
+    hasher hash_function() const;
+    key_equal key_eq() const;
+
     std::pair<iterator, bool> insert(const key_type& key, const mapped_type& value);
     std::pair<iterator, bool> insert(const value_type& kv);
     std::pair<iterator, bool> insert(value_type&& kv);
@@ -143,17 +394,70 @@ public:
     template<typename... Args>
     std::pair<iterator, bool> try_emplace(const Key& key, Args&&... args);
 
-    template<typename U = T>
-    std::enable_if_t<std::is_same<U, EmptyStruct>::value, std::pair<iterator, bool>> insert(const Key& key);
-
-    template<typename U = T>
-    std::enable_if_t<std::is_same<U, EmptyStruct>::value, std::pair<iterator, bool>> emplace(const Key& key);
+    // Heterogeneous key: a Key is built from it only when it is missing.
+    template<typename K, typename... Args>
+    if_transparent<K, std::pair<iterator, bool>> try_emplace(K&& key, Args&&... args);
 
     iterator find(const key_type& key);
     const_iterator find(const key_type& key) const;
 
+    template<typename K>
+    if_transparent<K, iterator> find(const K& key);
+    template<typename K>
+    if_transparent<K, const_iterator> find(const K& key) const;
+
     size_type erase(const key_type& key);
 
+    template<typename K>
+    if_transparent<K, size_type> erase(const K& key);
+
+    // Batched forms of find/contains/insert. Each group of keys is hashed
+    // and has its buckets, then its first nodes, prefetched before any chain
+    // is walked, so the cache misses of a whole group overlap instead of
+    // being taken one after another. Results are written to out in key
+    // order; the returned iterator is one past the last one written.
+    template<typename OutputIt>
+    OutputIt find_batch(const key_type* keys, size_type count, OutputIt out);
+    template<typename OutputIt>
+    OutputIt find_batch(const key_type* keys, size_type count, OutputIt out) const;
+    template<typename OutputIt>
+    OutputIt contains_batch(const key_type* keys, size_type count, OutputIt out) const;
+
+    // Returns how many of the values were inserted.
+    size_type insert_batch(const value_type* values, size_type count);
+
+    // Bulk load. A forward range is counted first, so the buckets are sized
+    // once and, with an allocator that supports it, the nodes are carved
+    // from one block; elements are then linked straight into their chains
+    // with no per-element load check. Input ranges are inserted one by one.
+    template<typename InputIt>
+    void insert_range(InputIt first, InputIt last);
+
+    // Unlinks the element without moving or destroying it.
+    node_type extract(const_iterator pos);
+    node_type extract(iterator pos);
+    node_type extract(const key_type& key);
+
+    // Relinks the handle's node; on a duplicate key it stays in the returned
+    // handle. A node from an unequal allocator is moved into a new one.
+    insert_return_type insert(node_type&& node);
+
+    // Relinks every node of source whose key is not present here yet; the
+    // others stay in source.
+    void merge(HashTable& source);
+    void merge(HashTable&& source);
+
+    // Set algebra against tables of the same type. Each node's hash is
+    // reused (cached, or computed once) when Hash is stateless.
+    // insert_filtered() adds the elements of source whose key is in probe
+    // (present) or is not; for an intersection the smaller of the two is
+    // walked, and the table grows once for the most it can add. probe may
+    // be this table. erase_filtered() drops the elements whose key is in
+    // probe (present) or is not.
+    void insert_filtered(const HashTable& source, const HashTable& probe, bool present);
+    void erase_filtered(const HashTable& probe, bool present);
+    bool is_subset_of(const HashTable& other) const;
+
     mapped_type& operator[](const Key& key);
     mapped_type& operator[](Key&& key);
 
@@ -163,6 +467,11 @@ public:
     std::pair<iterator, iterator> equal_range(const Key& key);
     std::pair<const_iterator, const_iterator> equal_range(const Key& key) const;
 
+    template<typename K>
+    if_transparent<K, std::pair<iterator, iterator>> equal_range(const K& key);
+    template<typename K>
+    if_transparent<K, std::pair<const_iterator, const_iterator>> equal_range(const K& key) const;
+
     void clear();
 
     size_type size() const;
@@ -170,6 +479,9 @@ public:
 
     size_type count(const Key& key) const;
 
+    template<typename K>
+    if_transparent<K, size_type> count(const K& key) const;
+
     size_type bucket_count() const;
     size_type bucket_size(size_type index) const;
     size_type bucket(const Key& key) const;
@@ -179,8 +491,75 @@ public:
 
     void max_load_factor(float new_max);
 
+    // Opt-in downsizing: once erases leave the load under min_load_factor()
+    // the table shrinks to half of max_load_factor(), which invalidates
+    // iterators like any rehash. The floor is held to a quarter of the
+    // maximum, so after any resize the size has to double or halve before
+    // the next one. 0, the default, never shrinks.
+    float min_load_factor() const;
+    void min_load_factor(float new_min);
+
+    // Resizes to the fewest buckets that hold size() under max_load_factor().
+    void shrink_to_fit();
+
     void reserve(size_type n);
 
+    // Spreads each resize over the following inserts and erases instead of
+    // moving every node at once. While a rehash is in progress lookups check
+    // the one array holding the key, iteration covers both arrays,
+    // bucket_count()/bucket() describe the new one, and any insert or erase
+    // may invalidate iterators. Disabling finishes the pending rehash.
+    void incremental_rehash(bool enable);
+    bool incremental_rehash() const;
+    bool rehash_in_progress() const;
+
+    // Threads that rehashes, insert_range() and clear() may use once the
+    // table is large; 1, the default, keeps them on the calling thread and 0
+    // picks the hardware concurrency. Hash and KeyEqual are then called from
+    // several threads at once, while nodes are still allocated and freed on
+    // the calling one.
+    void parallelism(size_type threads);
+    size_type parallelism() const;
+
+    // Splitting for parallel scans: subrange(i, parts) for i in [0, parts)
+    // are disjoint and together visit every element once. scan_parts() is
+    // how many pieces parallelism() and size() make worth running at once.
+    std::pair<iterator, iterator> subrange(size_type index, size_type parts);
+    std::pair<const_iterator, const_iterator> subrange(size_type index, size_type parts) const;
+    size_type scan_parts() const;
+
+    // Calls f on every element from up to scan_parts() threads at once; f
+    // must not throw or change the table.
+    template<typename F>
+    void parallel_for_each(F f);
+    template<typename F>
+    void parallel_for_each(F f) const;
+
+    // Protection against collision floods. An insert into a bucket already
+    // holding more than limit nodes of other hashes makes the table mix a
+    // fresh random salt into every hash and relink all nodes, which
+    // invalidates iterators and counts in stats().reseeds; setting the limit
+    // checks the chains at once. Keys whose Hash results are equal still
+    // share a chain, so untrusted keys also want a seeded hasher (see
+    // Hashers.h). 0, the default, turns the check off.
+    void chain_limit(size_type limit);
+    size_type chain_limit() const;
+
+    // Counters gathered under HASHTABLE_STATS plus a chain-length histogram,
+    // which walks every bucket.
+    HashTableStats stats() const;
+    void reset_stats();
+
+    // Bytes of the node each element is allocated in.
+    static constexpr size_type node_size = sizeof(Node);
+
+    // Heap bytes the table holds (see MemoryUsage.h). With key_bytes, a
+    // callable taking a key, it also sums what the keys own themselves,
+    // e.g. StringHeapBytes for strings.
+    MemoryUsage memory_usage() const;
+    template<typename KeyBytes>
+    MemoryUsage memory_usage(KeyBytes key_bytes) const;
+
     void swap(HashTable& other) noexcept;
 
     iterator begin();
@@ -193,378 +572,1297 @@ public:
     bool operator==(const HashTable& other) const;
     bool operator!=(const HashTable& other) const;
 
-    template<typename K, typename M, typename H, typename E, bool D>
-    friend void swap(HashTable<K, M, H, E, D>& lhs, HashTable<K, M, H, E, D>& rhs)  noexcept;
+    template<typename K, typename M, typename H, typename E, bool D, typename P, typename A>
+    friend void swap(HashTable<K, M, H, E, D, P, A>& lhs, HashTable<K, M, H, E, D, P, A>& rhs)  noexcept;
 };
 
-template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates>
-inline const typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates>::key_type& 
-            HashTable<Key, T, Hash, KeyEqual, AllowDuplicates>::get_key(const value_type& val) const
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+inline const typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::key_type& 
+            HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::get_key(const value_type& val) const
+{
+    if constexpr (IS_SET)
+        return val;
+    else
+        return val.first;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+inline bool HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::check_load()
 {
-    return val.first;
+    if (static_cast<float>(_size) / _buckets.size() <= _max_load)
+        return false;
+    if (_incremental)
+        start_migration(BucketPolicy::round_up(_buckets.size() * 2));
+    else
+        rehash(BucketPolicy::round_up(_buckets.size() * 2));
+    return true;
 }
 
-template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates>
-inline void HashTable<Key, T, Hash, KeyEqual, AllowDuplicates>::check_load()
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+void HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::check_shrink()
 {
-    if (static_cast<float>(_size) / _buckets.size() > _max_load)
-        rehash(_buckets.size() * 2);
+    float floor = std::min(_min_load, _max_load / 4);
+    if (floor <= 0 || migrating() || static_cast<float>(_size) >= _buckets.size() * floor)
+        return;
+    size_type needed = static_cast<size_type>(std::ceil(_size * 2 / _max_load));
+    size_type new_cap = BucketPolicy::round_up(std::max<size_type>(needed, 8));
+    if (new_cap >= _buckets.size())
+        return;
+    if (_incremental)
+        start_migration(new_cap);
+    else
+        rehash(new_cap);
 }
 
-template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates>
-void HashTable<Key, T, Hash, KeyEqual, AllowDuplicates>::rehash(size_type new_cap)
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+void HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::rehash(size_type new_cap)
 {
-    std::vector<Bucket> new_buckets(new_cap, nullptr);
-    for (auto& bucket : _buckets)
+    std::uint64_t started = stat_clock();
+    finish_migration();
+    std::vector<Bucket, BucketAlloc> new_buckets{ BucketAlloc(_node_alloc) };
+    fill_index(new_buckets, new_cap, Bucket());
+    stat_allocation();
+    BucketPolicy policy(new_cap);
+    size_type threads = worker_count(_size);
+    if (threads > 1)
+    {
+        size_type linked;
+        parallel_link<false>(new_buckets, policy, threads, [&](size_type t, auto&& push) {
+            size_type stop = slice_begin(_buckets.size(), threads, t + 1);
+            for (size_type i = slice_begin(_buckets.size(), threads, t); i < stop; ++i)
+                for (Node* node = _buckets[i]; node; )
+                {
+                    Node* next = node->_next;
+                    push(node);
+                    node = next;
+                }
+        }, linked);
+    }
+    else
     {
-        Node* node = bucket;
-        while (node)
+        for (auto& bucket : _buckets)
         {
-            Node* next = node->_next;
-            size_type index = _hash_fn(get_key(node->_data)) % new_cap;
-            node->_next = new_buckets[index];
-            new_buckets[index] = node;
-            node = next;
+            Node* node = bucket;
+            while (node)
+            {
+                Node* next = node->_next;
+                size_type index = policy.index(hash_of(node));
+                node->_next = new_buckets[index];
+                new_buckets[index] = node;
+                node = next;
+            }
         }
     }
     _buckets.swap(new_buckets);
+    _policy = policy;
+    rebuild_occupancy();
+    stat_rehash(started);
 }
 
-template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates>
-typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates>::Node* 
-            HashTable<Key, T, Hash, KeyEqual, AllowDuplicates>::find_node(const key_type& key, size_type index) const
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+inline typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::size_type 
+            HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::worker_count(size_type nodes) const
 {
-    Node* current = _buckets[index];    
-    while (current)
+    return std::max<size_type>(1, std::min(_threads, nodes / PARALLEL_GRAIN));
+}
+
+// Two passes. First each thread sorts its share of the nodes, as handed out
+// by feed(t, push), into one list per destination range of buckets; then
+// thread p links every list bound for range p, so no chain is shared. Lists
+// keep the order nodes were pushed in, and with Unique a node whose key is
+// already linked is returned (chained through _next) instead.
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+template<bool Unique, typename Feed>
+typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::Node* 
+            HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::parallel_link(std::vector<Bucket, BucketAlloc>& buckets,
+            const BucketPolicy& policy, size_type threads, Feed&& feed, size_type& linked)
+{
+    size_type span = (buckets.size() + threads - 1) / threads;
+    std::vector<Node*> heads(threads * threads, nullptr);
+    std::vector<Node*> tails(threads * threads, nullptr);
+
+    run_parallel(threads, [&](size_type t) {
+        Node** head = heads.data() + t * threads;
+        Node** tail = tails.data() + t * threads;
+        feed(t, [&](Node* node) {
+            size_type p = policy.index(hash_of(node)) / span;
+            node->_next = nullptr;
+            if (tail[p])
+                tail[p]->_next = node;
+            else
+                head[p] = node;
+            tail[p] = node;
+        });
+    });
+
+    std::vector<Node*> rejected(threads, nullptr);
+    std::vector<size_type> counts(threads, 0);
+    run_parallel(threads, [&](size_type p) {
+        for (size_type t = 0; t < threads; ++t)
+        {
+            Node* node = heads[t * threads + p];
+            while (node)
+            {
+                Node* next = node->_next;
+                size_type hash = hash_of(node);
+                Bucket& bucket = buckets[policy.index(hash)];
+                if (Unique && find_node(get_key(node->_data), hash, bucket))
+                {
+                    node->_next = rejected[p];
+                    rejected[p] = node;
+                }
+                else
+                {
+                    node->_next = bucket;
+                    bucket = node;
+                    ++counts[p];
+                }
+                node = next;
+            }
+        }
+    });
+
+    linked = 0;
+    Node* result = nullptr;
+    for (size_type p = 0; p < threads; ++p)
     {
-        if (_key_eq(get_key(current->_data), key))
-            return current;
-        current = current->_next;
+        linked += counts[p];
+        while (Node* node = rejected[p])
+        {
+            rejected[p] = node->_next;
+            node->_next = result;
+            result = node;
+        }
     }
-    return nullptr; 
+    return result;
 }
 
-template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates>
-typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates>::size_type 
-            HashTable<Key, T, Hash, KeyEqual, AllowDuplicates>::bucket_index(const Key& key) const
+// Runs the value destructors of a large table across threads, leaving the
+// nodes linked for clear() to hand back to the allocator. Parts whose thread
+// cannot be started are destroyed serially by run_parallel on this thread,
+// so nothing escapes into the noexcept clear().
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+bool HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::destroy_values_parallel()
 {
-    return _hash_fn(key) % _buckets.size();
+    if constexpr (std::is_trivially_destructible<value_type>::value)
+    {
+        return false;
+    }
+    else
+    {
+        size_type threads = worker_count(_size);
+        if (threads < 2)
+            return false;
+
+        size_type total = _buckets.size() + _old_buckets.size();
+        run_parallel(threads, [&](size_type t) {
+            size_type stop = slice_begin(total, threads, t + 1);
+            for (size_type i = slice_begin(total, threads, t); i < stop; ++i)
+            {
+                Node* node = i < _buckets.size() ? _buckets[i] : _old_buckets[i - _buckets.size()];
+                for (; node; node = node->_next)
+                    NodeTraits::destroy(_node_alloc, std::addressof(node->_data));
+            }
+        });
+        return true;
+    }
 }
 
-template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates>
-template<bool IsConst>
-inline void HashTable<Key, T, Hash, KeyEqual, AllowDuplicates>::HashIterator<IsConst>::skip_empty()
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+inline bool HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::migrating() const
 {
-    while (_bucket != _bucket_end && !*_bucket)
-        ++_bucket;
+    return !_old_buckets.empty();
+}
 
-    if (_bucket != _bucket_end)
-        _node = *_bucket;
-    else
-        _node = nullptr;
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+void HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::start_migration(size_type new_cap)
+{
+    finish_migration();
+    std::vector<Bucket, BucketAlloc> new_buckets{ BucketAlloc(_node_alloc) };
+    fill_index(new_buckets, new_cap, Bucket());
+    stat_allocation();
+    stat_rehash(0);
+    _old_buckets.swap(_buckets);
+    _buckets.swap(new_buckets);
+    _old_policy = _policy;
+    _policy = BucketPolicy(new_cap);
+    _migrate_pos = 0;
+    reset_occupancy();
 }
 
-template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates>
-template<bool IsConst>
-inline HashTable<Key, T, Hash, KeyEqual, AllowDuplicates>::HashIterator<IsConst>::HashIterator(BucketPtr bucket, BucketPtr end, NodePtr node)
-    : _bucket(bucket)
-    , _bucket_end(end)
-    , _node(node)
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+void HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::migrate_bucket(size_type old_index)
 {
-    if (!_node)
-        skip_empty();
+    Node* node = _old_buckets[old_index];
+    _old_buckets[old_index] = nullptr;
+    while (node)
+    {
+        Node* next = node->_next;
+        size_type index = _policy.index(hash_of(node));
+        node->_next = _buckets[index];
+        _buckets[index] = node;
+        mark_occupied(index);
+        node = next;
+    }
 }
 
-template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates>
-template<bool IsConst>
-inline HashTable<Key, T, Hash, KeyEqual, AllowDuplicates>::HashIterator<IsConst>::~HashIterator()
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+void HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::migrate_step()
 {
+    size_type stop = std::min(_migrate_pos + REHASH_STEP, _old_buckets.size());
+    for (; _migrate_pos < stop; ++_migrate_pos)
+        migrate_bucket(_migrate_pos);
+    if (_migrate_pos == _old_buckets.size())
+        drop_old_buckets();
 }
 
-template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates>
-template<bool IsConst>
-typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates>::HashIterator<IsConst>::reference 
-            HashTable<Key, T, Hash, KeyEqual, AllowDuplicates>::HashIterator<IsConst>::operator*() const
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+void HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::finish_migration()
 {
-    return _node->_data;
+    if (!migrating())
+        return;
+    for (; _migrate_pos < _old_buckets.size(); ++_migrate_pos)
+        migrate_bucket(_migrate_pos);
+    drop_old_buckets();
 }
 
-template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates>
-template<bool IsConst>
-typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates>::HashIterator<IsConst>::pointer 
-            HashTable<Key, T, Hash, KeyEqual, AllowDuplicates>::HashIterator<IsConst>::operator->() const
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+inline void HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::drop_old_buckets()
 {
-    return &_node->_data;
+    _old_buckets = std::vector<Bucket, BucketAlloc>(BucketAlloc(_node_alloc));
+    _migrate_pos = 0;
 }
 
-template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates>
-template<bool IsConst>
-typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates>::HashIterator<IsConst>& 
-            HashTable<Key, T, Hash, KeyEqual, AllowDuplicates>::HashIterator<IsConst>::operator++()
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+inline void HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::reset_occupancy()
 {
-    _node = _node->_next;
-    if (!_node)
+    size_type words = (_buckets.size() + 63) / 64;
+    if (words == _occupied.size())
+        std::fill(_occupied.begin(), _occupied.end(), 0);
+    else
     {
-        ++_bucket;
-        skip_empty();
+        _occupied = std::vector<std::uint64_t, WordAlloc>(_occupied.get_allocator());
+        fill_index(_occupied, words, std::uint64_t(0));
     }
-    return *this;
+    _first_word = words;
 }
 
-template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates>
-template<bool IsConst>
-typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates>::HashIterator<IsConst> 
-            HashTable<Key, T, Hash, KeyEqual, AllowDuplicates>::HashIterator<IsConst>::operator++(int)
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+void HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::rebuild_occupancy()
 {
-    HashIterator temp = *this;
-    ++(*this);
-    return temp;
+    reset_occupancy();
+    size_type words = _occupied.size();
+    size_type threads = worker_count(_size);
+    run_parallel(threads, [&](size_type t) {
+        size_type stop = slice_begin(words, threads, t + 1);
+        for (size_type word = slice_begin(words, threads, t); word < stop; ++word)
+        {
+            size_type first = word * 64;
+            size_type count = std::min<size_type>(64, _buckets.size() - first);
+            std::uint64_t bits = 0;
+            for (size_type i = 0; i < count; ++i)
+                bits |= static_cast<std::uint64_t>(_buckets[first + i] != nullptr) << i;
+            _occupied[word] = bits;
+        }
+    });
+    _first_word = static_cast<size_type>(std::find_if(_occupied.begin(), _occupied.end(),
+        [](std::uint64_t bits) { return bits != 0; }) - _occupied.begin());
 }
 
-template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates>
-template<bool IsConst>
-inline bool HashTable<Key, T, Hash, KeyEqual, AllowDuplicates>::HashIterator<IsConst>::operator==(const HashIterator& rhs) const
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+inline void HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::mark_occupied(size_type index)
 {
-    return _node == rhs._node;
+    _occupied[index / 64] |= std::uint64_t(1) << (index % 64);
+    _first_word = std::min(_first_word, index / 64);
 }
 
-template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates>
-template<bool IsConst>
-inline bool HashTable<Key, T, Hash, KeyEqual, AllowDuplicates>::HashIterator<IsConst>::operator!=(const HashIterator& rhs) const
+// Brings the bit of head in line after its chain changed. Chains of the old
+// array are left alone.
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+void HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::sync_occupied(const Bucket& head)
 {
-    return !(*this == rhs);
+    const Bucket* data = _buckets.data();
+    if (std::less<const Bucket*>()(&head, data) || !std::less<const Bucket*>()(&head, data + _buckets.size()))
+        return;
+
+    size_type index = static_cast<size_type>(&head - data);
+    if (head)
+    {
+        mark_occupied(index);
+        return;
+    }
+    _occupied[index / 64] &= ~(std::uint64_t(1) << (index % 64));
+    while (_first_word < _occupied.size() && !_occupied[_first_word])
+        ++_first_word;
 }
 
-template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates>
-inline HashTable<Key, T, Hash, KeyEqual, AllowDuplicates>::HashTable(size_type capacity, const hasher& hash, const key_equal& equal)
-    : _buckets(capacity, nullptr)
-    , _hash_fn(hash)
-    , _key_eq(equal)
+// Index in the new array for a key about to be inserted. Its old bucket is
+// moved over first, so equal keys never end up split across both arrays.
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+inline typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::size_type 
+            HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::insert_index(size_type hash)
 {
+    if (migrating())
+    {
+        migrate_step();
+        if (migrating())
+            migrate_bucket(_old_policy.index(hash));
+    }
+    return _policy.index(hash);
 }
 
-template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates>
-inline HashTable<Key, T, Hash, KeyEqual, AllowDuplicates>::HashTable(const HashTable& other)
+// A key is in the old array exactly while its old bucket is not yet empty.
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+inline typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::Bucket& 
+            HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::chain_for(size_type hash)
 {
-    reserve(other._buckets.size());
-    for (const auto& kv : other)
-        insert(kv);
+    if (migrating())
+    {
+        Bucket& old = _old_buckets[_old_policy.index(hash)];
+        if (old)
+            return old;
+    }
+    return _buckets[_policy.index(hash)];
 }
 
-template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates>
-inline HashTable<Key, T, Hash, KeyEqual, AllowDuplicates>::HashTable(HashTable&& other) noexcept
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+inline const typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::Bucket& 
+            HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::chain_for(size_type hash) const
 {
-    swap(other);
+    if (migrating())
+    {
+        const Bucket& old = _old_buckets[_old_policy.index(hash)];
+        if (old)
+            return old;
+    }
+    return _buckets[_policy.index(hash)];
 }
 
-template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates>
-inline HashTable<Key, T, Hash, KeyEqual, AllowDuplicates>::~HashTable()
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+template<typename K>
+inline typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::size_type 
+            HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::hash_key(const K& key) const
 {
-    clear();
+    size_type hash = _hash_fn(key);
+    return _salt ? hash_mix(hash ^ _salt) : hash_finish<Hash>(hash);
 }
 
-template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates>
-inline HashTable<Key, T, Hash, KeyEqual, AllowDuplicates>& 
-            HashTable<Key, T, Hash, KeyEqual, AllowDuplicates>::operator=(const HashTable& other)
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+inline typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::size_type 
+            HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::hash_of(const Node* node) const
 {
-    if (this != &other)
+    if constexpr (CACHE_HASH)
+        return node->_hash;
+    else
+        return hash_key(get_key(node->_data));
+}
+
+// Hash under our Hash of a node of source; a stateless Hash gives every
+// table of this type and salt the same values, so the cached one is taken
+// as is.
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+inline typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::size_type 
+            HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::hash_from(const HashTable& source, const Node* node) const
+{
+    if constexpr (std::is_empty<Hash>::value)
     {
-        clear();
-        reserve(other._buckets.size());
-        for (const auto& kv : other)
-            insert(kv);
+        if (source._salt == _salt)
+            return source.hash_of(node);
     }
-    return *this;
+    return hash_key(get_key(node->_data));
 }
 
-template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates>
-inline HashTable<Key, T, Hash, KeyEqual, AllowDuplicates>& 
-            HashTable<Key, T, Hash, KeyEqual, AllowDuplicates>::operator=(HashTable&& other)
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+inline bool HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::holds(const HashTable& source, const Node* node) const
 {
-    if (this != &other)
-        swap(other);
-    return *this;
+    size_type hash = hash_from(source, node);
+    return find_node(get_key(node->_data), hash, chain_for(hash)) != nullptr;
 }
 
-template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates>
-std::pair<typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates>::iterator, bool>
-            HashTable<Key, T, Hash, KeyEqual, AllowDuplicates>::insert(const key_type& key, const mapped_type& value) 
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+template<typename K>
+inline bool HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::matches(const Node* node, size_type hash, const K& key) const
 {
-    return insert(value_type(key, value));
+    if constexpr (CACHE_HASH)
+    {
+        if (node->_hash != hash)
+            return false;
+    }
+    stat_comparison();
+    return _key_eq(get_key(node->_data), key);
 }
 
-template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates>
-std::pair<typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates>::iterator, bool>
-            HashTable<Key, T, Hash, KeyEqual, AllowDuplicates>::insert(const value_type& kv) 
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+template<typename K>
+typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::Node* 
+            HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::find_node(const K& key, size_type hash, const Bucket& head) const
 {
-    const key_type& key = get_key(kv);
-    size_type index = bucket_index(key);
-    Node* node = _buckets[index];
-
-    if constexpr (!AllowDuplicates) 
+    Node* current = head;
+    size_type probes = 0;
+    while (current)
     {
-        while (node) 
+        ++probes;
+        if (matches(current, hash, key))
         {
-            if (_key_eq(get_key(node->_data), key)) 
-                return { iterator(&_buckets[index], &_buckets[0] + _buckets.size(), node), false };
-            node = node->_next;
+            stat_lookup(probes, true);
+            return current;
         }
+        current = current->_next;
     }
-
-    _buckets[index] = new Node(kv, _buckets[index]);
-    ++_size;
-    check_load();
-    return { iterator(&_buckets[index], &_buckets[0] + _buckets.size(), _buckets[index]), true };
+    stat_lookup(probes, false);
+    return nullptr; 
 }
 
-template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates>
-std::pair<typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates>::iterator, bool>
-            HashTable<Key, T, Hash, KeyEqual, AllowDuplicates>::insert(value_type&& kv) 
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+template<typename... Args>
+typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::Node* 
+            HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::create_node(Args&&... args)
 {
-    const key_type& key = get_key(kv);
-    size_type index = bucket_index(key);
-    Node* node = _buckets[index];
-
-    if constexpr (!AllowDuplicates) 
+    Node* node = NodeTraits::allocate(_node_alloc, 1);
+    stat_allocation();
+    try
     {
-        while (node) 
-        {
-            if (_key_eq(get_key(node->_data), key)) 
-                return { iterator(&_buckets[index], &_buckets[0] + _buckets.size(), node), false };
-            node = node->_next;
-        }
+        NodeTraits::construct(_node_alloc, node, std::forward<Args>(args)...);
+    }
+    catch (...)
+    {
+        NodeTraits::deallocate(_node_alloc, node, 1);
+        throw;
     }
+    return node;
+}
 
-    _buckets[index] = new Node(std::move(kv), _buckets[index]);
-    ++_size;
-    check_load();
-    return { iterator(&_buckets[index], &_buckets[0] + _buckets.size(), _buckets[index]), true };
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+inline typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::Node* 
+            HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::create_moved_node(value_type& val)
+{
+    if constexpr (IS_SET)
+        return create_node(std::move(val));
+    else
+        return create_node(std::piecewise_construct,
+            std::forward_as_tuple(std::move(const_cast<key_type&>(val.first))), std::forward_as_tuple(std::move(val.second)));
 }
 
-template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates>
-inline std::pair<typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates>::iterator, bool> 
-            HashTable<Key, T, Hash, KeyEqual, AllowDuplicates>::insert_or_assign(const key_type& key, mapped_type&& val)
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+inline void HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::destroy_node(Node* node)
 {
-    size_type index = bucket_index(key);
-    Node* node = _buckets[index];
+    NodeTraits::destroy(_node_alloc, node);
+    NodeTraits::deallocate(_node_alloc, node, 1);
+}
 
-    while (node)
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+inline void HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::reserve_nodes(size_type n)
+{
+    if constexpr (supports_reserve<NodeAlloc>::value)
+        _node_alloc.reserve(n);
+}
+
+// Our _size nodes are all pool blocks when Node is pooled, so a count of
+// exactly _size leaves no room for anyone else's: not another container's
+// on the same pool, not a node handle's, and not an index array's.
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+inline bool HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::pool_holds_only_nodes() const
+{
+    if constexpr (supports_bulk_release<NodeAlloc>::value)
+        return NodeAlloc::pooled() && _node_alloc.allocated_blocks() == _size;
+    else
+        return false;
+}
+
+// Index arrays keep room for two elements at least, so a pool never serves
+// one as a single object and holds nothing of the table but its nodes.
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+template<typename U, typename A>
+inline void HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::fill_index(std::vector<U, A>& index, size_type n, U value)
+{
+    index.reserve(std::max<size_type>(n, 2));
+    index.assign(n, value);
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+template<typename MakeNode>
+void HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::clone_chains(const HashTable& other, MakeNode&& make)
+{
+    // Chains are copied in order into the bucket of the same index, so no
+    // key is hashed or compared; this table has other's bucket count and
+    // policy and holds nothing yet. Unmigrated nodes of a rehash in progress
+    // go straight to their bucket in the new array, as migrate_bucket() would.
+    for (size_type i = 0; i < other._buckets.size(); ++i)
     {
-        if (_key_eq(get_key(node->_data), key))
+        Bucket* tail = &_buckets[i];
+        for (const Node* source = other._buckets[i]; source; source = source->_next)
         {
-            node->_data.second = std::move(val);
-            return { iterator(_buckets.data() + index, _buckets.data() + _buckets.size(), node), false };
+            Node* node = make(source);
+            if constexpr (CACHE_HASH)
+                node->_hash = source->_hash;
+            *tail = node;
+            tail = &node->_next;
+            ++_size;
         }
-        node = node->_next;
+        if (_buckets[i])
+            mark_occupied(i);
     }
+    for (size_type i = other._migrate_pos; i < other._old_buckets.size(); ++i)
+        for (const Node* source = other._old_buckets[i]; source; source = source->_next)
+        {
+            size_type hash = other.hash_of(source);
+            Node* node = make(source);
+            if constexpr (CACHE_HASH)
+                node->_hash = hash;
+            size_type index = _policy.index(hash);
+            node->_next = _buckets[index];
+            _buckets[index] = node;
+            mark_occupied(index);
+            ++_size;
+        }
+}
 
-    value_type new_value(key, std::move(val));
-    _buckets[index] = new Node(std::move(new_value), _buckets[index]);
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::iterator 
+            HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::insert_node(Node* node, size_type hash, size_type index)
+{
+    if constexpr (CACHE_HASH)
+        node->_hash = hash;
+    node->_next = _buckets[index];
+    _buckets[index] = node;
+    mark_occupied(index);
     ++_size;
-    check_load();
-    return { iterator(_buckets.data() + index, _buckets.data() + _buckets.size(), _buckets[index]), true };
+    if (_chain_limit && chain_overflows(_buckets[index], hash))
+    {
+        reseed();
+        hash = hash_of(node);
+        index = _policy.index(hash);
+    }
+    if (check_load())
+    {
+        index = _policy.index(hash);
+        if (migrating())
+            migrate_bucket(_old_policy.index(hash));
+    }
+    return iterator_at(_buckets[index], node);
 }
 
-
-template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates>
-template<typename ...Args>
-inline std::pair<typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates>::iterator, bool> 
-            HashTable<Key, T, Hash, KeyEqual, AllowDuplicates>::emplace(Args&&... args)
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+bool HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::chain_overflows(const Bucket& head, size_type hash) const
 {
-    return insert(args...);
+    size_type others = 0;
+    for (const Node* node = head; node; node = node->_next)
+    {
+        if (hash_of(node) != hash && ++others > _chain_limit)
+            return true;
+    }
+    return false;
 }
 
-template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates>
-template<typename ...Args>
-inline std::pair<typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates>::iterator, bool> 
-            HashTable<Key, T, Hash, KeyEqual, AllowDuplicates>::try_emplace(const Key& key, Args && ...args)
+// Checks whole chains after a bulk load, against the hash of their first node.
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+void HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::guard_chains()
 {
-    size_type index = bucket_index(key);
-    Node* node = _buckets[index];
-
-    if constexpr (!AllowDuplicates)
+    if (!_chain_limit)
+        return;
+    finish_migration();
+    for (const Bucket& head : _buckets)
     {
-        while (node)
+        if (head && chain_overflows(head, hash_of(head)))
         {
-            if (_key_eq(get_key(node->_data), key))
-                return { iterator(_buckets.data() + index, _buckets.data() + _buckets.size(), node), false };
-            node = node->_next;
+            reseed();
+            return;
         }
     }
-
-    value_type val(std::piecewise_construct, std::forward_as_tuple(key), std::forward_as_tuple(std::forward<Args>(args)...));
-    _buckets[index] = new Node(std::move(val), _buckets[index]);
-    ++_size;
-    check_load();
-    return { iterator(_buckets.data() + index, _buckets.data() + _buckets.size(), _buckets[index]), true };
 }
 
-template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates>
-template<typename U>
-inline std::enable_if_t<std::is_same<U, EmptyStruct>::value, std::pair<
-        typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates>::iterator, bool>> 
-        HashTable<Key, T, Hash, KeyEqual, AllowDuplicates>::insert(const Key& key)
+// All new hashes are computed and the new array allocated before any node
+// moves, so a throwing Hash or allocator leaves the table as it was.
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+void HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::reseed()
 {
-    return insert(key, EmptyStruct{});
+    finish_migration();
+    std::uint64_t entropy = static_cast<std::uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+    size_type salt = hash_mix(hash_mix(static_cast<size_type>(entropy) ^ reinterpret_cast<std::uintptr_t>(this)) + _salt);
+    salt = salt ? salt : 1;
+
+    std::vector<size_type> hashes;
+    hashes.reserve(_size);
+    for (const Bucket& head : _buckets)
+        for (const Node* node = head; node; node = node->_next)
+            hashes.push_back(hash_mix(_hash_fn(get_key(node->_data)) ^ salt));
+    std::vector<Bucket, BucketAlloc> buckets(_buckets.size(), nullptr, BucketAlloc(_node_alloc));
+    stat_allocation();
+
+    size_type next_hash = 0;
+    for (Bucket& head : _buckets)
+        while (Node* node = head)
+        {
+            head = node->_next;
+            size_type hash = hashes[next_hash++];
+            if constexpr (CACHE_HASH)
+                node->_hash = hash;
+            size_type index = _policy.index(hash);
+            node->_next = buckets[index];
+            buckets[index] = node;
+        }
+    _buckets.swap(buckets);
+    _salt = salt;
+    rebuild_occupancy();
+    stat_reseed();
 }
 
-template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates>
-template<typename U>
-inline std::enable_if_t<std::is_same<U, EmptyStruct>::value, std::pair<
-        typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates>::iterator, bool>> 
-        HashTable<Key, T, Hash, KeyEqual, AllowDuplicates>::emplace(const Key& key)
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+void HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::unlink(Node* node)
 {
-    return insert(key);
+    Bucket& head = chain_for(hash_of(node));
+    Node** link = &head;
+    while (*link != node)
+        link = &(*link)->_next;
+    *link = node->_next;
+    node->_next = nullptr;
+    sync_occupied(head);
+    --_size;
+    check_shrink();
 }
 
-template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates>
-typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates>::iterator 
-            HashTable<Key, T, Hash, KeyEqual, AllowDuplicates>::find(const key_type& key)
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::iterator 
+            HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::iterator_at(Bucket& head, Node* node)
 {
-    size_type index = _hash_fn(key) % _buckets.size();
-    Node* node = find_node(key, index);
-    if (!node)
-        return end();
-    return iterator(_buckets.data() + index, _buckets.data() + _buckets.size(), node);
+    Bucket* old_end = _old_buckets.data() + _old_buckets.size();
+    if (migrating() && !std::less<Bucket*>()(&head, _old_buckets.data()) && std::less<Bucket*>()(&head, old_end))
+        return iterator(&head, old_end, node);
+    return iterator(&head, _buckets.data() + _buckets.size(), node, _old_buckets.data() + _migrate_pos, old_end,
+        _buckets.data(), _occupied.data());
 }
 
-template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates>
-typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates>::const_iterator 
-            HashTable<Key, T, Hash, KeyEqual, AllowDuplicates>::find(const key_type& key) const
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::const_iterator 
+            HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::iterator_at(const Bucket& head, const Node* node) const
 {
-    size_type index = _hash_fn(key) % _buckets.size();
-    Node* node = find_node(key, index);
-    if (!node)
-        return end();
-    return const_iterator(_buckets.data() + index, _buckets.data() + _buckets.size(), node);
+    const Bucket* old_end = _old_buckets.data() + _old_buckets.size();
+    if (migrating() && !std::less<const Bucket*>()(&head, _old_buckets.data()) && std::less<const Bucket*>()(&head, old_end))
+        return const_iterator(&head, old_end, node);
+    return const_iterator(&head, _buckets.data() + _buckets.size(), node, _old_buckets.data() + _migrate_pos, old_end,
+        _buckets.data(), _occupied.data());
 }
 
-template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates>
-typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates>::size_type 
-            HashTable<Key, T, Hash, KeyEqual, AllowDuplicates>::erase(const key_type& key)
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::size_type 
+            HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::bucket_index(const Key& key) const
 {
-    size_type index = _hash_fn(key) % _buckets.size();
-    Node*& head = _buckets[index];
-    Node* current = head;
-    Node* prev = nullptr;
-    size_type count = 0;
+    return _policy.index(hash_key(key));
+}
 
-    while (current)
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+template<bool IsConst>
+inline void HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::HashIterator<IsConst>::skip_empty()
+{
+    for (;;)
     {
-        if (_key_eq(get_key(current->_data), key))
+        if (_bits)
         {
-            Node* to_delete = current;
-            if (prev)
-                prev->_next = current->_next;
-            else
-                head = current->_next;
-
-            current = current->_next;
-            delete to_delete;
-            --_size;
-            ++count;
-            if constexpr (!AllowDuplicates)
-                break;
+            size_type index = static_cast<size_type>(_bucket - _base);
+            size_type stop = static_cast<size_type>(_bucket_end - _base);
+            if (index < stop)
+            {
+                size_type word = index / 64;
+                std::uint64_t bits = _bits[word] & (~std::uint64_t(0) << (index % 64));
+                while (!bits && ++word * 64 < stop)
+                    bits = _bits[word];
+                index = bits ? word * 64 + lowest_bit_index64(bits) : stop;
+                _bucket = _base + std::min(index, stop);
+            }
+        }
+        else
+        {
+            while (_bucket != _bucket_end && !*_bucket)
+                ++_bucket;
+        }
+
+        if (_bucket != _bucket_end)
+        {
+            _node = *_bucket;
+            return;
+        }
+        if (_spill == _spill_end)
+        {
+            _node = nullptr;
+            return;
+        }
+        _bucket = _spill;
+        _bucket_end = _spill_end;
+        _spill = _spill_end;
+        _bits = nullptr;
+    }
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+template<bool IsConst>
+inline HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::HashIterator<IsConst>::HashIterator(BucketPtr bucket, BucketPtr end, NodePtr node,
+            BucketPtr spill, BucketPtr spill_end, BucketPtr base, const std::uint64_t* bits)
+    : _bucket(bucket)
+    , _bucket_end(end)
+    , _spill(spill)
+    , _spill_end(spill_end)
+    , _node(node)
+    , _base(base)
+    , _bits(bits)
+{
+    if (!_node)
+        skip_empty();
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+template<bool IsConst>
+inline HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::HashIterator<IsConst>::~HashIterator()
+{
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+template<bool IsConst>
+typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::HashIterator<IsConst>::reference 
+            HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::HashIterator<IsConst>::operator*() const
+{
+    return _node->_data;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+template<bool IsConst>
+typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::HashIterator<IsConst>::pointer 
+            HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::HashIterator<IsConst>::operator->() const
+{
+    return &_node->_data;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+template<bool IsConst>
+typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::HashIterator<IsConst>& 
+            HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::HashIterator<IsConst>::operator++()
+{
+    _node = _node->_next;
+    if (!_node)
+    {
+        ++_bucket;
+        skip_empty();
+    }
+    return *this;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+template<bool IsConst>
+typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::HashIterator<IsConst> 
+            HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::HashIterator<IsConst>::operator++(int)
+{
+    HashIterator temp = *this;
+    ++(*this);
+    return temp;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+template<bool IsConst>
+inline bool HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::HashIterator<IsConst>::operator==(const HashIterator& rhs) const
+{
+    return _node == rhs._node;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+template<bool IsConst>
+inline bool HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::HashIterator<IsConst>::operator!=(const HashIterator& rhs) const
+{
+    return !(*this == rhs);
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+inline HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::HashTable(size_type capacity, const hasher& hash, const key_equal& equal,
+            const allocator_type& alloc)
+    : _node_alloc(alloc)
+    , _buckets(BucketAlloc(_node_alloc))
+    , _policy(BucketPolicy::round_up(capacity))
+    , _old_buckets(BucketAlloc(_node_alloc))
+    , _occupied(WordAlloc(_node_alloc))
+    , _hash_fn(hash)
+    , _key_eq(equal)
+{
+    fill_index(_buckets, BucketPolicy::round_up(capacity), Bucket());
+    reset_occupancy();
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+inline HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::HashTable(const HashTable& other)
+    : TableCounters<HASHTABLE_STATS_ENABLED>()
+    , _node_alloc(NodeTraits::select_on_container_copy_construction(other._node_alloc))
+    , _buckets(BucketAlloc(_node_alloc))
+    , _policy(other._policy)
+    , _old_buckets(BucketAlloc(_node_alloc))
+    , _occupied(WordAlloc(_node_alloc))
+    , _incremental(other._incremental)
+    , _threads(other._threads)
+    , _max_load(other._max_load)
+    , _min_load(other._min_load)
+    , _chain_limit(other._chain_limit)
+    , _salt(other._salt)
+    , _hash_fn(other._hash_fn)
+    , _key_eq(other._key_eq)
+{
+    fill_index(_buckets, other._buckets.size(), Bucket());
+    reset_occupancy();
+    reserve_nodes(other._size);
+    try
+    {
+        clone_chains(other, [this](const Node* source) { return create_node(source->_data); });
+    }
+    catch (...)
+    {
+        clear();
+        throw;
+    }
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+inline HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::HashTable(HashTable&& other) noexcept
+    : _node_alloc(other._node_alloc)
+    , _buckets(BucketAlloc(_node_alloc))
+    , _old_buckets(BucketAlloc(_node_alloc))
+    , _occupied(WordAlloc(_node_alloc))
+{
+    swap(other);
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+inline HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::~HashTable()
+{
+    // Nothing reads the buckets again, so when trivially destructible nodes
+    // fill a pool of their own it is dropped without clear()'s resets.
+    if constexpr (supports_bulk_release<NodeAlloc>::value && std::is_trivially_destructible<Node>::value)
+    {
+        if (pool_holds_only_nodes())
+        {
+            _node_alloc.release_all();
+            return;
+        }
+    }
+    clear();
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+inline HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>& 
+            HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::operator=(const HashTable& other)
+{
+    if (this == &other)
+        return *this;
+
+    if constexpr (NodeTraits::propagate_on_container_copy_assignment::value)
+    {
+        if (_node_alloc != other._node_alloc)
+        {
+            clear();
+            _buckets = std::vector<Bucket, BucketAlloc>(BucketAlloc(other._node_alloc));
+            _old_buckets = std::vector<Bucket, BucketAlloc>(BucketAlloc(other._node_alloc));
+            _occupied = std::vector<std::uint64_t, WordAlloc>(WordAlloc(other._node_alloc));
+            _node_alloc = other._node_alloc;
+        }
+    }
+
+    // Unlink every node but keep its memory: each one is refilled with an
+    // element of other before anything new is allocated.
+    Node* spare = nullptr;
+    size_type spares = _size;
+    for (auto* array : { &_buckets, &_old_buckets })
+        for (Bucket& head : *array)
+            while (head)
+            {
+                Node* node = head;
+                head = node->_next;
+                node->_next = spare;
+                spare = node;
+            }
+    drop_old_buckets();
+    _size = 0;
+
+    fill_index(_buckets, other._buckets.size(), Bucket());
+    _policy = other._policy;
+    _incremental = other._incremental;
+    _threads = other._threads;
+    _max_load = other._max_load;
+    _min_load = other._min_load;
+    _chain_limit = other._chain_limit;
+    _salt = other._salt;
+    _hash_fn = other._hash_fn;
+    _key_eq = other._key_eq;
+    reset_occupancy();
+    reserve_nodes(other._size > spares ? other._size - spares : 0);
+
+    auto recycle = [this, &spare](const Node* source) {
+        if (!spare)
+            return create_node(source->_data);
+        Node* node = spare;
+        spare = node->_next;
+        NodeTraits::destroy(_node_alloc, node);
+        try
+        {
+            NodeTraits::construct(_node_alloc, node, source->_data);
+        }
+        catch (...)
+        {
+            NodeTraits::deallocate(_node_alloc, node, 1);
+            throw;
+        }
+        return node;
+    };
+    try
+    {
+        clone_chains(other, recycle);
+    }
+    catch (...)
+    {
+        for (Node* next; spare; spare = next)
+        {
+            next = spare->_next;
+            destroy_node(spare);
+        }
+        clear();
+        throw;
+    }
+    for (Node* next; spare; spare = next)
+    {
+        next = spare->_next;
+        destroy_node(spare);
+    }
+    return *this;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+inline HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>& 
+            HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::operator=(HashTable&& other)
+{
+    if (this == &other)
+        return *this;
+
+    if constexpr (NodeTraits::propagate_on_container_move_assignment::value)
+    {
+        // Our nodes and arrays must go back to the allocator that made them
+        // before other's takes over; swap() then leaves other empty.
+        clear();
+        if (_node_alloc != other._node_alloc)
+        {
+            size_type buckets = _buckets.size();
+            _buckets = std::vector<Bucket, BucketAlloc>(BucketAlloc(other._node_alloc));
+            fill_index(_buckets, buckets, Bucket());
+            _old_buckets = std::vector<Bucket, BucketAlloc>(BucketAlloc(other._node_alloc));
+            _occupied = std::vector<std::uint64_t, WordAlloc>(WordAlloc(other._node_alloc));
+            reset_occupancy();
+        }
+        _node_alloc = std::move(other._node_alloc);
+        swap(other);
+        return *this;
+    }
+    else
+    {
+        if (NodeTraits::is_always_equal::value || _node_alloc == other._node_alloc)
+        {
+            clear();
+            swap(other);
+            return *this;
+        }
+
+        // Other's nodes cannot be adopted, so each element is moved into a
+        // node of our own, chain by chain as the copy does.
+        clear();
+        fill_index(_buckets, other._buckets.size(), Bucket());
+        _policy = other._policy;
+        _incremental = other._incremental;
+        _threads = other._threads;
+        _max_load = other._max_load;
+        _min_load = other._min_load;
+        _chain_limit = other._chain_limit;
+        _salt = other._salt;
+        _hash_fn = other._hash_fn;
+        _key_eq = other._key_eq;
+        reset_occupancy();
+        reserve_nodes(other._size);
+        try
+        {
+            clone_chains(other, [this](const Node* source) { return create_moved_node(const_cast<Node*>(source)->_data); });
+        }
+        catch (...)
+        {
+            clear();
+            other.clear();
+            throw;
+        }
+        other.clear();
+        return *this;
+    }
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+inline typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::allocator_type 
+            HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::get_allocator() const
+{
+    return allocator_type(_node_alloc);
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+inline typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::hasher 
+            HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::hash_function() const
+{
+    return _hash_fn;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+inline typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::key_equal 
+            HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::key_eq() const
+{
+    return _key_eq;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+std::pair<typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::iterator, bool>
+            HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::insert(const key_type& key, const mapped_type& value) 
+{
+    return insert(value_type(key, value));
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+std::pair<typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::iterator, bool>
+            HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::insert(const value_type& kv) 
+{
+    const key_type& key = get_key(kv);
+    size_type hash = hash_key(key);
+    size_type index = insert_index(hash);
+
+    if constexpr (!AllowDuplicates) 
+    {
+        if (Node* node = find_node(key, hash, _buckets[index])) 
+            return { iterator_at(_buckets[index], node), false };
+    }
+
+    return { insert_node(create_node(kv), hash, index), true };
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+std::pair<typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::iterator, bool>
+            HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::insert(value_type&& kv) 
+{
+    const key_type& key = get_key(kv);
+    size_type hash = hash_key(key);
+    size_type index = insert_index(hash);
+
+    if constexpr (!AllowDuplicates) 
+    {
+        if (Node* node = find_node(key, hash, _buckets[index])) 
+            return { iterator_at(_buckets[index], node), false };
+    }
+
+    return { insert_node(create_node(std::move(kv)), hash, index), true };
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+inline std::pair<typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::iterator, bool> 
+            HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::insert_or_assign(const key_type& key, mapped_type&& val)
+{
+    size_type hash = hash_key(key);
+    size_type index = insert_index(hash);
+
+    if (Node* node = find_node(key, hash, _buckets[index]))
+    {
+        node->_data.second = std::move(val);
+        return { iterator_at(_buckets[index], node), false };
+    }
+
+    return { insert_node(create_node(key, std::move(val)), hash, index), true };
+}
+
+
+// The element is built once, in its node. When the key is one of the
+// arguments a duplicate is found before anything is allocated; otherwise the
+// node is built first and freed again if its key turns out to be present.
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+template<typename ...Args>
+std::pair<typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::iterator, bool> 
+            HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::emplace(Args&&... args)
+{
+    if constexpr (!AllowDuplicates && emplace_key_extractable<Key, T, Args...>::value)
+    {
+        return emplace_unique(emplace_key<Key>(args...), std::forward<Args>(args)...);
+    }
+    else
+    {
+        Node* node = create_node(std::forward<Args>(args)...);
+        const key_type& key = get_key(node->_data);
+        size_type hash = hash_key(key);
+        size_type index = insert_index(hash);
+
+        if constexpr (!AllowDuplicates)
+        {
+            if (Node* existing = find_node(key, hash, _buckets[index]))
+            {
+                destroy_node(node);
+                return { iterator_at(_buckets[index], existing), false };
+            }
+        }
+
+        return { insert_node(node, hash, index), true };
+    }
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+template<typename ...Args>
+std::pair<typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::iterator, bool> 
+            HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::emplace_unique(const key_type& key, Args&&... args)
+{
+    size_type hash = hash_key(key);
+    size_type index = insert_index(hash);
+
+    if (Node* node = find_node(key, hash, _buckets[index]))
+        return { iterator_at(_buckets[index], node), false };
+
+    return { insert_node(create_node(std::forward<Args>(args)...), hash, index), true };
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+template<typename ...Args>
+inline std::pair<typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::iterator, bool> 
+            HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::try_emplace(const Key& key, Args && ...args)
+{
+    return try_emplace_key(key, std::forward<Args>(args)...);
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+template<typename K, typename ...Args>
+inline typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::template if_transparent<K, std::pair<typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::iterator, bool>> 
+            HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::try_emplace(K&& key, Args && ...args)
+{
+    return try_emplace_key(std::forward<K>(key), std::forward<Args>(args)...);
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+template<typename K, typename ...Args>
+std::pair<typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::iterator, bool> 
+            HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::try_emplace_key(K&& key, Args && ...args)
+{
+    size_type hash = hash_key(key);
+    size_type index = insert_index(hash);
+
+    if constexpr (!AllowDuplicates)
+    {
+        if (Node* node = find_node(key, hash, _buckets[index]))
+            return { iterator_at(_buckets[index], node), false };
+    }
+
+    Node* node;
+    if constexpr (IS_SET)
+        node = create_node(std::forward<K>(key), std::forward<Args>(args)...);
+    else
+        node = create_node(std::piecewise_construct,
+            std::forward_as_tuple(std::forward<K>(key)), std::forward_as_tuple(std::forward<Args>(args)...));
+    return { insert_node(node, hash, index), true };
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+inline typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::iterator 
+            HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::find(const key_type& key)
+{
+    return find_key(key);
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+template<typename K>
+inline typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::template if_transparent<K, typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::iterator> 
+            HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::find(const K& key)
+{
+    return find_key(key);
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+template<typename K>
+typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::iterator 
+            HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::find_key(const K& key)
+{
+    size_type hash = hash_key(key);
+    Bucket& head = chain_for(hash);
+    Node* node = find_node(key, hash, head);
+    if (!node)
+        return end();
+    return iterator_at(head, node);
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+inline typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::const_iterator 
+            HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::find(const key_type& key) const
+{
+    return find_key(key);
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+template<typename K>
+inline typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::template if_transparent<K, typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::const_iterator> 
+            HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::find(const K& key) const
+{
+    return find_key(key);
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+template<typename K>
+typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::const_iterator 
+            HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::find_key(const K& key) const
+{
+    size_type hash = hash_key(key);
+    const Bucket& head = chain_for(hash);
+    Node* node = find_node(key, hash, head);
+    if (!node)
+        return end();
+    return iterator_at(head, node);
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+inline typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::size_type 
+            HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::erase(const key_type& key)
+{
+    return erase_key(key);
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+template<typename K>
+inline typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::template if_transparent<K, typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::size_type> 
+            HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::erase(const K& key)
+{
+    return erase_key(key);
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+template<typename K>
+typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::size_type 
+            HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::erase_key(const K& key)
+{
+    return erase_hashed(key, hash_key(key));
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+template<typename K>
+typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::size_type 
+            HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::erase_hashed(const K& key, size_type hash)
+{
+    if (migrating())
+        migrate_step();
+    Node*& head = chain_for(hash);
+    Node* current = head;
+    Node* prev = nullptr;
+    size_type count = 0;
+
+    while (current)
+    {
+        if (matches(current, hash, key))
+        {
+            Node* to_delete = current;
+            if (prev)
+                prev->_next = current->_next;
+            else
+                head = current->_next;
+
+            current = current->_next;
+            destroy_node(to_delete);
+            --_size;
+            ++count;
+            if constexpr (!AllowDuplicates)
+                break;
         }
         else
         {
@@ -572,87 +1870,488 @@ typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates>::size_type
             current = current->_next;
         }
     }
-    return count;
+    if (count)
+    {
+        sync_occupied(head);
+        check_shrink();
+    }
+    return count;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+template<typename F>
+void HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::probe_batch(const key_type* keys, size_type count, F&& resolve) const
+{
+    size_type hashes[BATCH_SIZE];
+    const Bucket* heads[BATCH_SIZE];
+
+    for (size_type base = 0; base < count; base += BATCH_SIZE)
+    {
+        size_type n = std::min(BATCH_SIZE, count - base);
+        for (size_type i = 0; i < n; ++i)
+        {
+            hashes[i] = hash_key(keys[base + i]);
+            prefetch(&_buckets[_policy.index(hashes[i])]);
+        }
+        for (size_type i = 0; i < n; ++i)
+        {
+            heads[i] = &chain_for(hashes[i]);
+            prefetch(*heads[i]);
+        }
+        for (size_type i = 0; i < n; ++i)
+            resolve(*heads[i], find_node(keys[base + i], hashes[i], *heads[i]));
+    }
 }
 
-template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates>
-typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates>::mapped_type& 
-            HashTable<Key, T, Hash, KeyEqual, AllowDuplicates>::operator[](const Key& key)
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+template<typename OutputIt>
+OutputIt HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::find_batch(const key_type* keys, size_type count, OutputIt out)
 {
-    size_type index = bucket_index(key);
-    Node* node = _buckets[index];
+    probe_batch(keys, count, [&](const Bucket& head, Node* node) {
+        *out++ = node ? iterator_at(const_cast<Bucket&>(head), node) : end();
+    });
+    return out;
+}
 
-    while (node)
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+template<typename OutputIt>
+OutputIt HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::find_batch(const key_type* keys, size_type count, OutputIt out) const
+{
+    probe_batch(keys, count, [&](const Bucket& head, const Node* node) {
+        *out++ = node ? iterator_at(head, node) : end();
+    });
+    return out;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+template<typename OutputIt>
+OutputIt HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::contains_batch(const key_type* keys, size_type count, OutputIt out) const
+{
+    probe_batch(keys, count, [&](const Bucket&, const Node* node) {
+        *out++ = node != nullptr;
+    });
+    return out;
+}
+
+// Growing once up front keeps a group's prefetched buckets valid while it is
+// inserted; duplicates only make that reservation generous.
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::size_type 
+            HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::insert_batch(const value_type* values, size_type count)
+{
+    if (!_incremental && static_cast<float>(_size + count) > _buckets.size() * _max_load)
+        reserve(_size + count);
+    reserve_nodes(count);
+
+    size_type hashes[BATCH_SIZE];
+    size_type inserted = 0;
+    size_type salt = _salt;
+
+    for (size_type base = 0; base < count; base += BATCH_SIZE)
     {
-        if (_key_eq(get_key(node->_data), key))
-            return node->_data.second;
-        node = node->_next;
+        size_type n = std::min(BATCH_SIZE, count - base);
+        for (size_type i = 0; i < n; ++i)
+        {
+            hashes[i] = hash_key(get_key(values[base + i]));
+            prefetch(&_buckets[_policy.index(hashes[i])]);
+        }
+        if constexpr (!AllowDuplicates)
+        {
+            for (size_type i = 0; i < n; ++i)
+                prefetch(chain_for(hashes[i]));
+        }
+        for (size_type i = 0; i < n; ++i)
+        {
+            const value_type& val = values[base + i];
+            size_type index = insert_index(hashes[i]);
+            if constexpr (!AllowDuplicates)
+            {
+                if (find_node(get_key(val), hashes[i], _buckets[index]))
+                    continue;
+            }
+            insert_node(create_node(val), hashes[i], index);
+            ++inserted;
+            if (_salt != salt)
+            {
+                salt = _salt;
+                for (size_type j = i + 1; j < n; ++j)
+                    hashes[j] = hash_key(get_key(values[base + j]));
+            }
+        }
     }
+    return inserted;
+}
 
-    value_type new_pair(key, mapped_type());
-    _buckets[index] = new Node(std::move(new_pair), _buckets[index]);
-    ++_size;
-    check_load();
-    return _buckets[index]->_data.second;
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+template<typename InputIt>
+void HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::insert_range(InputIt first, InputIt last)
+{
+    using category = typename std::iterator_traits<InputIt>::iterator_category;
+    if constexpr (!std::is_base_of<std::forward_iterator_tag, category>::value)
+    {
+        for (; first != last; ++first)
+            emplace(*first);
+    }
+    else
+    {
+        size_type n = static_cast<size_type>(std::distance(first, last));
+        if (static_cast<float>(_size + n) > _buckets.size() * _max_load)
+            reserve(_size + n);
+        else
+            finish_migration();
+        reserve_nodes(n);
+
+        // Nodes are built here, then hashed and linked by the workers.
+        size_type threads = worker_count(n);
+        if (threads > 1)
+        {
+            std::vector<Node*> nodes;
+            nodes.reserve(n);
+            try
+            {
+                for (; first != last; ++first)
+                    nodes.push_back(create_node(*first));
+            }
+            catch (...)
+            {
+                for (Node* node : nodes)
+                    destroy_node(node);
+                throw;
+            }
+
+            size_type linked;
+            Node* rejected = parallel_link<!AllowDuplicates>(_buckets, _policy, threads, [&](size_type t, auto&& push) {
+                size_type stop = slice_begin(n, threads, t + 1);
+                for (size_type i = slice_begin(n, threads, t); i < stop; ++i)
+                {
+                    if constexpr (CACHE_HASH)
+                        nodes[i]->_hash = hash_key(get_key(nodes[i]->_data));
+                    push(nodes[i]);
+                }
+            }, linked);
+            _size += linked;
+            rebuild_occupancy();
+            while (rejected)
+            {
+                Node* next = rejected->_next;
+                destroy_node(rejected);
+                rejected = next;
+            }
+            guard_chains();
+            return;
+        }
+
+        for (; first != last; ++first)
+        {
+            Node* node;
+            size_type hash;
+            size_type index;
+            if constexpr (!AllowDuplicates && emplace_key_extractable<Key, T, decltype(*first)>::value)
+            {
+                const key_type& key = emplace_key<Key>(*first);
+                hash = hash_key(key);
+                index = _policy.index(hash);
+                if (find_node(key, hash, _buckets[index]))
+                    continue;
+                node = create_node(*first);
+            }
+            else
+            {
+                node = create_node(*first);
+                hash = hash_key(get_key(node->_data));
+                index = _policy.index(hash);
+                if constexpr (!AllowDuplicates)
+                {
+                    if (find_node(get_key(node->_data), hash, _buckets[index]))
+                    {
+                        destroy_node(node);
+                        continue;
+                    }
+                }
+            }
+
+            if constexpr (CACHE_HASH)
+                node->_hash = hash;
+            node->_next = _buckets[index];
+            _buckets[index] = node;
+            mark_occupied(index);
+            ++_size;
+        }
+        guard_chains();
+    }
 }
 
-template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates>
-typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates>::mapped_type& 
-            HashTable<Key, T, Hash, KeyEqual, AllowDuplicates>::operator[](Key&& key)
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::node_type 
+            HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::extract(const_iterator pos)
 {
-    size_type index = bucket_index(key);
-    Node* node = _buckets[index];
+    Node* node = const_cast<Node*>(pos._node);
+    if (migrating())
+        migrate_step();
+    unlink(node);
+    return node_type(node, _node_alloc);
+}
 
-    while (node)
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+inline typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::node_type 
+            HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::extract(iterator pos)
+{
+    return extract(const_iterator(pos._bucket, pos._bucket_end, pos._node));
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::node_type 
+            HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::extract(const key_type& key)
+{
+    size_type hash = hash_key(key);
+    Node* node = find_node(key, hash, chain_for(hash));
+    if (!node)
+        return node_type();
+    if (migrating())
+        migrate_step();
+    unlink(node);
+    return node_type(node, _node_alloc);
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::insert_return_type 
+            HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::insert(node_type&& nh)
+{
+    if (nh.empty())
+        return { end(), false, node_type() };
+
+    const key_type& key = get_key(nh._node->_data);
+    size_type hash = hash_key(key);
+    size_type index = insert_index(hash);
+
+    if constexpr (!AllowDuplicates)
     {
-        if (_key_eq(get_key(node->_data), key))
-            return node->_data.second;
-        node = node->_next;
+        if (Node* node = find_node(key, hash, _buckets[index]))
+            return { iterator_at(_buckets[index], node), false, std::move(nh) };
     }
 
-    value_type new_pair(std::move(key), mapped_type());
-    _buckets[index] = new Node(std::move(new_pair), _buckets[index]);
-    ++_size;
-    check_load();
-    return _buckets[index]->_data.second;
+    if (NodeTraits::is_always_equal::value || *nh._alloc == _node_alloc)
+        return { insert_node(nh.release(), hash, index), true, node_type() };
+
+    Node* node = create_moved_node(nh._node->_data);
+    nh.reset();
+    return { insert_node(node, hash, index), true, node_type() };
 }
 
-template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates>
-typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates>::mapped_type& 
-            HashTable<Key, T, Hash, KeyEqual, AllowDuplicates>::at(const Key& key)
+// Nodes are relinked in place; only when the allocators differ is each
+// element moved into a node of our own.
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+void HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::merge(HashTable& source)
 {
-    size_type index = bucket_index(key);
-    Node* node = _buckets[index];
-    while (node)
+    if (&source == this)
+        return;
+
+    bool same_alloc = NodeTraits::is_always_equal::value || _node_alloc == source._node_alloc;
+    for (auto* array : { &source._buckets, &source._old_buckets })
+        for (Bucket& head : *array)
+        {
+            Node** link = &head;
+            while (Node* node = *link)
+            {
+                const key_type& key = get_key(node->_data);
+                size_type hash = hash_from(source, node);
+                size_type index = insert_index(hash);
+
+                if constexpr (!AllowDuplicates)
+                {
+                    if (find_node(key, hash, _buckets[index]))
+                    {
+                        link = &node->_next;
+                        continue;
+                    }
+                }
+
+                Node* target = same_alloc ? node : create_moved_node(node->_data);
+                *link = node->_next;
+                --source._size;
+                insert_node(target, hash, index);
+                if (!same_alloc)
+                    source.destroy_node(node);
+            }
+            source.sync_occupied(head);
+        }
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+inline void HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::merge(HashTable&& source)
+{
+    merge(source);
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+void HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::insert_filtered(const HashTable& source, const HashTable& probe, bool present)
+{
+    const HashTable* scan = &source;
+    const HashTable* other = &probe;
+    if (present && probe._size < source._size)
+        std::swap(scan, other);
+    if (scan == this || (other == this && present))
+        return;
+
+    size_type most = _size + scan->_size;
+    if (static_cast<float>(most) > _buckets.size() * _max_load)
+        reserve(most);
+
+    for (const_iterator it = scan->begin(); it != scan->end(); ++it)
     {
-        if (_key_eq(get_key(node->_data), key))
-            return node->_data.second;
-        node = node->_next;
+        const Node* node = it._node;
+        if (other->holds(*scan, node) != present)
+            continue;
+
+        size_type hash = hash_from(*scan, node);
+        size_type index = insert_index(hash);
+        if constexpr (!AllowDuplicates)
+        {
+            if (other != this && find_node(get_key(node->_data), hash, _buckets[index]))
+                continue;
+        }
+        insert_node(create_node(node->_data), hash, index);
     }
-    throw std::out_of_range("HashTable::at - key not found");
+}
 
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+void HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::erase_filtered(const HashTable& probe, bool present)
+{
+    if (&probe == this)
+    {
+        if (present)
+            clear();
+        return;
+    }
+
+    // Taking away a smaller table: look its keys up here instead.
+    if (present && probe._size < _size)
+    {
+        for (const_iterator it = probe.begin(); it != probe.end(); ++it)
+            erase_hashed(get_key(it._node->_data), hash_from(probe, it._node));
+        return;
+    }
+
+    for (auto* array : { &_buckets, &_old_buckets })
+        for (Bucket& head : *array)
+        {
+            Node** link = &head;
+            while (Node* node = *link)
+            {
+                if (probe.holds(*this, node) == present)
+                {
+                    *link = node->_next;
+                    --_size;
+                    destroy_node(node);
+                }
+                else
+                {
+                    link = &node->_next;
+                }
+            }
+            sync_occupied(head);
+        }
+    check_shrink();
 }
 
-template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates>
-inline const typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates>::mapped_type& 
-            HashTable<Key, T, Hash, KeyEqual, AllowDuplicates>::at(const Key& key) const
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+bool HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::is_subset_of(const HashTable& other) const
 {
-    size_type index = bucket_index(key);
-    Node* node = _buckets[index];
-    while (node)
+    if (_size > other._size)
+        return false;
+    for (const_iterator it = begin(); it != end(); ++it)
     {
-        if (_key_eq(get_key(node->_data), key))
-            return node->_data.second;
-        node = node->_next;
+        if (!other.holds(*this, it._node))
+            return false;
     }
+    return true;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::mapped_type& 
+            HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::operator[](const Key& key)
+{
+    size_type hash = hash_key(key);
+    size_type index = insert_index(hash);
+
+    if (Node* node = find_node(key, hash, _buckets[index]))
+        return node->_data.second;
+
+    Node* inserted = create_node(key, mapped_type());
+    insert_node(inserted, hash, index);
+    return inserted->_data.second;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::mapped_type& 
+            HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::operator[](Key&& key)
+{
+    size_type hash = hash_key(key);
+    size_type index = insert_index(hash);
+
+    if (Node* node = find_node(key, hash, _buckets[index]))
+        return node->_data.second;
+
+    Node* inserted = create_node(std::move(key), mapped_type());
+    insert_node(inserted, hash, index);
+    return inserted->_data.second;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::mapped_type& 
+            HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::at(const Key& key)
+{
+    size_type hash = hash_key(key);
+    if (Node* node = find_node(key, hash, chain_for(hash)))
+        return node->_data.second;
+    throw std::out_of_range("HashTable::at - key not found");
+
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+inline const typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::mapped_type& 
+            HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::at(const Key& key) const
+{
+    size_type hash = hash_key(key);
+    if (Node* node = find_node(key, hash, chain_for(hash)))
+        return node->_data.second;
     throw std::out_of_range("HashTable::at - key not found");
 
 }
 
-template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates>
-inline std::pair<typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates>::iterator, 
-    typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates>::iterator> 
-    HashTable<Key, T, Hash, KeyEqual, AllowDuplicates>::equal_range(const Key& key)
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+inline std::pair<typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::iterator, 
+    typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::iterator> 
+    HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::equal_range(const Key& key)
+{
+    auto first = find(key);
+    if (first == end())
+        return { first, first };
+    auto last = first;
+    while (last != end() && _key_eq(get_key(*last), key))
+        ++last;
+    return { first, last };
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+inline std::pair<typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::const_iterator, 
+    typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::const_iterator> 
+    HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::equal_range(const Key& key) const
+{
+    auto first = find(key);
+    if (first == end())
+        return { first, first };
+    auto last = first;
+    while (last != end() && _key_eq(get_key(*last), key))
+        ++last;
+    return { first, last };
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+template<typename K>
+inline typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::template if_transparent<K, std::pair<typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::iterator, 
+    typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::iterator>> 
+    HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::equal_range(const K& key)
 {
     auto first = find(key);
     if (first == end())
@@ -663,10 +2362,11 @@ inline std::pair<typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates>::it
     return { first, last };
 }
 
-template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates>
-inline std::pair<typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates>::const_iterator, 
-    typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates>::const_iterator> 
-    HashTable<Key, T, Hash, KeyEqual, AllowDuplicates>::equal_range(const Key& key) const
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+template<typename K>
+inline typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::template if_transparent<K, std::pair<typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::const_iterator, 
+    typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::const_iterator>> 
+    HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::equal_range(const K& key) const
 {
     auto first = find(key);
     if (first == end())
@@ -677,62 +2377,111 @@ inline std::pair<typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates>::co
     return { first, last };
 }
 
-template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates>
-void HashTable<Key, T, Hash, KeyEqual, AllowDuplicates>::clear()
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+void HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::clear()
 {
-    for (auto& bucket : _buckets)
+    // When every block the pool handed out is one of our nodes, drop the
+    // whole pool at once; trivially destructible nodes are not walked.
+    bool destroyed = destroy_values_parallel();
+    if constexpr (supports_bulk_release<NodeAlloc>::value)
     {
-        Node* current = bucket;
-        while (current)
+        if (_size > 0 && pool_holds_only_nodes())
         {
-            Node* next = current->_next;
-            delete current;
-            current = next;
+            if (!std::is_trivially_destructible<Node>::value && !destroyed)
+            {
+                for (auto* array : { &_buckets, &_old_buckets })
+                    for (Node* bucket : *array)
+                        for (Node* current = bucket; current; )
+                        {
+                            Node* next = current->_next;
+                            NodeTraits::destroy(_node_alloc, current);
+                            current = next;
+                        }
+            }
+            _node_alloc.release_all();
+            std::fill(_buckets.begin(), _buckets.end(), nullptr);
+            reset_occupancy();
+            drop_old_buckets();
+            _size = 0;
+            return;
         }
-        bucket = nullptr;
     }
+
+    for (auto* array : { &_buckets, &_old_buckets })
+        for (auto& bucket : *array)
+        {
+            Node* current = bucket;
+            while (current)
+            {
+                Node* next = current->_next;
+                if (destroyed)
+                    NodeTraits::deallocate(_node_alloc, current, 1);
+                else
+                    destroy_node(current);
+                current = next;
+            }
+            bucket = nullptr;
+        }
+    reset_occupancy();
+    drop_old_buckets();
     _size = 0;
 }
 
-template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates>
-typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates>::size_type 
-            HashTable<Key, T, Hash, KeyEqual, AllowDuplicates>::count(const Key& key) const
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+inline typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::size_type 
+            HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::count(const Key& key) const
 {
-    size_type index = bucket_index(key);
-    Node* node = _buckets[index];
+    return count_key(key);
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+template<typename K>
+inline typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::template if_transparent<K, typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::size_type> 
+            HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::count(const K& key) const
+{
+    return count_key(key);
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+template<typename K>
+typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::size_type 
+            HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::count_key(const K& key) const
+{
+    size_type hash = hash_key(key);
+    Node* node = chain_for(hash);
     size_type cnt = 0;
     
     while (node)
     {
-        if (_key_eq(get_key(node->_data), key))
+        if (matches(node, hash, key))
             ++cnt;
         node = node->_next;
     }
     return cnt;
 }
 
-template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates>
-typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates>::size_type HashTable<Key, T, Hash, KeyEqual, AllowDuplicates>::size() const
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::size_type HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::size() const
 {
     return _size;
 }
 
-template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates>
-bool HashTable<Key, T, Hash, KeyEqual, AllowDuplicates>::empty() const
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+bool HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::empty() const
 {
     return _size == 0;
 }
 
-template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates>
-typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates>::size_type 
-            HashTable<Key, T, Hash, KeyEqual, AllowDuplicates>::bucket_count() const
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::size_type 
+            HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::bucket_count() const
 {
     return _buckets.size();
 }
 
-template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates>
-typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates>::size_type 
-            HashTable<Key, T, Hash, KeyEqual, AllowDuplicates>::bucket_size(size_type index) const
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::size_type 
+            HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::bucket_size(size_type index) const
 {
     size_type count = 0;
     Node* node = _buckets[index];
@@ -742,93 +2491,303 @@ typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates>::size_type
         ++count;
         node = node->_next;
     }
+
+    // Nodes not migrated yet count towards the bucket they are headed for.
+    for (size_type i = _migrate_pos; i < _old_buckets.size(); ++i)
+        for (node = _old_buckets[i]; node; node = node->_next)
+            if (_policy.index(hash_of(node)) == index)
+                ++count;
     return count;
 }
 
-template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates>
-typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates>::size_type 
-            HashTable<Key, T, Hash, KeyEqual, AllowDuplicates>::bucket(const Key& key) const
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::size_type 
+            HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::bucket(const Key& key) const
 {
     return bucket_index(key);
 }
 
-template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates>
-float HashTable<Key, T, Hash, KeyEqual, AllowDuplicates>::load_factor() const
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+float HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::load_factor() const
 {
     return _buckets.empty() ? 0.0f : static_cast<float>(_size) / _buckets.size();
 }
 
-template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates>
-float HashTable<Key, T, Hash, KeyEqual, AllowDuplicates>::max_load_factor() const
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+float HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::max_load_factor() const
 {
     return _max_load;
 }
 
-template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates>
-void HashTable<Key, T, Hash, KeyEqual, AllowDuplicates>::max_load_factor(float new_max)
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+void HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::max_load_factor(float new_max)
 {
     _max_load = new_max;
     check_load();
 }
 
-template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates>
-void HashTable<Key, T, Hash, KeyEqual, AllowDuplicates>::reserve(size_type n)
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+inline float HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::min_load_factor() const
+{
+    return _min_load;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+void HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::min_load_factor(float new_min)
+{
+    _min_load = new_min;
+    check_shrink();
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+void HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::shrink_to_fit()
+{
+    finish_migration();
+    size_type needed = static_cast<size_type>(std::ceil(_size / _max_load));
+    size_type new_cap = BucketPolicy::round_up(std::max<size_type>(needed, 8));
+    if (new_cap < _buckets.size())
+        rehash(new_cap);
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+void HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::reserve(size_type n)
+{
+    size_type needed = static_cast<size_type>(std::ceil(std::max(n, _size) / _max_load));
+    size_type new_cap = BucketPolicy::round_up(std::max<size_type>(needed, 8));
+    if (new_cap != _buckets.size())
+        rehash(new_cap);
+    else
+        finish_migration();
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+void HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::incremental_rehash(bool enable)
+{
+    _incremental = enable;
+    if (!enable)
+        finish_migration();
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+inline bool HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::incremental_rehash() const
+{
+    return _incremental;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+inline bool HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::rehash_in_progress() const
+{
+    return migrating();
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+void HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::chain_limit(size_type limit)
+{
+    _chain_limit = limit;
+    guard_chains();
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+inline typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::size_type 
+            HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::chain_limit() const
+{
+    return _chain_limit;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+inline void HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::parallelism(size_type threads)
+{
+    _threads = threads ? threads : std::max<size_type>(1, std::thread::hardware_concurrency());
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+inline typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::size_type 
+            HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::parallelism() const
+{
+    return _threads;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::size_type 
+            HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::scan_parts() const
+{
+    return worker_count(_size);
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+template<typename F>
+void HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::parallel_for_each(F f)
+{
+    size_type parts = scan_parts();
+    run_parallel(parts, [&](size_type i) {
+        auto [first, last] = subrange(i, parts);
+        for (; first != last; ++first)
+            f(*first);
+    });
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+template<typename F>
+void HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::parallel_for_each(F f) const
+{
+    size_type parts = scan_parts();
+    run_parallel(parts, [&](size_type i) {
+        auto [first, last] = subrange(i, parts);
+        for (; first != last; ++first)
+            f(*first);
+    });
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+std::pair<typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::iterator, typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::iterator> 
+            HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::subrange(size_type index, size_type parts)
+{
+    size_type first = slice_begin(_buckets.size(), parts, index);
+    size_type last = slice_begin(_buckets.size(), parts, index + 1);
+    // Buckets not migrated yet are split the same way.
+    size_type pending = _old_buckets.size() - _migrate_pos;
+    size_type old_first = _migrate_pos + slice_begin(pending, parts, index);
+    size_type old_last = _migrate_pos + slice_begin(pending, parts, index + 1);
+    return { iterator(_buckets.data() + first, _buckets.data() + last, nullptr,
+        _old_buckets.data() + old_first, _old_buckets.data() + old_last, _buckets.data(), _occupied.data()), end() };
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+std::pair<typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::const_iterator, typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::const_iterator> 
+            HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::subrange(size_type index, size_type parts) const
+{
+    size_type first = slice_begin(_buckets.size(), parts, index);
+    size_type last = slice_begin(_buckets.size(), parts, index + 1);
+    // Buckets not migrated yet are split the same way.
+    size_type pending = _old_buckets.size() - _migrate_pos;
+    size_type old_first = _migrate_pos + slice_begin(pending, parts, index);
+    size_type old_last = _migrate_pos + slice_begin(pending, parts, index + 1);
+    return { const_iterator(_buckets.data() + first, _buckets.data() + last, nullptr,
+        _old_buckets.data() + old_first, _old_buckets.data() + old_last, _buckets.data(), _occupied.data()), end() };
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+HashTableStats HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::stats() const
+{
+    HashTableStats stats;
+    stat_read(stats);
+    stats.size = _size;
+    stats.bucket_count = _buckets.size();
+    // Old buckets still to migrate are listed with the new array's.
+    auto add_chains = [&stats](const Bucket* first, const Bucket* last) {
+        for (; first != last; ++first)
+        {
+            Node* node = *first;
+            size_type length = 0;
+            for (; node; node = node->_next)
+                ++length;
+            if (stats.chain_lengths.size() <= length)
+                stats.chain_lengths.resize(length + 1, 0);
+            ++stats.chain_lengths[length];
+        }
+    };
+    add_chains(_buckets.data(), _buckets.data() + _buckets.size());
+    add_chains(_old_buckets.data() + _migrate_pos, _old_buckets.data() + _old_buckets.size());
+    return stats;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+inline void HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::reset_stats()
+{
+    stat_reset();
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+MemoryUsage HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::memory_usage() const
+{
+    MemoryUsage usage;
+    add_allocation(usage, &MemoryUsage::buckets, _buckets, _buckets.size());
+    add_allocation(usage, &MemoryUsage::buckets, _old_buckets, _old_buckets.size());
+    add_allocation(usage, &MemoryUsage::buckets, _occupied, _occupied.size());
+    usage.nodes = _size * sizeof(Node);
+    usage.slack += _size * (allocation_footprint(_node_alloc, 1) - sizeof(Node));
+    usage.slack += pool_idle_bytes(_node_alloc,
+        _size + pooled_blocks(_buckets) + pooled_blocks(_old_buckets) + pooled_blocks(_occupied));
+    return usage;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+template<typename KeyBytes>
+MemoryUsage HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::memory_usage(KeyBytes key_bytes) const
 {
-    size_type new_cap = std::max(n, _size);
-    new_cap = std::max<size_type>(new_cap, 8);
-    rehash(new_cap);
+    MemoryUsage usage = memory_usage();
+    for (const value_type& val : *this)
+        usage.key_heap += key_bytes(get_key(val));
+    return usage;
 }
 
-template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates>
-inline void HashTable<Key, T, Hash, KeyEqual, AllowDuplicates>::swap(HashTable& other) noexcept
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+inline void HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::swap(HashTable& other) noexcept
 {
+    if constexpr (NodeTraits::propagate_on_container_swap::value)
+        std::swap(_node_alloc, other._node_alloc);
     std::swap(_buckets, other._buckets);
+    std::swap(_policy, other._policy);
+    std::swap(_old_buckets, other._old_buckets);
+    std::swap(_old_policy, other._old_policy);
+    std::swap(_migrate_pos, other._migrate_pos);
+    std::swap(_occupied, other._occupied);
+    std::swap(_first_word, other._first_word);
+    std::swap(_incremental, other._incremental);
+    std::swap(_threads, other._threads);
     std::swap(_size, other._size);
     std::swap(_max_load, other._max_load);
+    std::swap(_min_load, other._min_load);
+    std::swap(_chain_limit, other._chain_limit);
+    std::swap(_salt, other._salt);
     std::swap(_hash_fn, other._hash_fn);
     std::swap(_key_eq, other._key_eq);
 }
 
-template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates>
-typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates>::iterator HashTable<Key, T, Hash, KeyEqual, AllowDuplicates>::begin()
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::iterator HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::begin()
 {
-    return iterator(_buckets.data(), _buckets.data() + _buckets.size());
+    return iterator(_buckets.data() + std::min(_first_word * 64, _buckets.size()), _buckets.data() + _buckets.size(),
+        nullptr, _old_buckets.data() + _migrate_pos, _old_buckets.data() + _old_buckets.size(),
+        _buckets.data(), _occupied.data());
 }
 
-template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates>
-typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates>::iterator HashTable<Key, T, Hash, KeyEqual, AllowDuplicates>::end()
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::iterator HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::end()
 {
     return iterator(_buckets.data() + _buckets.size(), _buckets.data() + _buckets.size());
 }
 
-template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates>
-typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates>::const_iterator HashTable<Key, T, Hash, KeyEqual, AllowDuplicates>::begin() const
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::const_iterator HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::begin() const
 {
-    return const_iterator(_buckets.data(), _buckets.data() + _buckets.size());
+    return const_iterator(_buckets.data() + std::min(_first_word * 64, _buckets.size()), _buckets.data() + _buckets.size(),
+        nullptr, _old_buckets.data() + _migrate_pos, _old_buckets.data() + _old_buckets.size(),
+        _buckets.data(), _occupied.data());
 }
 
-template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates>
-typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates>::const_iterator HashTable<Key, T, Hash, KeyEqual, AllowDuplicates>::end() const
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::const_iterator HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::end() const
 {
     return const_iterator(_buckets.data() + _buckets.size(), _buckets.data() + _buckets.size());
 }
 
-template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates>
-typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates>::const_iterator 
-            HashTable<Key, T, Hash, KeyEqual, AllowDuplicates>::cbegin() const
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::const_iterator 
+            HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::cbegin() const
 {
     return begin();
 }
 
-template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates>
-typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates>::const_iterator 
-            HashTable<Key, T, Hash, KeyEqual, AllowDuplicates>::cend() const
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::const_iterator 
+            HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::cend() const
 {
     return end();
 }
 
-template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates>
-inline bool HashTable<Key, T, Hash, KeyEqual, AllowDuplicates>::operator==(const HashTable& other) const
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+inline bool HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::operator==(const HashTable& other) const
 {
     if (_size != other._size)
         return false;
@@ -843,14 +2802,130 @@ inline bool HashTable<Key, T, Hash, KeyEqual, AllowDuplicates>::operator==(const
     return true;
 }
 
-template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates>
-inline bool HashTable<Key, T, Hash, KeyEqual, AllowDuplicates>::operator!=(const HashTable& other) const
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+inline bool HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::operator!=(const HashTable& other) const
+{
+    return !(*this == other);
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+inline HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::NodeHandle::NodeHandle(Node* node, const NodeAlloc& alloc)
+    : _node(node)
+    , _alloc(alloc)
+{
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+inline HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::NodeHandle::NodeHandle(NodeHandle&& other) noexcept
+    : _node(other._node)
+    , _alloc(std::move(other._alloc))
+{
+    other._node = nullptr;
+    other._alloc.reset();
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+inline typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::NodeHandle& 
+            HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::NodeHandle::operator=(NodeHandle&& other) noexcept
+{
+    if (this != &other)
+    {
+        reset();
+        _node = other._node;
+        _alloc = std::move(other._alloc);
+        other._node = nullptr;
+        other._alloc.reset();
+    }
+    return *this;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+inline HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::NodeHandle::~NodeHandle()
+{
+    reset();
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+inline typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::Node* 
+            HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::NodeHandle::release()
 {
-    return !(*this, other);
+    Node* node = _node;
+    _node = nullptr;
+    _alloc.reset();
+    return node;
 }
 
-template<typename K, typename M, typename H, typename E, bool D>
-inline void swap(HashTable<K, M, H, E, D>& lhs, HashTable<K, M, H, E, D>& rhs) noexcept
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+inline void HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::NodeHandle::reset()
+{
+    if (_node)
+    {
+        NodeTraits::destroy(*_alloc, _node);
+        NodeTraits::deallocate(*_alloc, _node, 1);
+        _node = nullptr;
+    }
+    _alloc.reset();
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+inline bool HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::NodeHandle::empty() const noexcept
+{
+    return _node == nullptr;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+inline HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::NodeHandle::operator bool() const noexcept
+{
+    return _node != nullptr;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+inline typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::key_type& 
+            HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::NodeHandle::key() const
+{
+    if constexpr (IS_SET)
+        return _node->_data;
+    else
+        return const_cast<key_type&>(_node->_data.first);
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+inline typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::mapped_type& 
+            HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::NodeHandle::mapped() const
+{
+    return _node->_data.second;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+inline typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::value_type& 
+            HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::NodeHandle::value() const
+{
+    return _node->_data;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+inline typename HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::allocator_type 
+            HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::NodeHandle::get_allocator() const
+{
+    return allocator_type(*_alloc);
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool AllowDuplicates, typename BucketPolicy, typename Allocator>
+inline void HashTable<Key, T, Hash, KeyEqual, AllowDuplicates, BucketPolicy, Allocator>::NodeHandle::swap(NodeHandle& other) noexcept
+{
+    std::swap(_node, other._node);
+    std::swap(_alloc, other._alloc);
+}
+
+template<typename K, typename M, typename H, typename E, bool D, typename P, typename A>
+inline void swap(HashTable<K, M, H, E, D, P, A>& lhs, HashTable<K, M, H, E, D, P, A>& rhs) noexcept
 {
     lhs.swap(rhs);
 }
+
+template<typename BucketPolicy = PowerOfTwoBuckets>
+struct ChainedStorage
+{
+    template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+    using table = HashTable<Key, T, Hash, KeyEqual, false, BucketPolicy, Allocator>;
+};
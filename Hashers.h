@@ -0,0 +1,304 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <random>
+#include <string_view>
+#include <type_traits>
+
+#include "BucketPolicy.h"
+#include "HashTable.h"
+
+// Transparent hasher for std::string keys. It hashes anything convertible to
+// std::string_view with the same result as std::hash<std::string>, so with
+// std::equal_to<> a lookup from a string_view or const char* builds no
+// temporary std::string.
+struct StringHash
+{
+    using is_transparent = void;
+
+    std::size_t operator()(std::string_view str) const noexcept;
+};
+
+inline std::size_t StringHash::operator()(std::string_view str) const noexcept
+{
+    return std::hash<std::string_view>()(str);
+}
+
+// Building blocks of the hashers below. hash_multiply leaves the low and
+// high words of a * b in a and b; hash_fold, wyhash's mixing step, xors them.
+constexpr std::uint64_t HASH_SECRET[4] = {
+    0xa0761d6478bd642fULL, 0xe7037ed1a0b428dbULL, 0x8ebc6af09c88c6e3ULL, 0x589965cc75374cc3ULL
+};
+
+inline void hash_multiply(std::uint64_t& a, std::uint64_t& b)
+{
+#if defined(__SIZEOF_INT128__)
+    unsigned __int128 product = static_cast<unsigned __int128>(a) * b;
+    a = static_cast<std::uint64_t>(product);
+    b = static_cast<std::uint64_t>(product >> 64);
+#else
+    std::uint64_t high = mul_high_u64(a, b);
+    a *= b;
+    b = high;
+#endif
+}
+
+inline std::uint64_t hash_fold(std::uint64_t a, std::uint64_t b)
+{
+    hash_multiply(a, b);
+    return a ^ b;
+}
+
+inline std::uint64_t hash_read64(const unsigned char* p)
+{
+    std::uint64_t word;
+    std::memcpy(&word, p, sizeof(word));
+    return word;
+}
+
+inline std::uint64_t hash_read32(const unsigned char* p)
+{
+    std::uint32_t word;
+    std::memcpy(&word, p, sizeof(word));
+    return word;
+}
+
+// Turns a seed into the key hash_bytes starts from; done once per hasher,
+// not per call.
+inline std::uint64_t hash_seed_key(std::uint64_t seed)
+{
+    return seed ^ hash_fold(seed ^ HASH_SECRET[0], HASH_SECRET[1]);
+}
+
+// wyhash over len bytes: keys up to 16 bytes take two overlapping reads and
+// no loop, longer ones are consumed 16 or 48 bytes at a time, the latter in
+// three independent lanes. Words are read in native byte order, so values
+// differ between little- and big-endian machines.
+inline std::uint64_t hash_bytes(const void* data, std::size_t len, std::uint64_t seed_key)
+{
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    std::uint64_t seed = seed_key;
+    std::uint64_t a, b;
+    if (len <= 16)
+    {
+        if (len >= 4)
+        {
+            std::size_t middle = (len >> 3) << 2;
+            a = hash_read32(p) << 32 | hash_read32(p + middle);
+            b = hash_read32(p + len - 4) << 32 | hash_read32(p + len - 4 - middle);
+        }
+        else if (len > 0)
+        {
+            a = static_cast<std::uint64_t>(p[0]) << 16 | static_cast<std::uint64_t>(p[len >> 1]) << 8 | p[len - 1];
+            b = 0;
+        }
+        else
+            a = b = 0;
+    }
+    else
+    {
+        std::size_t left = len;
+        if (left > 48)
+        {
+            std::uint64_t lane1 = seed, lane2 = seed;
+            do
+            {
+                seed = hash_fold(hash_read64(p) ^ HASH_SECRET[1], hash_read64(p + 8) ^ seed);
+                lane1 = hash_fold(hash_read64(p + 16) ^ HASH_SECRET[2], hash_read64(p + 24) ^ lane1);
+                lane2 = hash_fold(hash_read64(p + 32) ^ HASH_SECRET[3], hash_read64(p + 40) ^ lane2);
+                p += 48;
+                left -= 48;
+            } while (left > 48);
+            seed ^= lane1 ^ lane2;
+        }
+        while (left > 16)
+        {
+            seed = hash_fold(hash_read64(p) ^ HASH_SECRET[1], hash_read64(p + 8) ^ seed);
+            p += 16;
+            left -= 16;
+        }
+        // The last 16 bytes of the key, overlapping what the loops consumed.
+        a = hash_read64(p + left - 16);
+        b = hash_read64(p + left - 8);
+    }
+    a ^= HASH_SECRET[1];
+    b ^= seed;
+    hash_multiply(a, b);
+    return hash_fold(a ^ HASH_SECRET[0] ^ len, b ^ HASH_SECRET[1]);
+}
+
+// Multiply-xorshift mixer (the splitmix64 finalizer). It is a bijection, so
+// distinct 64-bit inputs never share a hash.
+inline std::uint64_t hash_word(std::uint64_t x)
+{
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+// Random seed drawn once per process for the Seeded* hashers. The clock and
+// a stack address are mixed in as well, in case std::random_device is
+// deterministic or unavailable here.
+inline std::uint64_t process_hash_seed()
+{
+    static const std::uint64_t seed = [] {
+        std::uint64_t bits = static_cast<std::uint64_t>(
+            std::chrono::steady_clock::now().time_since_epoch().count());
+        bits ^= static_cast<std::uint64_t>(reinterpret_cast<std::uintptr_t>(&bits));
+        try
+        {
+            std::random_device device;
+            bits ^= static_cast<std::uint64_t>(device()) << 32 ^ device();
+        }
+        catch (...)
+        {
+        }
+        return hash_word(bits);
+    }();
+    return seed;
+}
+
+// Fast hashers. All of them declare is_avalanching, so the tables skip
+// hash_mix on their results; none of them promise the same values across
+// library versions or machines, so do not persist them.
+
+// Integers, enums and pointers through hash_word. Nodes keep no hash code
+// for such keys, as recomputing it costs a few cycles.
+struct IntegerHash
+{
+    using is_avalanching = void;
+
+    template<typename T, typename = std::enable_if_t<std::is_integral<T>::value || std::is_enum<T>::value || std::is_pointer<T>::value>>
+    std::size_t operator()(T value) const noexcept;
+};
+
+// Strings through hash_bytes; transparent like StringHash, but with its own
+// values rather than std::hash's.
+struct FastStringHash
+{
+    using is_transparent = void;
+    using is_avalanching = void;
+
+    std::size_t operator()(std::string_view str) const noexcept;
+};
+
+// Seeded versions for sets filled from untrusted input: without the seed an
+// attacker cannot pick keys that collide, so cannot force long chains or
+// probe runs. Default-constructed they use process_hash_seed(). Being
+// stateful, they make merge and set algebra rehash keys coming from a set
+// whose hasher has another seed.
+class SeededIntegerHash
+{
+public:
+    using is_avalanching = void;
+
+    SeededIntegerHash() noexcept;
+    explicit SeededIntegerHash(std::uint64_t seed) noexcept;
+
+    template<typename T, typename = std::enable_if_t<std::is_integral<T>::value || std::is_enum<T>::value || std::is_pointer<T>::value>>
+    std::size_t operator()(T value) const noexcept;
+
+    std::uint64_t seed() const noexcept;
+
+private:
+    std::uint64_t _seed;
+};
+
+class SeededStringHash
+{
+public:
+    using is_transparent = void;
+    using is_avalanching = void;
+
+    SeededStringHash() noexcept;
+    explicit SeededStringHash(std::uint64_t seed) noexcept;
+
+    std::size_t operator()(std::string_view str) const noexcept;
+
+    std::uint64_t seed() const noexcept;
+
+private:
+    std::uint64_t _seed;
+    std::uint64_t _key;
+};
+
+template<typename T>
+inline std::uint64_t hash_integer_bits(T value)
+{
+    if constexpr (std::is_pointer<T>::value)
+        return static_cast<std::uint64_t>(reinterpret_cast<std::uintptr_t>(value));
+    else if constexpr (std::is_enum<T>::value)
+        return static_cast<std::uint64_t>(static_cast<std::underlying_type_t<T>>(value));
+    else
+        return static_cast<std::uint64_t>(value);
+}
+
+template<typename T, typename>
+inline std::size_t IntegerHash::operator()(T value) const noexcept
+{
+    return static_cast<std::size_t>(hash_word(hash_integer_bits(value)));
+}
+
+inline std::size_t FastStringHash::operator()(std::string_view str) const noexcept
+{
+    return static_cast<std::size_t>(hash_bytes(str.data(), str.size(), HASH_SECRET[2]));
+}
+
+inline SeededIntegerHash::SeededIntegerHash() noexcept
+    : _seed(process_hash_seed())
+{
+}
+
+inline SeededIntegerHash::SeededIntegerHash(std::uint64_t seed) noexcept
+    : _seed(seed)
+{
+}
+
+template<typename T, typename>
+inline std::size_t SeededIntegerHash::operator()(T value) const noexcept
+{
+    return static_cast<std::size_t>(hash_word(hash_integer_bits(value) ^ _seed));
+}
+
+inline std::uint64_t SeededIntegerHash::seed() const noexcept
+{
+    return _seed;
+}
+
+inline SeededStringHash::SeededStringHash() noexcept
+    : SeededStringHash(process_hash_seed())
+{
+}
+
+inline SeededStringHash::SeededStringHash(std::uint64_t seed) noexcept
+    : _seed(seed)
+    , _key(hash_seed_key(seed))
+{
+}
+
+inline std::size_t SeededStringHash::operator()(std::string_view str) const noexcept
+{
+    return static_cast<std::size_t>(hash_bytes(str.data(), str.size(), _key));
+}
+
+inline std::uint64_t SeededStringHash::seed() const noexcept
+{
+    return _seed;
+}
+
+template<typename Key>
+struct cache_hash_code<Key, IntegerHash> : std::bool_constant<!std::is_scalar<Key>::value>
+{
+};
+
+template<typename Key>
+struct cache_hash_code<Key, SeededIntegerHash> : std::bool_constant<!std::is_scalar<Key>::value>
+{
+};
@@ -0,0 +1,392 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "Snapshot.h"
+
+// Read-only view of a file written by save_snapshot(), mapped into memory
+// and queried in place: nothing is copied or rehashed when it is opened and
+// every process mapping the same file shares one copy in the page cache.
+// Only the table layout of trivially copyable keys can be mapped, and Hash
+// must agree with the writer's.
+template<
+	typename Key,
+	typename Hash = std::hash<Key>,
+	typename KeyEqual = std::equal_to<Key>
+>
+class Mapped_Unordered_Set
+{
+	static_assert(std::is_trivially_copyable<Key>::value, "Mapped_Unordered_Set needs trivially copyable keys");
+
+private:
+	const char* _data = nullptr;
+	std::size_t _length = 0;
+#if defined(_WIN32)
+	HANDLE _mapping = nullptr;
+#endif
+	const std::uint8_t* _ctrl = nullptr;
+	const Key* _slots = nullptr;
+	std::size_t _mask = 0;
+	std::size_t _size = 0;
+	Hash _hash_fn;
+	KeyEqual _key_eq;
+
+	void map(const std::string& path);
+	void unmap() noexcept;
+
+public:
+	using key_type = Key;
+	using value_type = Key;
+	using hasher = Hash;
+	using key_equal = KeyEqual;
+	using size_type = std::size_t;
+
+	class const_iterator
+	{
+		const std::uint8_t* _ctrl;
+		const std::uint8_t* _ctrl_end;
+		const Key* _slot;
+
+		void skip_empty();
+
+	public:
+		using iterator_category = std::forward_iterator_tag;
+		using value_type = Key;
+		using difference_type = std::ptrdiff_t;
+		using reference = const Key&;
+		using pointer = const Key*;
+
+		const_iterator(const std::uint8_t* ctrl, const std::uint8_t* end, const Key* slot);
+
+		reference operator*() const;
+		pointer operator->() const;
+
+		const_iterator& operator++();
+		const_iterator operator++(int);
+
+		bool operator==(const const_iterator& rhs) const;
+		bool operator!=(const const_iterator& rhs) const;
+	};
+
+	using iterator = const_iterator;
+
+	// Throws std::runtime_error if the file cannot be mapped, was not
+	// written for this Key or is corrupt. The control bytes are read once
+	// to check them; the slots are left to the page cache.
+	explicit Mapped_Unordered_Set(const std::string& path, const hasher& hash = hasher(), const key_equal& equal = key_equal());
+	~Mapped_Unordered_Set();
+
+	Mapped_Unordered_Set(const Mapped_Unordered_Set&) = delete;
+	Mapped_Unordered_Set& operator=(const Mapped_Unordered_Set&) = delete;
+	Mapped_Unordered_Set(Mapped_Unordered_Set&& other) noexcept;
+	Mapped_Unordered_Set& operator=(Mapped_Unordered_Set&& other) noexcept;
+
+	// The key in the mapping, or nullptr.
+	const Key* find(const key_type& key) const;
+	bool contains(const key_type& key) const;
+	size_type count(const key_type& key) const;
+
+	size_type size() const noexcept;
+	bool empty() const noexcept;
+	size_type bucket_count() const noexcept;
+
+	const_iterator begin() const;
+	const_iterator end() const;
+
+	void swap(Mapped_Unordered_Set& other) noexcept;
+};
+
+template<typename Key, typename Hash, typename KeyEqual>
+Mapped_Unordered_Set<Key, Hash, KeyEqual>::Mapped_Unordered_Set(const std::string& path, const hasher& hash, const key_equal& equal)
+	: _hash_fn(hash)
+	, _key_eq(equal)
+{
+	map(path);
+	try
+	{
+		if (_length < sizeof(SnapshotHeader))
+			throw std::runtime_error("snapshot: " + path + " is truncated");
+		const SnapshotHeader* header = reinterpret_cast<const SnapshotHeader*>(_data);
+		check_snapshot_header<Key>(*header, path);
+		if (header->_layout != SnapshotLayout::Table)
+			throw std::runtime_error("snapshot: " + path + " holds a different key type");
+		check_snapshot_table<Key>(*header, _length, path);
+
+		_ctrl = reinterpret_cast<const std::uint8_t*>(_data + sizeof(SnapshotHeader));
+		check_snapshot_ctrl(_ctrl, *header, path);
+		_slots = reinterpret_cast<const Key*>(_data + header->_slots_offset);
+		_mask = static_cast<std::size_t>(header->_capacity - 1);
+		_size = static_cast<std::size_t>(header->_count);
+	}
+	catch (...)
+	{
+		unmap();
+		throw;
+	}
+}
+
+template<typename Key, typename Hash, typename KeyEqual>
+inline Mapped_Unordered_Set<Key, Hash, KeyEqual>::~Mapped_Unordered_Set()
+{
+	unmap();
+}
+
+template<typename Key, typename Hash, typename KeyEqual>
+inline Mapped_Unordered_Set<Key, Hash, KeyEqual>::Mapped_Unordered_Set(Mapped_Unordered_Set&& other) noexcept
+	: _hash_fn(other._hash_fn)
+	, _key_eq(other._key_eq)
+{
+	swap(other);
+}
+
+template<typename Key, typename Hash, typename KeyEqual>
+inline Mapped_Unordered_Set<Key, Hash, KeyEqual>& Mapped_Unordered_Set<Key, Hash, KeyEqual>::operator=(Mapped_Unordered_Set&& other) noexcept
+{
+	if (this != &other)
+	{
+		unmap();
+		swap(other);
+	}
+	return *this;
+}
+
+#if defined(_WIN32)
+
+template<typename Key, typename Hash, typename KeyEqual>
+void Mapped_Unordered_Set<Key, Hash, KeyEqual>::map(const std::string& path)
+{
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+		throw std::runtime_error("snapshot: cannot open " + path);
+
+	LARGE_INTEGER length;
+	if (!GetFileSizeEx(file, &length) || length.QuadPart == 0)
+	{
+		CloseHandle(file);
+		throw std::runtime_error("snapshot: " + path + " is truncated");
+	}
+
+	// The mapping keeps the file open on its own.
+	_mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	CloseHandle(file);
+	if (!_mapping)
+		throw std::runtime_error("snapshot: cannot map " + path);
+
+	_data = static_cast<const char*>(MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0));
+	if (!_data)
+	{
+		CloseHandle(_mapping);
+		_mapping = nullptr;
+		throw std::runtime_error("snapshot: cannot map " + path);
+	}
+	_length = static_cast<std::size_t>(length.QuadPart);
+}
+
+template<typename Key, typename Hash, typename KeyEqual>
+void Mapped_Unordered_Set<Key, Hash, KeyEqual>::unmap() noexcept
+{
+	if (_data)
+		UnmapViewOfFile(_data);
+	if (_mapping)
+		CloseHandle(_mapping);
+	_data = nullptr;
+	_mapping = nullptr;
+	_length = 0;
+	_ctrl = nullptr;
+	_slots = nullptr;
+	_mask = 0;
+	_size = 0;
+}
+
+#else
+
+template<typename Key, typename Hash, typename KeyEqual>
+void Mapped_Unordered_Set<Key, Hash, KeyEqual>::map(const std::string& path)
+{
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+		throw std::runtime_error("snapshot: cannot open " + path);
+
+	struct stat info;
+	if (::fstat(fd, &info) != 0 || info.st_size == 0)
+	{
+		::close(fd);
+		throw std::runtime_error("snapshot: " + path + " is truncated");
+	}
+
+	// The mapping keeps the file open on its own.
+	void* data = ::mmap(nullptr, static_cast<std::size_t>(info.st_size), PROT_READ, MAP_SHARED, fd, 0);
+	::close(fd);
+	if (data == MAP_FAILED)
+		throw std::runtime_error("snapshot: cannot map " + path);
+
+	_data = static_cast<const char*>(data);
+	_length = static_cast<std::size_t>(info.st_size);
+}
+
+template<typename Key, typename Hash, typename KeyEqual>
+void Mapped_Unordered_Set<Key, Hash, KeyEqual>::unmap() noexcept
+{
+	if (_data)
+		::munmap(const_cast<char*>(_data), _length);
+	_data = nullptr;
+	_length = 0;
+	_ctrl = nullptr;
+	_slots = nullptr;
+	_mask = 0;
+	_size = 0;
+}
+
+#endif
+
+template<typename Key, typename Hash, typename KeyEqual>
+const Key* Mapped_Unordered_Set<Key, Hash, KeyEqual>::find(const key_type& key) const
+{
+	if (!_ctrl)
+		return nullptr;
+	std::size_t hash = hash_finish<Hash>(_hash_fn(key));
+	std::uint8_t tag = snapshot_tag(hash);
+	for (std::size_t index = hash & _mask; _ctrl[index]; index = (index + 1) & _mask)
+	{
+		if (_ctrl[index] == tag && _key_eq(_slots[index], key))
+			return _slots + index;
+	}
+	return nullptr;
+}
+
+template<typename Key, typename Hash, typename KeyEqual>
+inline bool Mapped_Unordered_Set<Key, Hash, KeyEqual>::contains(const key_type& key) const
+{
+	return find(key) != nullptr;
+}
+
+template<typename Key, typename Hash, typename KeyEqual>
+inline typename Mapped_Unordered_Set<Key, Hash, KeyEqual>::size_type Mapped_Unordered_Set<Key, Hash, KeyEqual>::count(const key_type& key) const
+{
+	return find(key) ? 1 : 0;
+}
+
+template<typename Key, typename Hash, typename KeyEqual>
+inline typename Mapped_Unordered_Set<Key, Hash, KeyEqual>::size_type Mapped_Unordered_Set<Key, Hash, KeyEqual>::size() const noexcept
+{
+	return _size;
+}
+
+template<typename Key, typename Hash, typename KeyEqual>
+inline bool Mapped_Unordered_Set<Key, Hash, KeyEqual>::empty() const noexcept
+{
+	return _size == 0;
+}
+
+template<typename Key, typename Hash, typename KeyEqual>
+inline typename Mapped_Unordered_Set<Key, Hash, KeyEqual>::size_type Mapped_Unordered_Set<Key, Hash, KeyEqual>::bucket_count() const noexcept
+{
+	return _ctrl ? _mask + 1 : 0;
+}
+
+template<typename Key, typename Hash, typename KeyEqual>
+inline typename Mapped_Unordered_Set<Key, Hash, KeyEqual>::const_iterator Mapped_Unordered_Set<Key, Hash, KeyEqual>::begin() const
+{
+	return const_iterator(_ctrl, _ctrl + bucket_count(), _slots);
+}
+
+template<typename Key, typename Hash, typename KeyEqual>
+inline typename Mapped_Unordered_Set<Key, Hash, KeyEqual>::const_iterator Mapped_Unordered_Set<Key, Hash, KeyEqual>::end() const
+{
+	return const_iterator(_ctrl + bucket_count(), _ctrl + bucket_count(), _slots + bucket_count());
+}
+
+template<typename Key, typename Hash, typename KeyEqual>
+void Mapped_Unordered_Set<Key, Hash, KeyEqual>::swap(Mapped_Unordered_Set& other) noexcept
+{
+	std::swap(_data, other._data);
+	std::swap(_length, other._length);
+#if defined(_WIN32)
+	std::swap(_mapping, other._mapping);
+#endif
+	std::swap(_ctrl, other._ctrl);
+	std::swap(_slots, other._slots);
+	std::swap(_mask, other._mask);
+	std::swap(_size, other._size);
+	std::swap(_hash_fn, other._hash_fn);
+	std::swap(_key_eq, other._key_eq);
+}
+
+template<typename Key, typename Hash, typename KeyEqual>
+inline Mapped_Unordered_Set<Key, Hash, KeyEqual>::const_iterator::const_iterator(const std::uint8_t* ctrl, const std::uint8_t* end, const Key* slot)
+	: _ctrl(ctrl)
+	, _ctrl_end(end)
+	, _slot(slot)
+{
+	skip_empty();
+}
+
+template<typename Key, typename Hash, typename KeyEqual>
+inline void Mapped_Unordered_Set<Key, Hash, KeyEqual>::const_iterator::skip_empty()
+{
+	while (_ctrl != _ctrl_end && !*_ctrl)
+	{
+		++_ctrl;
+		++_slot;
+	}
+}
+
+template<typename Key, typename Hash, typename KeyEqual>
+inline const Key& Mapped_Unordered_Set<Key, Hash, KeyEqual>::const_iterator::operator*() const
+{
+	return *_slot;
+}
+
+template<typename Key, typename Hash, typename KeyEqual>
+inline const Key* Mapped_Unordered_Set<Key, Hash, KeyEqual>::const_iterator::operator->() const
+{
+	return _slot;
+}
+
+template<typename Key, typename Hash, typename KeyEqual>
+inline typename Mapped_Unordered_Set<Key, Hash, KeyEqual>::const_iterator& Mapped_Unordered_Set<Key, Hash, KeyEqual>::const_iterator::operator++()
+{
+	++_ctrl;
+	++_slot;
+	skip_empty();
+	return *this;
+}
+
+template<typename Key, typename Hash, typename KeyEqual>
+inline typename Mapped_Unordered_Set<Key, Hash, KeyEqual>::const_iterator Mapped_Unordered_Set<Key, Hash, KeyEqual>::const_iterator::operator++(int)
+{
+	const_iterator temp = *this;
+	++(*this);
+	return temp;
+}
+
+template<typename Key, typename Hash, typename KeyEqual>
+inline bool Mapped_Unordered_Set<Key, Hash, KeyEqual>::const_iterator::operator==(const const_iterator& rhs) const
+{
+	return _slot == rhs._slot;
+}
+
+template<typename Key, typename Hash, typename KeyEqual>
+inline bool Mapped_Unordered_Set<Key, Hash, KeyEqual>::const_iterator::operator!=(const const_iterator& rhs) const
+{
+	return !(*this == rhs);
+}
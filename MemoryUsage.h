@@ -0,0 +1,125 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "PoolAllocator.h"
+
+// Heap bytes a set owns, as reported by memory_usage(); sizeof the set
+// itself, and so SmallStorage's inline keys, are not included.
+struct MemoryUsage
+{
+    // Index arrays: bucket heads, control bytes, positions, occupancy bits.
+    std::size_t buckets = 0;
+    // Live elements: size() * node_size.
+    std::size_t nodes = 0;
+    // Allocated without holding either: empty flat slots, spare vector
+    // capacity, allocator headers and rounding, idle pool chunk space.
+    std::size_t slack = 0;
+    // Memory the keys own themselves, as counted by the key hook.
+    std::size_t key_heap = 0;
+
+    std::size_t total() const noexcept;
+    MemoryUsage& operator+=(const MemoryUsage& other) noexcept;
+};
+
+inline std::size_t MemoryUsage::total() const noexcept
+{
+    return buckets + nodes + slack + key_heap;
+}
+
+inline MemoryUsage& MemoryUsage::operator+=(const MemoryUsage& other) noexcept
+{
+    buckets += other.buckets;
+    nodes += other.nodes;
+    slack += other.slack;
+    key_heap += other.key_heap;
+    return *this;
+}
+
+// Estimated size of the heap block behind an allocation of bytes, modelled
+// on glibc's malloc: one word of header, rounded up to 16 bytes, 32 at
+// least; from 128 KiB on, whole pages mapped for the block alone.
+inline std::size_t heap_block_bytes(std::size_t bytes)
+{
+    if (bytes == 0)
+        return 0;
+    if (bytes >= (std::size_t(128) << 10))
+        return (bytes + sizeof(std::size_t) + 4095) & ~std::size_t(4095);
+    std::size_t block = (bytes + sizeof(std::size_t) + 15) & ~std::size_t(15);
+    return block < 32 ? 32 : block;
+}
+
+// Bytes alloc really spends on allocate(n).
+template<typename Alloc>
+inline std::size_t allocation_footprint(const Alloc&, std::size_t n)
+{
+    return n ? heap_block_bytes(n * sizeof(typename Alloc::value_type)) : 0;
+}
+
+template<typename T>
+inline std::size_t allocation_footprint(const PoolAllocator<T>&, std::size_t n)
+{
+    if (n == 1 && NodePool::pooled(sizeof(T), alignof(T)))
+        return (sizeof(T) + NodePool::GRANULARITY - 1) / NodePool::GRANULARITY * NodePool::GRANULARITY;
+    return n ? heap_block_bytes(n * sizeof(T)) : 0;
+}
+
+// Share of alloc's idle pool space charged to a user holding blocks of the
+// pool's outstanding blocks, so the shares of a pool's users add up to all
+// of it. Other allocators keep no such reserve.
+template<typename Alloc>
+inline std::size_t pool_idle_bytes(const Alloc&, std::size_t)
+{
+    return 0;
+}
+
+template<typename T>
+inline std::size_t pool_idle_bytes(const PoolAllocator<T>& alloc, std::size_t blocks)
+{
+    std::size_t outstanding = alloc.allocated_blocks();
+    if (outstanding == 0 || blocks == 0)
+        return 0;
+    return static_cast<std::size_t>(static_cast<double>(alloc.idle_bytes()) * std::min(blocks, outstanding) / outstanding);
+}
+
+// Pool blocks behind vec: one while a PoolAllocator serves its single
+// element from the pool, none otherwise.
+template<typename U, typename A>
+inline std::size_t pooled_blocks(const std::vector<U, A>&)
+{
+    return 0;
+}
+
+template<typename U>
+inline std::size_t pooled_blocks(const std::vector<U, PoolAllocator<U>>& vec)
+{
+    return vec.capacity() == 1 && NodePool::pooled(sizeof(U), alignof(U));
+}
+
+// Adds the block behind vec to usage: used elements' bytes to field, the
+// rest of the block to slack.
+template<typename U, typename A>
+inline void add_allocation(MemoryUsage& usage, std::size_t MemoryUsage::*field, const std::vector<U, A>& vec, std::size_t used)
+{
+    std::size_t block = allocation_footprint(vec.get_allocator(), vec.capacity());
+    usage.*field += used * sizeof(U);
+    usage.slack += block - used * sizeof(U);
+}
+
+// Key hook for std::basic_string keys: the heap block of a string too long
+// for its small-string storage.
+struct StringHeapBytes
+{
+    template<typename CharT, typename Traits, typename Alloc>
+    std::size_t operator()(const std::basic_string<CharT, Traits, Alloc>& str) const noexcept;
+};
+
+template<typename CharT, typename Traits, typename Alloc>
+inline std::size_t StringHeapBytes::operator()(const std::basic_string<CharT, Traits, Alloc>& str) const noexcept
+{
+    static const std::size_t inline_capacity = std::basic_string<CharT, Traits, Alloc>().capacity();
+    return str.capacity() > inline_capacity ? allocation_footprint(str.get_allocator(), str.capacity() + 1) : 0;
+}
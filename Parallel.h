@@ -0,0 +1,50 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <exception>
+#include <thread>
+#include <vector>
+
+// Runs f(0) .. f(threads - 1) concurrently, f(0) on the calling thread, and
+// returns once all of them have finished. The parts must not wait on each
+// other: if a thread cannot be started, its part and those after it run on
+// the calling thread instead. An exception from a part run there is
+// rethrown after the joins; the other calls must not throw.
+template<typename F>
+void run_parallel(std::size_t threads, F&& f)
+{
+    std::vector<std::thread> workers;
+    std::size_t started = 1;
+    try
+    {
+        workers.reserve(threads - 1);
+        for (; started < threads; ++started)
+            workers.emplace_back([&f, t = started] { f(t); });
+    }
+    catch (...)
+    {
+    }
+
+    std::exception_ptr error;
+    try
+    {
+        f(0);
+        for (std::size_t t = started; t < threads; ++t)
+            f(t);
+    }
+    catch (...)
+    {
+        error = std::current_exception();
+    }
+    for (std::thread& worker : workers)
+        worker.join();
+    if (error)
+        std::rethrow_exception(error);
+}
+
+// Start of part i when [0, n) is cut into parts near-equal ranges.
+inline std::size_t slice_begin(std::size_t n, std::size_t parts, std::size_t i)
+{
+    return n / parts * i + std::min(i, n % parts);
+}
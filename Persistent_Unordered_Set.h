@@ -0,0 +1,678 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#include "BucketPolicy.h"
+
+// Set with O(1) snapshots: a hash array mapped trie whose nodes are shared
+// between versions by reference count. snapshot() (or a copy) only takes a
+// reference to the root; a later insert or erase copies just the nodes on
+// its path that another version still holds, at most one per level, and
+// changes nodes it owns alone in place. Each level splits on five more bits
+// of the mixed hash into up to 32 keys and subtries; keys whose whole hash
+// is equal end up together in one list at the bottom.
+//
+// Versions may be used from different threads at once, as reference counts
+// are atomic; any single version is as thread-safe as a standard container.
+template<
+	typename Key,
+	typename Hash = std::hash<Key>,
+	typename KeyEqual = std::equal_to<Key>
+>
+class Persistent_Unordered_Set
+{
+private:
+	static constexpr std::size_t BITS = 5;
+	static constexpr std::size_t LEVELS = (sizeof(std::size_t) * 8 + BITS - 1) / BITS;
+
+	struct Entry
+	{
+		std::size_t _hash;
+		Key _key;
+	};
+
+	struct Node
+	{
+		std::atomic<std::size_t> _refs;
+		// Which of the 32 fragments hold a key, and which a subtrie. Both are
+		// 0 at the bottom level, where _entries is an unordered list.
+		std::uint32_t _datamap = 0;
+		std::uint32_t _nodemap = 0;
+		// In fragment order.
+		std::vector<Entry> _entries;
+		std::vector<Node*> _children;
+
+		Node();
+		// Shares other's subtries.
+		Node(const Node& other);
+	};
+
+	Node* _root = nullptr;
+	std::size_t _size = 0;
+	Hash _hash_fn;
+	KeyEqual _key_eq;
+
+	static unsigned popcount(std::uint32_t bits);
+	static std::uint32_t fragment(std::size_t hash, std::size_t depth);
+	static void release(Node* node) noexcept;
+	static Node* own(Node*& slot);
+	static Node* make_pair(Entry&& a, Entry&& b, std::size_t depth);
+
+	const Entry* find_entry(const Key& key, std::size_t hash) const;
+	bool erase_from(Node*& slot, const Key& key, std::size_t hash, std::size_t depth);
+
+public:
+	using key_type = Key;
+	using value_type = Key;
+	using hasher = Hash;
+	using key_equal = KeyEqual;
+	using size_type = std::size_t;
+
+	class const_iterator
+	{
+		struct Frame
+		{
+			const Node* _node;
+			// Next entry of _node to visit, then next subtrie.
+			std::size_t _entry;
+			std::size_t _child;
+		};
+
+		std::array<Frame, LEVELS + 1> _stack;
+		std::size_t _depth = 0;
+
+		void settle();
+
+		friend class Persistent_Unordered_Set;
+
+	public:
+		using iterator_category = std::forward_iterator_tag;
+		using value_type = Key;
+		using difference_type = std::ptrdiff_t;
+		using reference = const Key&;
+		using pointer = const Key*;
+
+		const_iterator() = default;
+		explicit const_iterator(const Node* root);
+
+		reference operator*() const;
+		pointer operator->() const;
+
+		const_iterator& operator++();
+		const_iterator operator++(int);
+
+		bool operator==(const const_iterator& rhs) const;
+		bool operator!=(const const_iterator& rhs) const;
+	};
+
+	using iterator = const_iterator;
+
+	explicit Persistent_Unordered_Set(const hasher& hash = hasher(), const key_equal& equal = key_equal());
+
+	template<typename InputIt>
+	Persistent_Unordered_Set(InputIt first, InputIt last, const hasher& hash = hasher(), const key_equal& equal = key_equal());
+
+	Persistent_Unordered_Set(std::initializer_list<Key> ilist, const hasher& hash = hasher(), const key_equal& equal = key_equal());
+
+	// Copies share every node with other.
+	Persistent_Unordered_Set(const Persistent_Unordered_Set& other) noexcept;
+	Persistent_Unordered_Set(Persistent_Unordered_Set&& other) noexcept;
+	~Persistent_Unordered_Set();
+
+	Persistent_Unordered_Set& operator=(const Persistent_Unordered_Set& other) noexcept;
+	Persistent_Unordered_Set& operator=(Persistent_Unordered_Set&& other) noexcept;
+
+	// Read-only view of the current contents, unaffected by later changes
+	// to this set; O(1).
+	Persistent_Unordered_Set snapshot() const noexcept;
+
+	// Whether the key was added.
+	bool insert(const value_type& value);
+
+	template<typename InputIt>
+	void insert(InputIt first, InputIt last);
+
+	size_type erase(const key_type& key);
+	void clear() noexcept;
+
+	const_iterator find(const key_type& key) const;
+	bool contains(const key_type& key) const;
+	size_type count(const key_type& key) const;
+
+	size_type size() const noexcept;
+	bool empty() const noexcept;
+
+	const_iterator begin() const;
+	const_iterator end() const;
+
+	hasher hash_function() const;
+	key_equal key_eq() const;
+
+	void swap(Persistent_Unordered_Set& other) noexcept;
+
+	bool operator==(const Persistent_Unordered_Set& other) const;
+	bool operator!=(const Persistent_Unordered_Set& other) const;
+};
+
+template<typename Key, typename Hash, typename KeyEqual>
+inline Persistent_Unordered_Set<Key, Hash, KeyEqual>::Node::Node()
+	: _refs(1)
+{
+}
+
+template<typename Key, typename Hash, typename KeyEqual>
+Persistent_Unordered_Set<Key, Hash, KeyEqual>::Node::Node(const Node& other)
+	: _refs(1)
+	, _datamap(other._datamap)
+	, _nodemap(other._nodemap)
+	, _entries(other._entries)
+	, _children(other._children)
+{
+	for (Node* child : _children)
+		child->_refs.fetch_add(1, std::memory_order_relaxed);
+}
+
+template<typename Key, typename Hash, typename KeyEqual>
+inline unsigned Persistent_Unordered_Set<Key, Hash, KeyEqual>::popcount(std::uint32_t bits)
+{
+#if defined(__GNUC__) || defined(__clang__)
+	return static_cast<unsigned>(__builtin_popcount(bits));
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+	return __popcnt(bits);
+#else
+	bits = bits - ((bits >> 1) & 0x55555555u);
+	bits = (bits & 0x33333333u) + ((bits >> 2) & 0x33333333u);
+	return (((bits + (bits >> 4)) & 0x0f0f0f0fu) * 0x01010101u) >> 24;
+#endif
+}
+
+template<typename Key, typename Hash, typename KeyEqual>
+inline std::uint32_t Persistent_Unordered_Set<Key, Hash, KeyEqual>::fragment(std::size_t hash, std::size_t depth)
+{
+	return static_cast<std::uint32_t>((hash >> (depth * BITS)) & 31);
+}
+
+template<typename Key, typename Hash, typename KeyEqual>
+void Persistent_Unordered_Set<Key, Hash, KeyEqual>::release(Node* node) noexcept
+{
+	if (!node || node->_refs.fetch_sub(1, std::memory_order_acq_rel) != 1)
+		return;
+	for (Node* child : node->_children)
+		release(child);
+	delete node;
+}
+
+// The node in slot, first replaced by a private copy if another version
+// holds it too.
+template<typename Key, typename Hash, typename KeyEqual>
+typename Persistent_Unordered_Set<Key, Hash, KeyEqual>::Node* Persistent_Unordered_Set<Key, Hash, KeyEqual>::own(Node*& slot)
+{
+	if (slot->_refs.load(std::memory_order_acquire) != 1)
+	{
+		Node* copy = new Node(*slot);
+		release(slot);
+		slot = copy;
+	}
+	return slot;
+}
+
+// Subtrie at depth holding just a and b.
+template<typename Key, typename Hash, typename KeyEqual>
+typename Persistent_Unordered_Set<Key, Hash, KeyEqual>::Node*
+		Persistent_Unordered_Set<Key, Hash, KeyEqual>::make_pair(Entry&& a, Entry&& b, std::size_t depth)
+{
+	Node* node = new Node();
+	try
+	{
+		if (depth == LEVELS)
+		{
+			node->_entries.reserve(2);
+			node->_entries.push_back(std::move(a));
+			node->_entries.push_back(std::move(b));
+			return node;
+		}
+		std::uint32_t fa = fragment(a._hash, depth);
+		std::uint32_t fb = fragment(b._hash, depth);
+		if (fa == fb)
+		{
+			node->_children.push_back(make_pair(std::move(a), std::move(b), depth + 1));
+			node->_nodemap = std::uint32_t(1) << fa;
+			return node;
+		}
+		node->_entries.reserve(2);
+		node->_entries.push_back(fa < fb ? std::move(a) : std::move(b));
+		node->_entries.push_back(fa < fb ? std::move(b) : std::move(a));
+		node->_datamap = (std::uint32_t(1) << fa) | (std::uint32_t(1) << fb);
+		return node;
+	}
+	catch (...)
+	{
+		release(node);
+		throw;
+	}
+}
+
+template<typename Key, typename Hash, typename KeyEqual>
+const typename Persistent_Unordered_Set<Key, Hash, KeyEqual>::Entry*
+		Persistent_Unordered_Set<Key, Hash, KeyEqual>::find_entry(const Key& key, std::size_t hash) const
+{
+	const Node* node = _root;
+	for (std::size_t depth = 0; node; ++depth)
+	{
+		if (depth == LEVELS)
+		{
+			for (const Entry& entry : node->_entries)
+				if (_key_eq(entry._key, key))
+					return &entry;
+			return nullptr;
+		}
+		std::uint32_t bit = std::uint32_t(1) << fragment(hash, depth);
+		if (node->_datamap & bit)
+		{
+			const Entry& entry = node->_entries[popcount(node->_datamap & (bit - 1))];
+			return entry._hash == hash && _key_eq(entry._key, key) ? &entry : nullptr;
+		}
+		if (!(node->_nodemap & bit))
+			return nullptr;
+		node = node->_children[popcount(node->_nodemap & (bit - 1))];
+	}
+	return nullptr;
+}
+
+// Removes key, known to be present below slot. A subtrie left with a single
+// key is folded back into its parent, so every node but the root holds at
+// least two keys.
+template<typename Key, typename Hash, typename KeyEqual>
+bool Persistent_Unordered_Set<Key, Hash, KeyEqual>::erase_from(Node*& slot, const Key& key, std::size_t hash, std::size_t depth)
+{
+	Node* node = own(slot);
+	if (depth == LEVELS)
+	{
+		for (std::size_t i = 0; i < node->_entries.size(); ++i)
+		{
+			if (_key_eq(node->_entries[i]._key, key))
+			{
+				node->_entries.erase(node->_entries.begin() + i);
+				return true;
+			}
+		}
+		return false;
+	}
+
+	std::uint32_t bit = std::uint32_t(1) << fragment(hash, depth);
+	if (node->_datamap & bit)
+	{
+		node->_entries.erase(node->_entries.begin() + popcount(node->_datamap & (bit - 1)));
+		node->_datamap &= ~bit;
+		return true;
+	}
+
+	std::size_t index = popcount(node->_nodemap & (bit - 1));
+	if (!erase_from(node->_children[index], key, hash, depth + 1))
+		return false;
+	Node* child = node->_children[index];
+	if (child->_children.empty() && child->_entries.size() == 1)
+	{
+		node->_entries.insert(node->_entries.begin() + popcount(node->_datamap & (bit - 1)), std::move(child->_entries.front()));
+		node->_datamap |= bit;
+		node->_children.erase(node->_children.begin() + index);
+		node->_nodemap &= ~bit;
+		release(child);
+	}
+	return true;
+}
+
+template<typename Key, typename Hash, typename KeyEqual>
+inline Persistent_Unordered_Set<Key, Hash, KeyEqual>::Persistent_Unordered_Set(const hasher& hash, const key_equal& equal)
+	: _hash_fn(hash)
+	, _key_eq(equal)
+{
+}
+
+template<typename Key, typename Hash, typename KeyEqual>
+template<typename InputIt>
+Persistent_Unordered_Set<Key, Hash, KeyEqual>::Persistent_Unordered_Set(InputIt first, InputIt last, const hasher& hash, const key_equal& equal)
+	: _hash_fn(hash)
+	, _key_eq(equal)
+{
+	try
+	{
+		insert(first, last);
+	}
+	catch (...)
+	{
+		clear();
+		throw;
+	}
+}
+
+template<typename Key, typename Hash, typename KeyEqual>
+inline Persistent_Unordered_Set<Key, Hash, KeyEqual>::Persistent_Unordered_Set(std::initializer_list<Key> ilist, const hasher& hash, const key_equal& equal)
+	: Persistent_Unordered_Set(ilist.begin(), ilist.end(), hash, equal)
+{
+}
+
+template<typename Key, typename Hash, typename KeyEqual>
+inline Persistent_Unordered_Set<Key, Hash, KeyEqual>::Persistent_Unordered_Set(const Persistent_Unordered_Set& other) noexcept
+	: _root(other._root)
+	, _size(other._size)
+	, _hash_fn(other._hash_fn)
+	, _key_eq(other._key_eq)
+{
+	if (_root)
+		_root->_refs.fetch_add(1, std::memory_order_relaxed);
+}
+
+template<typename Key, typename Hash, typename KeyEqual>
+inline Persistent_Unordered_Set<Key, Hash, KeyEqual>::Persistent_Unordered_Set(Persistent_Unordered_Set&& other) noexcept
+	: _hash_fn(other._hash_fn)
+	, _key_eq(other._key_eq)
+{
+	swap(other);
+}
+
+template<typename Key, typename Hash, typename KeyEqual>
+inline Persistent_Unordered_Set<Key, Hash, KeyEqual>::~Persistent_Unordered_Set()
+{
+	release(_root);
+}
+
+template<typename Key, typename Hash, typename KeyEqual>
+inline Persistent_Unordered_Set<Key, Hash, KeyEqual>& Persistent_Unordered_Set<Key, Hash, KeyEqual>::operator=(const Persistent_Unordered_Set& other) noexcept
+{
+	Persistent_Unordered_Set(other).swap(*this);
+	return *this;
+}
+
+template<typename Key, typename Hash, typename KeyEqual>
+inline Persistent_Unordered_Set<Key, Hash, KeyEqual>& Persistent_Unordered_Set<Key, Hash, KeyEqual>::operator=(Persistent_Unordered_Set&& other) noexcept
+{
+	Persistent_Unordered_Set(std::move(other)).swap(*this);
+	return *this;
+}
+
+template<typename Key, typename Hash, typename KeyEqual>
+inline Persistent_Unordered_Set<Key, Hash, KeyEqual> Persistent_Unordered_Set<Key, Hash, KeyEqual>::snapshot() const noexcept
+{
+	return *this;
+}
+
+template<typename Key, typename Hash, typename KeyEqual>
+bool Persistent_Unordered_Set<Key, Hash, KeyEqual>::insert(const value_type& value)
+{
+	std::size_t hash = hash_finish<Hash>(_hash_fn(value));
+	// Looked up first, so a key already present copies nothing.
+	if (find_entry(value, hash))
+		return false;
+	if (!_root)
+		_root = new Node();
+
+	Node** slot = &_root;
+	for (std::size_t depth = 0;; ++depth)
+	{
+		Node* node = own(*slot);
+		if (depth == LEVELS)
+		{
+			node->_entries.push_back(Entry{ hash, value });
+			break;
+		}
+
+		std::uint32_t bit = std::uint32_t(1) << fragment(hash, depth);
+		if (node->_nodemap & bit)
+		{
+			slot = &node->_children[popcount(node->_nodemap & (bit - 1))];
+			continue;
+		}
+
+		std::size_t index = popcount(node->_datamap & (bit - 1));
+		if (!(node->_datamap & bit))
+		{
+			node->_entries.insert(node->_entries.begin() + index, Entry{ hash, value });
+			node->_datamap |= bit;
+			break;
+		}
+
+		// The fragment already holds another key: both move one level down.
+		node->_children.reserve(node->_children.size() + 1);
+		Node* child = make_pair(Entry(node->_entries[index]), Entry{ hash, value }, depth + 1);
+		node->_entries.erase(node->_entries.begin() + index);
+		node->_datamap &= ~bit;
+		node->_children.insert(node->_children.begin() + popcount(node->_nodemap & (bit - 1)), child);
+		node->_nodemap |= bit;
+		break;
+	}
+	++_size;
+	return true;
+}
+
+template<typename Key, typename Hash, typename KeyEqual>
+template<typename InputIt>
+void Persistent_Unordered_Set<Key, Hash, KeyEqual>::insert(InputIt first, InputIt last)
+{
+	for (; first != last; ++first)
+		insert(*first);
+}
+
+template<typename Key, typename Hash, typename KeyEqual>
+typename Persistent_Unordered_Set<Key, Hash, KeyEqual>::size_type Persistent_Unordered_Set<Key, Hash, KeyEqual>::erase(const key_type& key)
+{
+	std::size_t hash = hash_finish<Hash>(_hash_fn(key));
+	if (!find_entry(key, hash))
+		return 0;
+	erase_from(_root, key, hash, 0);
+	if (--_size == 0)
+		clear();
+	return 1;
+}
+
+template<typename Key, typename Hash, typename KeyEqual>
+inline void Persistent_Unordered_Set<Key, Hash, KeyEqual>::clear() noexcept
+{
+	release(_root);
+	_root = nullptr;
+	_size = 0;
+}
+
+template<typename Key, typename Hash, typename KeyEqual>
+typename Persistent_Unordered_Set<Key, Hash, KeyEqual>::const_iterator Persistent_Unordered_Set<Key, Hash, KeyEqual>::find(const key_type& key) const
+{
+	// Rebuilds the iterator's stack along the path to the key.
+	std::size_t hash = hash_finish<Hash>(_hash_fn(key));
+	const_iterator it;
+	const Node* node = _root;
+	for (std::size_t depth = 0; node; ++depth)
+	{
+		std::size_t index = 0;
+		if (depth == LEVELS)
+		{
+			for (; index < node->_entries.size() && !_key_eq(node->_entries[index]._key, key); ++index)
+			{
+			}
+			if (index == node->_entries.size())
+				return end();
+			it._stack[it._depth++] = { node, index, 0 };
+			return it;
+		}
+
+		std::uint32_t bit = std::uint32_t(1) << fragment(hash, depth);
+		if (node->_datamap & bit)
+		{
+			index = popcount(node->_datamap & (bit - 1));
+			const Entry& entry = node->_entries[index];
+			if (entry._hash != hash || !_key_eq(entry._key, key))
+				return end();
+			it._stack[it._depth++] = { node, index, 0 };
+			return it;
+		}
+		if (!(node->_nodemap & bit))
+			return end();
+		index = popcount(node->_nodemap & (bit - 1));
+		it._stack[it._depth++] = { node, node->_entries.size(), index + 1 };
+		node = node->_children[index];
+	}
+	return end();
+}
+
+template<typename Key, typename Hash, typename KeyEqual>
+inline bool Persistent_Unordered_Set<Key, Hash, KeyEqual>::contains(const key_type& key) const
+{
+	return find_entry(key, hash_finish<Hash>(_hash_fn(key))) != nullptr;
+}
+
+template<typename Key, typename Hash, typename KeyEqual>
+inline typename Persistent_Unordered_Set<Key, Hash, KeyEqual>::size_type Persistent_Unordered_Set<Key, Hash, KeyEqual>::count(const key_type& key) const
+{
+	return contains(key) ? 1 : 0;
+}
+
+template<typename Key, typename Hash, typename KeyEqual>
+inline typename Persistent_Unordered_Set<Key, Hash, KeyEqual>::size_type Persistent_Unordered_Set<Key, Hash, KeyEqual>::size() const noexcept
+{
+	return _size;
+}
+
+template<typename Key, typename Hash, typename KeyEqual>
+inline bool Persistent_Unordered_Set<Key, Hash, KeyEqual>::empty() const noexcept
+{
+	return _size == 0;
+}
+
+template<typename Key, typename Hash, typename KeyEqual>
+inline typename Persistent_Unordered_Set<Key, Hash, KeyEqual>::const_iterator Persistent_Unordered_Set<Key, Hash, KeyEqual>::begin() const
+{
+	return const_iterator(_root);
+}
+
+template<typename Key, typename Hash, typename KeyEqual>
+inline typename Persistent_Unordered_Set<Key, Hash, KeyEqual>::const_iterator Persistent_Unordered_Set<Key, Hash, KeyEqual>::end() const
+{
+	return const_iterator();
+}
+
+template<typename Key, typename Hash, typename KeyEqual>
+inline typename Persistent_Unordered_Set<Key, Hash, KeyEqual>::hasher Persistent_Unordered_Set<Key, Hash, KeyEqual>::hash_function() const
+{
+	return _hash_fn;
+}
+
+template<typename Key, typename Hash, typename KeyEqual>
+inline typename Persistent_Unordered_Set<Key, Hash, KeyEqual>::key_equal Persistent_Unordered_Set<Key, Hash, KeyEqual>::key_eq() const
+{
+	return _key_eq;
+}
+
+template<typename Key, typename Hash, typename KeyEqual>
+inline void Persistent_Unordered_Set<Key, Hash, KeyEqual>::swap(Persistent_Unordered_Set& other) noexcept
+{
+	std::swap(_root, other._root);
+	std::swap(_size, other._size);
+	std::swap(_hash_fn, other._hash_fn);
+	std::swap(_key_eq, other._key_eq);
+}
+
+template<typename Key, typename Hash, typename KeyEqual>
+bool Persistent_Unordered_Set<Key, Hash, KeyEqual>::operator==(const Persistent_Unordered_Set& other) const
+{
+	if (_size != other._size)
+		return false;
+	if (_root == other._root)
+		return true;
+	for (const Key& key : *this)
+		if (!other.contains(key))
+			return false;
+	return true;
+}
+
+template<typename Key, typename Hash, typename KeyEqual>
+inline bool Persistent_Unordered_Set<Key, Hash, KeyEqual>::operator!=(const Persistent_Unordered_Set& other) const
+{
+	return !(*this == other);
+}
+
+template<typename Key, typename Hash, typename KeyEqual>
+inline Persistent_Unordered_Set<Key, Hash, KeyEqual>::const_iterator::const_iterator(const Node* root)
+{
+	if (!root)
+		return;
+	_stack[_depth++] = { root, 0, 0 };
+	settle();
+}
+
+// Moves from a finished position to the next key, descending into subtries
+// once a node's own keys are done and climbing out of exhausted ones.
+template<typename Key, typename Hash, typename KeyEqual>
+void Persistent_Unordered_Set<Key, Hash, KeyEqual>::const_iterator::settle()
+{
+	while (_depth)
+	{
+		Frame& top = _stack[_depth - 1];
+		if (top._entry < top._node->_entries.size())
+			return;
+		if (top._child < top._node->_children.size())
+		{
+			const Node* child = top._node->_children[top._child++];
+			_stack[_depth++] = { child, 0, 0 };
+			continue;
+		}
+		--_depth;
+	}
+}
+
+template<typename Key, typename Hash, typename KeyEqual>
+inline const Key& Persistent_Unordered_Set<Key, Hash, KeyEqual>::const_iterator::operator*() const
+{
+	const Frame& top = _stack[_depth - 1];
+	return top._node->_entries[top._entry]._key;
+}
+
+template<typename Key, typename Hash, typename KeyEqual>
+inline const Key* Persistent_Unordered_Set<Key, Hash, KeyEqual>::const_iterator::operator->() const
+{
+	return &**this;
+}
+
+template<typename Key, typename Hash, typename KeyEqual>
+inline typename Persistent_Unordered_Set<Key, Hash, KeyEqual>::const_iterator& Persistent_Unordered_Set<Key, Hash, KeyEqual>::const_iterator::operator++()
+{
+	++_stack[_depth - 1]._entry;
+	settle();
+	return *this;
+}
+
+template<typename Key, typename Hash, typename KeyEqual>
+inline typename Persistent_Unordered_Set<Key, Hash, KeyEqual>::const_iterator Persistent_Unordered_Set<Key, Hash, KeyEqual>::const_iterator::operator++(int)
+{
+	const_iterator temp = *this;
+	++(*this);
+	return temp;
+}
+
+template<typename Key, typename Hash, typename KeyEqual>
+inline bool Persistent_Unordered_Set<Key, Hash, KeyEqual>::const_iterator::operator==(const const_iterator& rhs) const
+{
+	if (_depth != rhs._depth)
+		return false;
+	if (!_depth)
+		return true;
+	const Frame& a = _stack[_depth - 1];
+	const Frame& b = rhs._stack[_depth - 1];
+	return a._node == b._node && a._entry == b._entry;
+}
+
+template<typename Key, typename Hash, typename KeyEqual>
+inline bool Persistent_Unordered_Set<Key, Hash, KeyEqual>::const_iterator::operator!=(const const_iterator& rhs) const
+{
+	return !(*this == rhs);
+}
@@ -0,0 +1,358 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <vector>
+#include <type_traits>
+#include <utility>
+
+// Slab allocator for container nodes. Single-object requests up to
+// MAX_BLOCK bytes are carved out of large chunks and recycled through one
+// free list per size class; anything else goes to ::operator new. The pool
+// is not thread-safe: share it only between containers used by one thread.
+class NodePool
+{
+public:
+    static constexpr std::size_t MAX_BLOCK = 256;
+    static constexpr std::size_t GRANULARITY = alignof(std::max_align_t);
+
+    explicit NodePool(std::size_t chunk_bytes = 64 * 1024);
+    ~NodePool();
+
+    NodePool(const NodePool&) = delete;
+    NodePool& operator=(const NodePool&) = delete;
+
+    static bool pooled(std::size_t size, std::size_t align);
+
+    void* allocate(std::size_t size);
+    void deallocate(void* p, std::size_t size) noexcept;
+
+    // Makes room for count blocks of size bytes in the current chunk, so
+    // that many allocations are carved back to back from one block. A chunk
+    // too small for that is retired early; its tail is not reused.
+    void reserve(std::size_t size, std::size_t count);
+
+    // Number of blocks handed out and not yet returned.
+    std::size_t allocated_blocks() const noexcept;
+
+    // Frees every chunk at once. Only valid when none of the outstanding
+    // blocks is used again, e.g. a container dropping all of its nodes.
+    void release_all() noexcept;
+
+    std::size_t chunk_count() const noexcept;
+    // Bytes taken from ::operator new for chunks, and how many of them are
+    // not handed out right now (free lists and the untouched tail).
+    std::size_t reserved_bytes() const noexcept;
+    std::size_t idle_bytes() const noexcept;
+
+private:
+    struct FreeBlock
+    {
+        FreeBlock* _next;
+    };
+
+    static constexpr std::size_t CLASSES = MAX_BLOCK / GRANULARITY;
+
+    std::size_t _chunk_bytes;
+    std::vector<void*> _chunks;
+    unsigned char* _cursor = nullptr;
+    unsigned char* _end = nullptr;
+    FreeBlock* _free[CLASSES] = {};
+    std::size_t _allocated = 0;
+    std::size_t _reserved = 0;
+    std::size_t _used = 0;
+};
+
+inline NodePool::NodePool(std::size_t chunk_bytes)
+    : _chunk_bytes(chunk_bytes < MAX_BLOCK ? MAX_BLOCK : chunk_bytes)
+{
+}
+
+inline NodePool::~NodePool()
+{
+    release_all();
+}
+
+inline bool NodePool::pooled(std::size_t size, std::size_t align)
+{
+    return size <= MAX_BLOCK && align <= GRANULARITY;
+}
+
+inline void* NodePool::allocate(std::size_t size)
+{
+    std::size_t cls = (size + GRANULARITY - 1) / GRANULARITY - 1;
+    if (FreeBlock* block = _free[cls])
+    {
+        _free[cls] = block->_next;
+        ++_allocated;
+        _used += (cls + 1) * GRANULARITY;
+        return block;
+    }
+
+    std::size_t bytes = (cls + 1) * GRANULARITY;
+    if (static_cast<std::size_t>(_end - _cursor) < bytes)
+    {
+        _chunks.reserve(_chunks.size() + 1);
+        void* chunk = ::operator new(_chunk_bytes);
+        _chunks.push_back(chunk);
+        _reserved += _chunk_bytes;
+        _cursor = static_cast<unsigned char*>(chunk);
+        _end = _cursor + _chunk_bytes;
+    }
+
+    void* block = _cursor;
+    _cursor += bytes;
+    ++_allocated;
+    _used += bytes;
+    return block;
+}
+
+inline void NodePool::deallocate(void* p, std::size_t size) noexcept
+{
+    std::size_t cls = (size + GRANULARITY - 1) / GRANULARITY - 1;
+    FreeBlock* block = static_cast<FreeBlock*>(p);
+    block->_next = _free[cls];
+    _free[cls] = block;
+    --_allocated;
+    _used -= (cls + 1) * GRANULARITY;
+}
+
+inline void NodePool::reserve(std::size_t size, std::size_t count)
+{
+    std::size_t cls = (size + GRANULARITY - 1) / GRANULARITY - 1;
+    std::size_t bytes = (cls + 1) * GRANULARITY * count;
+    if (static_cast<std::size_t>(_end - _cursor) >= bytes)
+        return;
+
+    std::size_t chunk_bytes = bytes > _chunk_bytes ? bytes : _chunk_bytes;
+    _chunks.reserve(_chunks.size() + 1);
+    void* chunk = ::operator new(chunk_bytes);
+    _chunks.push_back(chunk);
+    _reserved += chunk_bytes;
+    _cursor = static_cast<unsigned char*>(chunk);
+    _end = _cursor + chunk_bytes;
+}
+
+inline std::size_t NodePool::allocated_blocks() const noexcept
+{
+    return _allocated;
+}
+
+inline void NodePool::release_all() noexcept
+{
+    for (void* chunk : _chunks)
+        ::operator delete(chunk);
+    _chunks.clear();
+    _cursor = _end = nullptr;
+    for (FreeBlock*& head : _free)
+        head = nullptr;
+    _allocated = 0;
+    _reserved = 0;
+    _used = 0;
+}
+
+inline std::size_t NodePool::chunk_count() const noexcept
+{
+    return _chunks.size();
+}
+
+inline std::size_t NodePool::reserved_bytes() const noexcept
+{
+    return _reserved;
+}
+
+inline std::size_t NodePool::idle_bytes() const noexcept
+{
+    return _reserved - _used;
+}
+
+// Standard allocator over a shared NodePool. Rebound copies share the pool,
+// so a HashTable's nodes and its small allocations land in the same chunks.
+// A copy-constructed container gets a fresh pool of its own.
+template<typename T>
+class PoolAllocator
+{
+    template<typename U>
+    friend class PoolAllocator;
+
+    std::shared_ptr<NodePool> _pool;
+
+public:
+    using value_type = T;
+    using propagate_on_container_copy_assignment = std::false_type;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+    using is_always_equal = std::false_type;
+
+    template<typename U>
+    struct rebind
+    {
+        using other = PoolAllocator<U>;
+    };
+
+    PoolAllocator();
+    explicit PoolAllocator(std::shared_ptr<NodePool> pool) noexcept;
+    PoolAllocator(const PoolAllocator& other) noexcept = default;
+
+    template<typename U>
+    PoolAllocator(const PoolAllocator<U>& other) noexcept;
+
+    PoolAllocator& operator=(const PoolAllocator& other) noexcept = default;
+
+    T* allocate(std::size_t n);
+    void deallocate(T* p, std::size_t n) noexcept;
+
+    PoolAllocator select_on_container_copy_construction() const;
+
+    // Whether single objects of T come from the pool; larger ones and
+    // arrays go to ::operator new and are not counted in allocated_blocks().
+    static bool pooled() noexcept;
+
+    // Readies the pool for n single-object allocations in one block.
+    void reserve(std::size_t n);
+
+    std::size_t allocated_blocks() const noexcept;
+    std::size_t reserved_bytes() const noexcept;
+    std::size_t idle_bytes() const noexcept;
+    void release_all() noexcept;
+
+    const std::shared_ptr<NodePool>& pool() const noexcept;
+
+    template<typename U>
+    bool operator==(const PoolAllocator<U>& rhs) const noexcept;
+
+    template<typename U>
+    bool operator!=(const PoolAllocator<U>& rhs) const noexcept;
+};
+
+template<typename T>
+inline PoolAllocator<T>::PoolAllocator()
+    : _pool(std::make_shared<NodePool>())
+{
+}
+
+template<typename T>
+inline PoolAllocator<T>::PoolAllocator(std::shared_ptr<NodePool> pool) noexcept
+    : _pool(std::move(pool))
+{
+}
+
+template<typename T>
+template<typename U>
+inline PoolAllocator<T>::PoolAllocator(const PoolAllocator<U>& other) noexcept
+    : _pool(other._pool)
+{
+}
+
+template<typename T>
+inline T* PoolAllocator<T>::allocate(std::size_t n)
+{
+    if (n == 1 && NodePool::pooled(sizeof(T), alignof(T)))
+        return static_cast<T*>(_pool->allocate(sizeof(T)));
+    return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t(alignof(T))));
+}
+
+template<typename T>
+inline void PoolAllocator<T>::deallocate(T* p, std::size_t n) noexcept
+{
+    if (n == 1 && NodePool::pooled(sizeof(T), alignof(T)))
+        _pool->deallocate(p, sizeof(T));
+    else
+        ::operator delete(p, std::align_val_t(alignof(T)));
+}
+
+template<typename T>
+inline PoolAllocator<T> PoolAllocator<T>::select_on_container_copy_construction() const
+{
+    return PoolAllocator();
+}
+
+template<typename T>
+inline bool PoolAllocator<T>::pooled() noexcept
+{
+    return NodePool::pooled(sizeof(T), alignof(T));
+}
+
+template<typename T>
+inline void PoolAllocator<T>::reserve(std::size_t n)
+{
+    if (NodePool::pooled(sizeof(T), alignof(T)))
+        _pool->reserve(sizeof(T), n);
+}
+
+template<typename T>
+inline std::size_t PoolAllocator<T>::allocated_blocks() const noexcept
+{
+    return _pool->allocated_blocks();
+}
+
+template<typename T>
+inline std::size_t PoolAllocator<T>::reserved_bytes() const noexcept
+{
+    return _pool->reserved_bytes();
+}
+
+template<typename T>
+inline std::size_t PoolAllocator<T>::idle_bytes() const noexcept
+{
+    return _pool->idle_bytes();
+}
+
+template<typename T>
+inline void PoolAllocator<T>::release_all() noexcept
+{
+    _pool->release_all();
+}
+
+template<typename T>
+inline const std::shared_ptr<NodePool>& PoolAllocator<T>::pool() const noexcept
+{
+    return _pool;
+}
+
+template<typename T>
+template<typename U>
+inline bool PoolAllocator<T>::operator==(const PoolAllocator<U>& rhs) const noexcept
+{
+    return _pool == rhs._pool;
+}
+
+template<typename T>
+template<typename U>
+inline bool PoolAllocator<T>::operator!=(const PoolAllocator<U>& rhs) const noexcept
+{
+    return !(*this == rhs);
+}
+
+// Detects allocators that can drop every block they handed out in one call,
+// which lets a container free all of its nodes in O(chunks). pooled() says
+// whether the container's nodes are among those blocks at all.
+template<typename Alloc, typename = void>
+struct supports_bulk_release : std::false_type
+{
+};
+
+template<typename Alloc>
+struct supports_bulk_release<Alloc, std::void_t<
+        decltype(Alloc::pooled()),
+        decltype(std::declval<const Alloc&>().allocated_blocks()),
+        decltype(std::declval<Alloc&>().release_all())>>
+    : std::true_type
+{
+};
+
+// Detects allocators that can prepare for a run of single-object
+// allocations, which bulk inserts use to lay their nodes out contiguously.
+template<typename Alloc, typename = void>
+struct supports_reserve : std::false_type
+{
+};
+
+template<typename Alloc>
+struct supports_reserve<Alloc, std::void_t<
+        decltype(std::declval<Alloc&>().reserve(std::size_t()))>>
+    : std::true_type
+{
+};
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define PROBE_GROUP_AVX2 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define PROBE_GROUP_SSE2 1
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// Control bytes used by FlatHashTable: a full slot stores 7 bits of its hash,
+// an empty slot has the high bit set.
+using ctrl_t = std::uint8_t;
+
+constexpr ctrl_t CTRL_EMPTY = 0x80;
+
+inline unsigned lowest_bit_index(std::uint32_t mask)
+{
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return static_cast<unsigned>(index);
+#else
+    return static_cast<unsigned>(__builtin_ctz(mask));
+#endif
+}
+
+// A window of WIDTH consecutive control bytes compared in one step. The
+// width is picked at compile time: AVX2 (32) when the build enables it,
+// SSE2 (16) on any x86-64 build, and a portable byte loop (8) elsewhere,
+// so a default x86-64 binary runs on every 64-bit x86 host.
+class ProbeGroup
+{
+public:
+#if defined(PROBE_GROUP_AVX2)
+    static constexpr std::size_t WIDTH = 32;
+#elif defined(PROBE_GROUP_SSE2)
+    static constexpr std::size_t WIDTH = 16;
+#else
+    static constexpr std::size_t WIDTH = 8;
+#endif
+
+    explicit ProbeGroup(const ctrl_t* ctrl);
+
+    std::uint32_t match(ctrl_t tag) const;
+    std::uint32_t match_empty() const;
+
+private:
+#if defined(PROBE_GROUP_AVX2)
+    __m256i _ctrl;
+#elif defined(PROBE_GROUP_SSE2)
+    __m128i _ctrl;
+#else
+    const ctrl_t* _ctrl;
+#endif
+};
+
+inline ProbeGroup::ProbeGroup(const ctrl_t* ctrl)
+#if defined(PROBE_GROUP_AVX2)
+    : _ctrl(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(ctrl)))
+#elif defined(PROBE_GROUP_SSE2)
+    : _ctrl(_mm_loadu_si128(reinterpret_cast<const __m128i*>(ctrl)))
+#else
+    : _ctrl(ctrl)
+#endif
+{
+}
+
+inline std::uint32_t ProbeGroup::match(ctrl_t tag) const
+{
+#if defined(PROBE_GROUP_AVX2)
+    return static_cast<std::uint32_t>(_mm256_movemask_epi8(
+        _mm256_cmpeq_epi8(_ctrl, _mm256_set1_epi8(static_cast<char>(tag)))));
+#elif defined(PROBE_GROUP_SSE2)
+    return static_cast<std::uint32_t>(_mm_movemask_epi8(
+        _mm_cmpeq_epi8(_ctrl, _mm_set1_epi8(static_cast<char>(tag)))));
+#else
+    std::uint32_t mask = 0;
+    for (std::size_t i = 0; i < WIDTH; ++i)
+        if (_ctrl[i] == tag)
+            mask |= 1u << i;
+    return mask;
+#endif
+}
+
+inline std::uint32_t ProbeGroup::match_empty() const
+{
+#if defined(PROBE_GROUP_AVX2)
+    return static_cast<std::uint32_t>(_mm256_movemask_epi8(_ctrl));
+#elif defined(PROBE_GROUP_SSE2)
+    return static_cast<std::uint32_t>(_mm_movemask_epi8(_ctrl));
+#else
+    std::uint32_t mask = 0;
+    for (std::size_t i = 0; i < WIDTH; ++i)
+        if (_ctrl[i] & CTRL_EMPTY)
+            mask |= 1u << i;
+    return mask;
+#endif
+}
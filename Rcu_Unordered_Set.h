@@ -0,0 +1,349 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+#include "BucketPolicy.h"
+#include "EpochDomain.h"
+
+// Read-mostly set whose find/contains/count never lock. Buckets are chains of
+// atomically linked nodes: writers are serialized by one mutex and publish a
+// node with a release store to its bucket head (or predecessor), readers walk
+// the chains with acquire loads inside an EpochGuard. Erased nodes are
+// retired to the EpochDomain instead of being deleted. Growing builds a
+// complete new bucket array with fresh nodes, publishes it with one pointer
+// store and retires the old array, so a reader always sees one consistent
+// table.
+template<
+	typename Key,
+	typename Hash = std::hash<Key>,
+	typename KeyEqual = std::equal_to<Key>
+>
+class Rcu_Unordered_Set
+{
+private:
+	struct Node
+	{
+		std::atomic<Node*> _next;
+		std::size_t _hash;
+		const Key _key;
+
+		template<typename... Args>
+		Node(std::size_t hash, Args&&... args);
+	};
+
+	struct BucketArray
+	{
+		std::size_t _mask;
+		std::unique_ptr<std::atomic<Node*>[]> _heads;
+
+		explicit BucketArray(std::size_t count);
+	};
+
+	std::atomic<BucketArray*> _array;
+	std::atomic<std::size_t> _size;
+	std::mutex _write_mutex;
+	std::atomic<float> _max_load;
+	Hash _hash_fn;
+	KeyEqual _key_eq;
+
+	static void delete_node(void* p);
+	static void delete_array(void* p);
+
+	const Node* find_node(const BucketArray* array, const Key& key, std::size_t hash) const;
+	void grow(BucketArray* array);
+
+public:
+	using key_type = Key;
+	using value_type = Key;
+	using hasher = Hash;
+	using key_equal = KeyEqual;
+	using size_type = std::size_t;
+
+	explicit Rcu_Unordered_Set(size_type bucket_count = 16, const hasher& hash = hasher(), const key_equal& equal = key_equal());
+	~Rcu_Unordered_Set();
+
+	Rcu_Unordered_Set(const Rcu_Unordered_Set&) = delete;
+	Rcu_Unordered_Set& operator=(const Rcu_Unordered_Set&) = delete;
+
+	// Readers: wait-free apart from the walk of one chain.
+	bool contains(const key_type& key) const;
+	size_type count(const key_type& key) const;
+
+	// Calls f(const Key&) on the stored element while it is protected.
+	template<typename F>
+	bool visit(const key_type& key, F&& f) const;
+
+	// Walks the table that is current when the call starts.
+	template<typename F>
+	void for_each(F&& f) const;
+
+	// Writers: serialized among themselves, never block readers.
+	bool insert(const value_type& value);
+	bool insert(value_type&& value);
+
+	template<typename... Args>
+	bool emplace(Args&&... args);
+
+	size_type erase(const key_type& key);
+	void clear();
+
+	size_type size() const noexcept;
+	bool empty() const noexcept;
+	size_type bucket_count() const noexcept;
+
+	float max_load_factor() const noexcept;
+	void max_load_factor(float ml) noexcept;
+};
+
+template<typename Key, typename Hash, typename KeyEqual>
+template<typename... Args>
+inline Rcu_Unordered_Set<Key, Hash, KeyEqual>::Node::Node(std::size_t hash, Args&&... args)
+	: _next(nullptr)
+	, _hash(hash)
+	, _key(std::forward<Args>(args)...)
+{
+}
+
+template<typename Key, typename Hash, typename KeyEqual>
+inline Rcu_Unordered_Set<Key, Hash, KeyEqual>::BucketArray::BucketArray(std::size_t count)
+	: _mask(count - 1)
+	, _heads(new std::atomic<Node*>[count])
+{
+	for (std::size_t i = 0; i < count; ++i)
+		_heads[i].store(nullptr, std::memory_order_relaxed);
+}
+
+template<typename Key, typename Hash, typename KeyEqual>
+void Rcu_Unordered_Set<Key, Hash, KeyEqual>::delete_node(void* p)
+{
+	delete static_cast<Node*>(p);
+}
+
+// Frees an unpublished array together with every node still linked into it.
+template<typename Key, typename Hash, typename KeyEqual>
+void Rcu_Unordered_Set<Key, Hash, KeyEqual>::delete_array(void* p)
+{
+	BucketArray* array = static_cast<BucketArray*>(p);
+	for (std::size_t i = 0; i <= array->_mask; ++i)
+	{
+		Node* node = array->_heads[i].load(std::memory_order_relaxed);
+		while (node)
+		{
+			Node* next = node->_next.load(std::memory_order_relaxed);
+			delete node;
+			node = next;
+		}
+	}
+	delete array;
+}
+
+template<typename Key, typename Hash, typename KeyEqual>
+Rcu_Unordered_Set<Key, Hash, KeyEqual>::Rcu_Unordered_Set(size_type bucket_count, const hasher& hash, const key_equal& equal)
+	: _array(new BucketArray(PowerOfTwoBuckets::round_up(bucket_count ? bucket_count : 1)))
+	, _size(0)
+	, _max_load(0.75f)
+	, _hash_fn(hash)
+	, _key_eq(equal)
+{
+}
+
+// Readers must be gone by now; nodes already retired are owned by the domain.
+template<typename Key, typename Hash, typename KeyEqual>
+Rcu_Unordered_Set<Key, Hash, KeyEqual>::~Rcu_Unordered_Set()
+{
+	delete_array(_array.load(std::memory_order_relaxed));
+}
+
+template<typename Key, typename Hash, typename KeyEqual>
+inline const typename Rcu_Unordered_Set<Key, Hash, KeyEqual>::Node*
+		Rcu_Unordered_Set<Key, Hash, KeyEqual>::find_node(const BucketArray* array, const Key& key, std::size_t hash) const
+{
+	const Node* node = array->_heads[hash_finish<Hash>(hash) & array->_mask].load(std::memory_order_acquire);
+	while (node)
+	{
+		if (node->_hash == hash && _key_eq(node->_key, key))
+			return node;
+		node = node->_next.load(std::memory_order_acquire);
+	}
+	return nullptr;
+}
+
+template<typename Key, typename Hash, typename KeyEqual>
+inline bool Rcu_Unordered_Set<Key, Hash, KeyEqual>::contains(const key_type& key) const
+{
+	std::size_t hash = _hash_fn(key);
+	EpochGuard guard;
+	return find_node(_array.load(std::memory_order_acquire), key, hash) != nullptr;
+}
+
+template<typename Key, typename Hash, typename KeyEqual>
+inline typename Rcu_Unordered_Set<Key, Hash, KeyEqual>::size_type
+		Rcu_Unordered_Set<Key, Hash, KeyEqual>::count(const key_type& key) const
+{
+	return contains(key) ? 1 : 0;
+}
+
+template<typename Key, typename Hash, typename KeyEqual>
+template<typename F>
+inline bool Rcu_Unordered_Set<Key, Hash, KeyEqual>::visit(const key_type& key, F&& f) const
+{
+	std::size_t hash = _hash_fn(key);
+	EpochGuard guard;
+	const Node* node = find_node(_array.load(std::memory_order_acquire), key, hash);
+	if (!node)
+		return false;
+	f(node->_key);
+	return true;
+}
+
+template<typename Key, typename Hash, typename KeyEqual>
+template<typename F>
+void Rcu_Unordered_Set<Key, Hash, KeyEqual>::for_each(F&& f) const
+{
+	EpochGuard guard;
+	const BucketArray* array = _array.load(std::memory_order_acquire);
+	for (std::size_t i = 0; i <= array->_mask; ++i)
+		for (const Node* node = array->_heads[i].load(std::memory_order_acquire); node;
+				node = node->_next.load(std::memory_order_acquire))
+			f(node->_key);
+}
+
+// Relinking nodes in place could send a concurrent reader down the wrong
+// chain, so the new array gets copies and the old one is retired whole.
+template<typename Key, typename Hash, typename KeyEqual>
+void Rcu_Unordered_Set<Key, Hash, KeyEqual>::grow(BucketArray* array)
+{
+	std::unique_ptr<BucketArray> fresh(new BucketArray((array->_mask + 1) * 2));
+	try
+	{
+		for (std::size_t i = 0; i <= array->_mask; ++i)
+		{
+			for (Node* node = array->_heads[i].load(std::memory_order_relaxed); node;
+					node = node->_next.load(std::memory_order_relaxed))
+			{
+				Node* copy = new Node(node->_hash, node->_key);
+				std::atomic<Node*>& head = fresh->_heads[hash_finish<Hash>(node->_hash) & fresh->_mask];
+				copy->_next.store(head.load(std::memory_order_relaxed), std::memory_order_relaxed);
+				head.store(copy, std::memory_order_relaxed);
+			}
+		}
+	}
+	catch (...)
+	{
+		delete_array(fresh.release());
+		throw;
+	}
+
+	_array.store(fresh.release(), std::memory_order_release);
+	EpochDomain::instance().retire(array, &delete_array);
+}
+
+template<typename Key, typename Hash, typename KeyEqual>
+inline bool Rcu_Unordered_Set<Key, Hash, KeyEqual>::insert(const value_type& value)
+{
+	return emplace(value);
+}
+
+template<typename Key, typename Hash, typename KeyEqual>
+inline bool Rcu_Unordered_Set<Key, Hash, KeyEqual>::insert(value_type&& value)
+{
+	return emplace(std::move(value));
+}
+
+template<typename Key, typename Hash, typename KeyEqual>
+template<typename... Args>
+bool Rcu_Unordered_Set<Key, Hash, KeyEqual>::emplace(Args&&... args)
+{
+	std::unique_ptr<Node> node(new Node(0, std::forward<Args>(args)...));
+	node->_hash = _hash_fn(node->_key);
+
+	std::lock_guard<std::mutex> lock(_write_mutex);
+	BucketArray* array = _array.load(std::memory_order_relaxed);
+	if (find_node(array, node->_key, node->_hash))
+		return false;
+
+	std::size_t size = _size.load(std::memory_order_relaxed) + 1;
+	if (static_cast<float>(size) > _max_load.load(std::memory_order_relaxed) * static_cast<float>(array->_mask + 1))
+	{
+		grow(array);
+		array = _array.load(std::memory_order_relaxed);
+	}
+
+	std::atomic<Node*>& head = array->_heads[hash_finish<Hash>(node->_hash) & array->_mask];
+	node->_next.store(head.load(std::memory_order_relaxed), std::memory_order_relaxed);
+	head.store(node.release(), std::memory_order_release);
+	_size.store(size, std::memory_order_relaxed);
+	return true;
+}
+
+template<typename Key, typename Hash, typename KeyEqual>
+typename Rcu_Unordered_Set<Key, Hash, KeyEqual>::size_type
+		Rcu_Unordered_Set<Key, Hash, KeyEqual>::erase(const key_type& key)
+{
+	std::size_t hash = _hash_fn(key);
+
+	std::lock_guard<std::mutex> lock(_write_mutex);
+	BucketArray* array = _array.load(std::memory_order_relaxed);
+	std::atomic<Node*>* link = &array->_heads[hash_finish<Hash>(hash) & array->_mask];
+	while (Node* node = link->load(std::memory_order_relaxed))
+	{
+		if (node->_hash == hash && _key_eq(node->_key, key))
+		{
+			// Readers standing on the node can still follow its _next.
+			link->store(node->_next.load(std::memory_order_relaxed), std::memory_order_release);
+			_size.store(_size.load(std::memory_order_relaxed) - 1, std::memory_order_relaxed);
+			EpochDomain::instance().retire(node, &delete_node);
+			return 1;
+		}
+		link = &node->_next;
+	}
+	return 0;
+}
+
+template<typename Key, typename Hash, typename KeyEqual>
+void Rcu_Unordered_Set<Key, Hash, KeyEqual>::clear()
+{
+	std::lock_guard<std::mutex> lock(_write_mutex);
+	BucketArray* array = _array.load(std::memory_order_relaxed);
+	_array.store(new BucketArray(array->_mask + 1), std::memory_order_release);
+	_size.store(0, std::memory_order_relaxed);
+	EpochDomain::instance().retire(array, &delete_array);
+}
+
+template<typename Key, typename Hash, typename KeyEqual>
+inline typename Rcu_Unordered_Set<Key, Hash, KeyEqual>::size_type
+		Rcu_Unordered_Set<Key, Hash, KeyEqual>::size() const noexcept
+{
+	return _size.load(std::memory_order_relaxed);
+}
+
+template<typename Key, typename Hash, typename KeyEqual>
+inline bool Rcu_Unordered_Set<Key, Hash, KeyEqual>::empty() const noexcept
+{
+	return size() == 0;
+}
+
+template<typename Key, typename Hash, typename KeyEqual>
+inline typename Rcu_Unordered_Set<Key, Hash, KeyEqual>::size_type
+		Rcu_Unordered_Set<Key, Hash, KeyEqual>::bucket_count() const noexcept
+{
+	EpochGuard guard;
+	return _array.load(std::memory_order_acquire)->_mask + 1;
+}
+
+template<typename Key, typename Hash, typename KeyEqual>
+inline float Rcu_Unordered_Set<Key, Hash, KeyEqual>::max_load_factor() const noexcept
+{
+	return _max_load.load(std::memory_order_relaxed);
+}
+
+template<typename Key, typename Hash, typename KeyEqual>
+inline void Rcu_Unordered_Set<Key, Hash, KeyEqual>::max_load_factor(float ml) noexcept
+{
+	_max_load.store(ml, std::memory_order_relaxed);
+}
@@ -0,0 +1,1325 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+#include "HashTable.h"
+
+// Small-buffer backend for sets: up to N keys live inline in the table object
+// and are found by a linear scan, so a small set allocates nothing at all.
+// The first insert (or reserve()) that needs more room moves every key into
+// a Large table, built with the bucket count, load factors and parallelism
+// given so far; shrink_to_fit() moves the keys back once they fit again.
+// While inline there is a single bucket holding every key.
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator, std::size_t N, typename Large>
+class SmallHashTable
+{
+    static_assert(std::is_same<T, EmptyStruct>::value, "SmallHashTable only stores set keys");
+    static_assert(N > 0, "SmallHashTable needs room for at least one inline key");
+
+public:
+    using key_type = Key;
+    using mapped_type = T;
+    using hasher = Hash;
+    using key_equal = KeyEqual;
+    using size_type = std::size_t;
+    using value_type = Key;
+    using allocator_type = Allocator;
+
+    static constexpr size_type INLINE_CAPACITY = N;
+
+private:
+    // Exactly one member is alive: _keys[0, _count) while inline, _table
+    // once promoted.
+    union Contents
+    {
+        Contents() {}
+        ~Contents() {}
+
+        Key _keys[N];
+        Large _table;
+    };
+
+    // Scalar keys under plain == are scanned without an early exit, which
+    // leaves no data-dependent branch in the loop.
+    static constexpr bool BRANCHLESS_SCAN = std::is_scalar<Key>::value
+        && (std::is_same<KeyEqual, std::equal_to<Key>>::value || std::is_same<KeyEqual, std::equal_to<>>::value);
+
+    Contents _contents;
+    size_type _count = 0;
+    bool _large = false;
+    size_type _bucket_hint;
+    float _max_load = 0.75f;
+    float _min_load = 0.0f;
+    size_type _threads = 1;
+    Hash _hash_fn;
+    KeyEqual _key_eq;
+    Allocator _alloc;
+
+    Key* keys();
+    const Key* keys() const;
+
+    template<typename K>
+    size_type find_slot(const K& key) const;
+
+    template<typename... Args>
+    void construct_key(Args&&... args);
+    void erase_slot(size_type index);
+    void destroy_keys() noexcept;
+    void destroy() noexcept;
+
+    void copy_keys(const SmallHashTable& other);
+    void steal(SmallHashTable& other) noexcept;
+
+    void promote(size_type capacity);
+    void demote();
+
+    template<typename K, typename R>
+    using if_transparent = std::enable_if_t<is_transparent_lookup<Hash, KeyEqual, K>::value, R>;
+
+    // Tags the iterator constructor taking an inline key, which would clash
+    // with the Large one for a Large iterating by const Key* (DenseStorage).
+    struct InlineKey {};
+
+    // Output iterator handed to the Large table's find_batch: wraps each of
+    // its iterators before passing it on to out.
+    template<typename Iterator, typename OutputIt>
+    struct WrapOutput
+    {
+        OutputIt _out;
+
+        WrapOutput& operator*() { return *this; }
+        WrapOutput& operator++() { return *this; }
+        WrapOutput& operator++(int) { return *this; }
+
+        template<typename LargeIterator>
+        WrapOutput& operator=(const LargeIterator& it)
+        {
+            *_out = Iterator(it);
+            ++_out;
+            return *this;
+        }
+    };
+
+public:
+    template<bool IsConst>
+    class SmallIterator
+    {
+        using LargeIterator = std::conditional_t<IsConst, typename Large::const_iterator, typename Large::iterator>;
+
+        // Inline keys are walked by pointer, and _it only once promoted.
+        const Key* _key = nullptr;
+        LargeIterator _it;
+
+        friend class SmallHashTable;
+
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = Key;
+        using reference = const Key&;
+        using pointer = const Key*;
+        using difference_type = std::ptrdiff_t;
+
+        SmallIterator() = default;
+        SmallIterator(InlineKey, const Key* key);
+        explicit SmallIterator(LargeIterator it);
+
+        reference operator*() const;
+        pointer operator->() const;
+
+        SmallIterator& operator++();
+        SmallIterator operator++(int);
+
+        bool operator==(const SmallIterator& rhs) const;
+        bool operator!=(const SmallIterator& rhs) const;
+    };
+
+    using iterator = SmallIterator<false>;
+    using const_iterator = SmallIterator<true>;
+
+    // Handles come from the Large table; extracting an inline key moves it
+    // into a node first.
+    using node_type = typename Large::node_type;
+
+    struct insert_return_type
+    {
+        iterator position;
+        bool inserted;
+        node_type node;
+    };
+
+    // bucket_count is only used if the table is promoted.
+    explicit SmallHashTable(size_type bucket_count = 16, const hasher& hash = Hash(), const key_equal& equal = KeyEqual(),
+        const allocator_type& alloc = allocator_type());
+    SmallHashTable(const SmallHashTable& other);
+    SmallHashTable(SmallHashTable&& other) noexcept;
+    ~SmallHashTable();
+
+    SmallHashTable& operator=(const SmallHashTable& other);
+    SmallHashTable& operator=(SmallHashTable&& other) noexcept;
+
+    allocator_type get_allocator() const;
+    hasher hash_function() const;
+    key_equal key_eq() const;
+
+    bool is_inline() const noexcept;
+
+    std::pair<iterator, bool> insert(const value_type& value);
+    std::pair<iterator, bool> insert(value_type&& value);
+
+    template<typename... Args>
+    std::pair<iterator, bool> emplace(Args&&... args);
+
+    template<typename K>
+    if_transparent<K, std::pair<iterator, bool>> try_emplace(K&& key);
+
+    template<typename InputIt>
+    void insert_range(InputIt first, InputIt last);
+
+    template<typename OutputIt>
+    OutputIt find_batch(const key_type* keys, size_type count, OutputIt out);
+    template<typename OutputIt>
+    OutputIt find_batch(const key_type* keys, size_type count, OutputIt out) const;
+    template<typename OutputIt>
+    OutputIt contains_batch(const key_type* keys, size_type count, OutputIt out) const;
+
+    size_type insert_batch(const value_type* values, size_type count);
+
+    node_type extract(const_iterator pos);
+    node_type extract(iterator pos);
+    node_type extract(const key_type& key);
+
+    // On a duplicate key the element stays in the returned handle.
+    insert_return_type insert(node_type&& node);
+
+    void merge(SmallHashTable& source);
+    void merge(SmallHashTable&& source);
+
+    // Set algebra as in the Large table, which does the work when every
+    // table involved is promoted.
+    void insert_filtered(const SmallHashTable& source, const SmallHashTable& probe, bool present);
+    void erase_filtered(const SmallHashTable& probe, bool present);
+    bool is_subset_of(const SmallHashTable& other) const;
+
+    size_type erase(const key_type& key);
+    template<typename K>
+    if_transparent<K, size_type> erase(const K& key);
+
+    iterator find(const key_type& key);
+    const_iterator find(const key_type& key) const;
+    template<typename K>
+    if_transparent<K, iterator> find(const K& key);
+    template<typename K>
+    if_transparent<K, const_iterator> find(const K& key) const;
+
+    size_type count(const key_type& key) const;
+    template<typename K>
+    if_transparent<K, size_type> count(const K& key) const;
+
+    std::pair<iterator, iterator> equal_range(const key_type& key);
+    std::pair<const_iterator, const_iterator> equal_range(const key_type& key) const;
+    template<typename K>
+    if_transparent<K, std::pair<iterator, iterator>> equal_range(const K& key);
+    template<typename K>
+    if_transparent<K, std::pair<const_iterator, const_iterator>> equal_range(const K& key) const;
+
+    // Keeps the promoted table, like any clear() keeps its buckets.
+    void clear() noexcept;
+    size_type size() const noexcept;
+    bool empty() const noexcept;
+
+    size_type bucket_count() const;
+    size_type bucket_size(size_type index) const;
+    size_type bucket(const key_type& key) const;
+
+    float load_factor() const;
+    float max_load_factor() const;
+    void max_load_factor(float new_max);
+    float min_load_factor() const;
+    void min_load_factor(float new_min);
+
+    // Goes back to inline storage when size() <= N and moving a key cannot throw.
+    void shrink_to_fit();
+    void reserve(size_type n);
+
+    void parallelism(size_type threads);
+    size_type parallelism() const;
+
+    std::pair<const_iterator, const_iterator> subrange(size_type index, size_type parts) const;
+    size_type scan_parts() const;
+
+    template<typename F>
+    void parallel_for_each(F f) const;
+
+    // The Large table's, which holds the keys once there are more than N.
+    static constexpr size_type node_size = Large::node_size;
+
+    // Heap bytes held: nothing while inline, the Large table's after. Inline
+    // keys still report what they own themselves through key_bytes.
+    MemoryUsage memory_usage() const;
+    template<typename KeyBytes>
+    MemoryUsage memory_usage(KeyBytes key_bytes) const;
+
+    void swap(SmallHashTable& other) noexcept;
+
+    iterator begin();
+    iterator end();
+    const_iterator begin() const;
+    const_iterator end() const;
+    const_iterator cbegin() const;
+    const_iterator cend() const;
+
+    bool operator==(const SmallHashTable& other) const;
+    bool operator!=(const SmallHashTable& other) const;
+};
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator, std::size_t N, typename Large>
+template<bool IsConst>
+inline SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::SmallIterator<IsConst>::SmallIterator(InlineKey, const Key* key)
+    : _key(key)
+{
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator, std::size_t N, typename Large>
+template<bool IsConst>
+inline SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::SmallIterator<IsConst>::SmallIterator(LargeIterator it)
+    : _it(std::move(it))
+{
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator, std::size_t N, typename Large>
+template<bool IsConst>
+inline typename SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::template SmallIterator<IsConst>::reference
+            SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::SmallIterator<IsConst>::operator*() const
+{
+    return _key ? *_key : *_it;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator, std::size_t N, typename Large>
+template<bool IsConst>
+inline typename SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::template SmallIterator<IsConst>::pointer
+            SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::SmallIterator<IsConst>::operator->() const
+{
+    return &**this;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator, std::size_t N, typename Large>
+template<bool IsConst>
+inline typename SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::template SmallIterator<IsConst>&
+            SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::SmallIterator<IsConst>::operator++()
+{
+    if (_key)
+        ++_key;
+    else
+        ++_it;
+    return *this;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator, std::size_t N, typename Large>
+template<bool IsConst>
+inline typename SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::template SmallIterator<IsConst>
+            SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::SmallIterator<IsConst>::operator++(int)
+{
+    SmallIterator temp = *this;
+    ++*this;
+    return temp;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator, std::size_t N, typename Large>
+template<bool IsConst>
+inline bool SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::SmallIterator<IsConst>::operator==(const SmallIterator& rhs) const
+{
+    return _key == rhs._key && (_key || _it == rhs._it);
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator, std::size_t N, typename Large>
+template<bool IsConst>
+inline bool SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::SmallIterator<IsConst>::operator!=(const SmallIterator& rhs) const
+{
+    return !(*this == rhs);
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator, std::size_t N, typename Large>
+inline Key* SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::keys()
+{
+    return _contents._keys;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator, std::size_t N, typename Large>
+inline const Key* SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::keys() const
+{
+    return _contents._keys;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator, std::size_t N, typename Large>
+template<typename K>
+inline typename SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::size_type
+            SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::find_slot(const K& key) const
+{
+    // Returns _count when the key is missing.
+    const Key* first = keys();
+    if constexpr (BRANCHLESS_SCAN && std::is_same<K, Key>::value)
+    {
+        size_type found = _count;
+        for (size_type i = 0; i < _count; ++i)
+            found = first[i] == key ? i : found;
+        return found;
+    }
+    else
+    {
+        for (size_type i = 0; i < _count; ++i)
+        {
+            if (_key_eq(first[i], key))
+                return i;
+        }
+        return _count;
+    }
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator, std::size_t N, typename Large>
+template<typename... Args>
+inline void SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::construct_key(Args&&... args)
+{
+    ::new (static_cast<void*>(keys() + _count)) Key(std::forward<Args>(args)...);
+    ++_count;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator, std::size_t N, typename Large>
+inline void SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::erase_slot(size_type index)
+{
+    // The last key fills the hole, so inline keys stay contiguous.
+    Key* first = keys();
+    if (index + 1 != _count)
+        first[index] = std::move(first[_count - 1]);
+    first[_count - 1].~Key();
+    --_count;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator, std::size_t N, typename Large>
+inline void SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::destroy_keys() noexcept
+{
+    Key* first = keys();
+    for (size_type i = 0; i < _count; ++i)
+        first[i].~Key();
+    _count = 0;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator, std::size_t N, typename Large>
+inline void SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::destroy() noexcept
+{
+    if (_large)
+    {
+        _contents._table.~Large();
+        _large = false;
+    }
+    else
+    {
+        destroy_keys();
+    }
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator, std::size_t N, typename Large>
+void SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::copy_keys(const SmallHashTable& other)
+{
+    try
+    {
+        for (size_type i = 0; i < other._count; ++i)
+            construct_key(other.keys()[i]);
+    }
+    catch (...)
+    {
+        destroy_keys();
+        throw;
+    }
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator, std::size_t N, typename Large>
+void SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::steal(SmallHashTable& other) noexcept
+{
+    // Expects this to be inline and empty.
+    if (other._large)
+    {
+        ::new (static_cast<void*>(&_contents._table)) Large(std::move(other._contents._table));
+        _large = true;
+    }
+    else
+    {
+        for (size_type i = 0; i < other._count; ++i)
+            construct_key(std::move(other.keys()[i]));
+        other.destroy_keys();
+    }
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator, std::size_t N, typename Large>
+void SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::promote(size_type capacity)
+{
+    size_type wanted = static_cast<size_type>(std::ceil(capacity / _max_load));
+    Large table(std::max(_bucket_hint, wanted), _hash_fn, _key_eq, _alloc);
+    table.max_load_factor(_max_load);
+    table.parallelism(_threads);
+
+    // Keys are moved only when that cannot throw, and then moved back if an
+    // allocation fails, so the inline keys survive a failed promotion.
+    Key* first = keys();
+    try
+    {
+        for (size_type i = 0; i < _count; ++i)
+            table.insert(std::move_if_noexcept(first[i]));
+    }
+    catch (...)
+    {
+        if constexpr (std::is_nothrow_move_constructible<Key>::value)
+        {
+            for (size_type i = 0; !table.empty(); ++i)
+            {
+                first[i].~Key();
+                ::new (static_cast<void*>(first + i)) Key(std::move(table.extract(table.begin()).value()));
+            }
+        }
+        throw;
+    }
+    table.min_load_factor(_min_load);
+
+    destroy_keys();
+    ::new (static_cast<void*>(&_contents._table)) Large(std::move(table));
+    _large = true;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator, std::size_t N, typename Large>
+void SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::demote()
+{
+    Large table(std::move(_contents._table));
+    _contents._table.~Large();
+    _large = false;
+
+    _max_load = table.max_load_factor();
+    _min_load = table.min_load_factor();
+    _threads = table.parallelism();
+    // Extracting must not shrink (and so allocate) under us.
+    table.min_load_factor(0.0f);
+    while (!table.empty())
+        construct_key(std::move(table.extract(table.begin()).value()));
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator, std::size_t N, typename Large>
+inline SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::SmallHashTable(size_type bucket_count, const hasher& hash, const key_equal& equal,
+            const allocator_type& alloc)
+    : _bucket_hint(bucket_count)
+    , _hash_fn(hash)
+    , _key_eq(equal)
+    , _alloc(alloc)
+{
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator, std::size_t N, typename Large>
+SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::SmallHashTable(const SmallHashTable& other)
+    : _bucket_hint(other._bucket_hint)
+    , _max_load(other._max_load)
+    , _min_load(other._min_load)
+    , _threads(other._threads)
+    , _hash_fn(other._hash_fn)
+    , _key_eq(other._key_eq)
+    , _alloc(std::allocator_traits<Allocator>::select_on_container_copy_construction(other._alloc))
+{
+    if (other._large)
+    {
+        ::new (static_cast<void*>(&_contents._table)) Large(other._contents._table);
+        _large = true;
+    }
+    else
+    {
+        copy_keys(other);
+    }
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator, std::size_t N, typename Large>
+SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::SmallHashTable(SmallHashTable&& other) noexcept
+    : _bucket_hint(other._bucket_hint)
+    , _max_load(other._max_load)
+    , _min_load(other._min_load)
+    , _threads(other._threads)
+    , _hash_fn(std::move(other._hash_fn))
+    , _key_eq(std::move(other._key_eq))
+    , _alloc(std::move(other._alloc))
+{
+    steal(other);
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator, std::size_t N, typename Large>
+inline SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::~SmallHashTable()
+{
+    destroy();
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator, std::size_t N, typename Large>
+SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>&
+            SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::operator=(const SmallHashTable& other)
+{
+    if (this == &other)
+        return *this;
+
+    // Two promoted tables reuse the nodes already allocated here.
+    if (_large && other._large)
+    {
+        _contents._table = other._contents._table;
+        _bucket_hint = other._bucket_hint;
+        _hash_fn = other._hash_fn;
+        _key_eq = other._key_eq;
+    }
+    else
+    {
+        SmallHashTable copy(other);
+        *this = std::move(copy);
+    }
+    return *this;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator, std::size_t N, typename Large>
+SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>&
+            SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::operator=(SmallHashTable&& other) noexcept
+{
+    if (this == &other)
+        return *this;
+
+    destroy();
+    _bucket_hint = other._bucket_hint;
+    _max_load = other._max_load;
+    _min_load = other._min_load;
+    _threads = other._threads;
+    _hash_fn = std::move(other._hash_fn);
+    _key_eq = std::move(other._key_eq);
+    _alloc = std::move(other._alloc);
+    steal(other);
+    return *this;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator, std::size_t N, typename Large>
+inline typename SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::allocator_type
+            SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::get_allocator() const
+{
+    return _large ? allocator_type(_contents._table.get_allocator()) : _alloc;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator, std::size_t N, typename Large>
+inline typename SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::hasher
+            SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::hash_function() const
+{
+    return _hash_fn;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator, std::size_t N, typename Large>
+inline typename SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::key_equal
+            SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::key_eq() const
+{
+    return _key_eq;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator, std::size_t N, typename Large>
+inline bool SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::is_inline() const noexcept
+{
+    return !_large;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator, std::size_t N, typename Large>
+std::pair<typename SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::iterator, bool>
+            SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::insert(const value_type& value)
+{
+    return emplace(value);
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator, std::size_t N, typename Large>
+std::pair<typename SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::iterator, bool>
+            SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::insert(value_type&& value)
+{
+    return emplace(std::move(value));
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator, std::size_t N, typename Large>
+template<typename... Args>
+std::pair<typename SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::iterator, bool>
+            SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::emplace(Args&&... args)
+{
+    if (_large)
+    {
+        auto [it, inserted] = _contents._table.emplace(std::forward<Args>(args)...);
+        return { iterator(it), inserted };
+    }
+
+    if constexpr (emplace_key_extractable<Key, T, Args...>::value)
+    {
+        size_type index = find_slot(emplace_key<Key>(args...));
+        if (index != _count)
+            return { iterator(InlineKey(), keys() + index), false };
+        if (_count == N)
+        {
+            promote(_count + 1);
+            auto [it, inserted] = _contents._table.emplace(std::forward<Args>(args)...);
+            return { iterator(it), inserted };
+        }
+        construct_key(std::forward<Args>(args)...);
+        return { iterator(InlineKey(), keys() + _count - 1), true };
+    }
+    else
+    {
+        return emplace(Key(std::forward<Args>(args)...));
+    }
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator, std::size_t N, typename Large>
+template<typename K>
+typename SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::template if_transparent<K, std::pair<typename SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::iterator, bool>>
+            SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::try_emplace(K&& key)
+{
+    if (!_large)
+    {
+        size_type index = find_slot(key);
+        if (index != _count)
+            return { iterator(InlineKey(), keys() + index), false };
+        if (_count < N)
+        {
+            construct_key(std::forward<K>(key));
+            return { iterator(InlineKey(), keys() + _count - 1), true };
+        }
+        promote(_count + 1);
+    }
+    auto [it, inserted] = _contents._table.try_emplace(std::forward<K>(key));
+    return { iterator(it), inserted };
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator, std::size_t N, typename Large>
+template<typename InputIt>
+void SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::insert_range(InputIt first, InputIt last)
+{
+    for (; first != last && !_large; ++first)
+        emplace(*first);
+    if (_large)
+        _contents._table.insert_range(first, last);
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator, std::size_t N, typename Large>
+template<typename OutputIt>
+OutputIt SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::find_batch(const key_type* keys, size_type count, OutputIt out)
+{
+    if (_large)
+        return _contents._table.find_batch(keys, count, WrapOutput<iterator, OutputIt>{ out })._out;
+    for (size_type i = 0; i < count; ++i)
+        *out++ = find(keys[i]);
+    return out;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator, std::size_t N, typename Large>
+template<typename OutputIt>
+OutputIt SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::find_batch(const key_type* keys, size_type count, OutputIt out) const
+{
+    if (_large)
+        return _contents._table.find_batch(keys, count, WrapOutput<const_iterator, OutputIt>{ out })._out;
+    for (size_type i = 0; i < count; ++i)
+        *out++ = find(keys[i]);
+    return out;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator, std::size_t N, typename Large>
+template<typename OutputIt>
+OutputIt SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::contains_batch(const key_type* keys, size_type count, OutputIt out) const
+{
+    if (_large)
+        return _contents._table.contains_batch(keys, count, out);
+    for (size_type i = 0; i < count; ++i)
+        *out++ = find_slot(keys[i]) != _count;
+    return out;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator, std::size_t N, typename Large>
+typename SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::size_type
+            SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::insert_batch(const value_type* values, size_type count)
+{
+    size_type added = 0;
+    size_type i = 0;
+    for (; i < count && !_large; ++i)
+        added += emplace(values[i]).second;
+    if (i < count)
+        added += _contents._table.insert_batch(values + i, count - i);
+    return added;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator, std::size_t N, typename Large>
+typename SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::node_type
+            SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::extract(const_iterator pos)
+{
+    if (_large)
+        return _contents._table.extract(pos._it);
+
+    // The key goes into a node of a throwaway Large table, as node handles
+    // can only own memory that table type allocated.
+    size_type index = static_cast<size_type>(pos._key - keys());
+    Large holder(1, _hash_fn, _key_eq, _alloc);
+    auto it = holder.insert(std::move_if_noexcept(keys()[index])).first;
+    erase_slot(index);
+    return holder.extract(it);
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator, std::size_t N, typename Large>
+typename SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::node_type
+            SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::extract(iterator pos)
+{
+    if (_large)
+        return _contents._table.extract(pos._it);
+    return extract(const_iterator(InlineKey(), pos._key));
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator, std::size_t N, typename Large>
+typename SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::node_type
+            SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::extract(const key_type& key)
+{
+    if (_large)
+        return _contents._table.extract(key);
+    size_type index = find_slot(key);
+    if (index == _count)
+        return node_type();
+    return extract(const_iterator(InlineKey(), keys() + index));
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator, std::size_t N, typename Large>
+typename SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::insert_return_type
+            SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::insert(node_type&& node)
+{
+    if (!_large)
+    {
+        if (node.empty())
+            return { end(), false, node_type() };
+
+        size_type index = find_slot(node.value());
+        if (index != _count)
+            return { iterator(InlineKey(), keys() + index), false, std::move(node) };
+        if (_count < N)
+        {
+            construct_key(std::move(node.value()));
+            node = node_type();
+            return { iterator(InlineKey(), keys() + _count - 1), true, node_type() };
+        }
+        promote(_count + 1);
+    }
+    auto result = _contents._table.insert(std::move(node));
+    return { iterator(result.position), result.inserted, std::move(result.node) };
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator, std::size_t N, typename Large>
+void SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::merge(SmallHashTable& source)
+{
+    if (&source == this)
+        return;
+
+    if (source._large)
+    {
+        if (!_large)
+            promote(_count + source.size());
+        _contents._table.merge(source._contents._table);
+        return;
+    }
+
+    // Walking backwards, erase_slot only ever refills a hole with a key
+    // that was already looked at.
+    Key* from = source.keys();
+    for (size_type i = source._count; i-- > 0;)
+    {
+        if (count(from[i]))
+            continue;
+        emplace(std::move(from[i]));
+        source.erase_slot(i);
+    }
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator, std::size_t N, typename Large>
+inline void SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::merge(SmallHashTable&& source)
+{
+    merge(source);
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator, std::size_t N, typename Large>
+void SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::insert_filtered(const SmallHashTable& source, const SmallHashTable& probe, bool present)
+{
+    // A result that may not fit inline is promoted up front, so the Large
+    // table can reuse the hashes it keeps instead of rehashing every key.
+    size_type most = present ? std::min(source.size(), probe.size()) : source.size();
+    if (!_large && source._large && probe._large && _count + most > N)
+        promote(_count + most);
+
+    if (_large && source._large && probe._large)
+    {
+        _contents._table.insert_filtered(source._contents._table, probe._contents._table, present);
+        return;
+    }
+
+    const SmallHashTable* scan = &source;
+    const SmallHashTable* other = &probe;
+    if (present && probe.size() < source.size())
+        std::swap(scan, other);
+    if (scan == this || (other == this && present))
+        return;
+
+    for (const Key& key : *scan)
+    {
+        if ((other->count(key) != 0) == present)
+            emplace(key);
+    }
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator, std::size_t N, typename Large>
+void SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::erase_filtered(const SmallHashTable& probe, bool present)
+{
+    if (&probe == this)
+    {
+        if (present)
+            clear();
+        return;
+    }
+
+    if (!_large)
+    {
+        for (size_type i = _count; i-- > 0;)
+        {
+            if ((probe.count(keys()[i]) != 0) == present)
+                erase_slot(i);
+        }
+        return;
+    }
+
+    if (probe._large)
+    {
+        _contents._table.erase_filtered(probe._contents._table, present);
+    }
+    else if (present)
+    {
+        for (const Key& key : probe)
+            _contents._table.erase(key);
+    }
+    else
+    {
+        // At most N keys: index them once rather than scan them per element.
+        Large lookup(probe._count, _hash_fn, _key_eq, _alloc);
+        for (const Key& key : probe)
+            lookup.insert(key);
+        _contents._table.erase_filtered(lookup, false);
+    }
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator, std::size_t N, typename Large>
+bool SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::is_subset_of(const SmallHashTable& other) const
+{
+    if (_large && other._large)
+        return _contents._table.is_subset_of(other._contents._table);
+    if (size() > other.size())
+        return false;
+    for (const Key& key : *this)
+    {
+        if (!other.count(key))
+            return false;
+    }
+    return true;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator, std::size_t N, typename Large>
+typename SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::size_type
+            SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::erase(const key_type& key)
+{
+    if (_large)
+        return _contents._table.erase(key);
+    size_type index = find_slot(key);
+    if (index == _count)
+        return 0;
+    erase_slot(index);
+    return 1;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator, std::size_t N, typename Large>
+template<typename K>
+typename SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::template if_transparent<K, typename SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::size_type>
+            SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::erase(const K& key)
+{
+    if (_large)
+        return _contents._table.erase(key);
+    size_type index = find_slot(key);
+    if (index == _count)
+        return 0;
+    erase_slot(index);
+    return 1;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator, std::size_t N, typename Large>
+inline typename SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::iterator
+            SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::find(const key_type& key)
+{
+    if (_large)
+        return iterator(_contents._table.find(key));
+    return iterator(InlineKey(), keys() + find_slot(key));
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator, std::size_t N, typename Large>
+inline typename SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::const_iterator
+            SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::find(const key_type& key) const
+{
+    if (_large)
+        return const_iterator(_contents._table.find(key));
+    return const_iterator(InlineKey(), keys() + find_slot(key));
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator, std::size_t N, typename Large>
+template<typename K>
+inline typename SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::template if_transparent<K, typename SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::iterator>
+            SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::find(const K& key)
+{
+    if (_large)
+        return iterator(_contents._table.find(key));
+    return iterator(InlineKey(), keys() + find_slot(key));
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator, std::size_t N, typename Large>
+template<typename K>
+inline typename SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::template if_transparent<K, typename SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::const_iterator>
+            SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::find(const K& key) const
+{
+    if (_large)
+        return const_iterator(_contents._table.find(key));
+    return const_iterator(InlineKey(), keys() + find_slot(key));
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator, std::size_t N, typename Large>
+inline typename SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::size_type
+            SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::count(const key_type& key) const
+{
+    if (_large)
+        return _contents._table.count(key);
+    return find_slot(key) != _count;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator, std::size_t N, typename Large>
+template<typename K>
+inline typename SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::template if_transparent<K, typename SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::size_type>
+            SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::count(const K& key) const
+{
+    if (_large)
+        return _contents._table.count(key);
+    return find_slot(key) != _count;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator, std::size_t N, typename Large>
+std::pair<typename SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::iterator, typename SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::iterator>
+            SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::equal_range(const key_type& key)
+{
+    iterator it = find(key);
+    if (it == end())
+        return { it, it };
+    return { it, std::next(it) };
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator, std::size_t N, typename Large>
+std::pair<typename SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::const_iterator, typename SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::const_iterator>
+            SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::equal_range(const key_type& key) const
+{
+    const_iterator it = find(key);
+    if (it == end())
+        return { it, it };
+    return { it, std::next(it) };
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator, std::size_t N, typename Large>
+template<typename K>
+typename SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::template if_transparent<K, std::pair<typename SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::iterator, typename SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::iterator>>
+            SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::equal_range(const K& key)
+{
+    iterator it = find(key);
+    if (it == end())
+        return { it, it };
+    return { it, std::next(it) };
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator, std::size_t N, typename Large>
+template<typename K>
+typename SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::template if_transparent<K, std::pair<typename SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::const_iterator, typename SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::const_iterator>>
+            SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::equal_range(const K& key) const
+{
+    const_iterator it = find(key);
+    if (it == end())
+        return { it, it };
+    return { it, std::next(it) };
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator, std::size_t N, typename Large>
+inline void SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::clear() noexcept
+{
+    if (_large)
+        _contents._table.clear();
+    else
+        destroy_keys();
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator, std::size_t N, typename Large>
+inline typename SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::size_type
+            SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::size() const noexcept
+{
+    return _large ? _contents._table.size() : _count;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator, std::size_t N, typename Large>
+inline bool SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::empty() const noexcept
+{
+    return size() == 0;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator, std::size_t N, typename Large>
+inline typename SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::size_type
+            SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::bucket_count() const
+{
+    return _large ? _contents._table.bucket_count() : 1;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator, std::size_t N, typename Large>
+inline typename SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::size_type
+            SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::bucket_size(size_type index) const
+{
+    if (_large)
+        return _contents._table.bucket_size(index);
+    return index == 0 ? _count : 0;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator, std::size_t N, typename Large>
+inline typename SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::size_type
+            SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::bucket(const key_type& key) const
+{
+    return _large ? _contents._table.bucket(key) : 0;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator, std::size_t N, typename Large>
+inline float SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::load_factor() const
+{
+    return _large ? _contents._table.load_factor() : static_cast<float>(_count);
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator, std::size_t N, typename Large>
+inline float SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::max_load_factor() const
+{
+    return _large ? _contents._table.max_load_factor() : _max_load;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator, std::size_t N, typename Large>
+inline void SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::max_load_factor(float new_max)
+{
+    if (_large)
+        _contents._table.max_load_factor(new_max);
+    else
+        _max_load = new_max;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator, std::size_t N, typename Large>
+inline float SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::min_load_factor() const
+{
+    return _large ? _contents._table.min_load_factor() : _min_load;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator, std::size_t N, typename Large>
+inline void SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::min_load_factor(float new_min)
+{
+    if (_large)
+        _contents._table.min_load_factor(new_min);
+    else
+        _min_load = new_min;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator, std::size_t N, typename Large>
+void SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::shrink_to_fit()
+{
+    if (!_large)
+        return;
+    if constexpr (std::is_nothrow_move_constructible<Key>::value)
+    {
+        if (_contents._table.size() <= N)
+        {
+            demote();
+            return;
+        }
+    }
+    _contents._table.shrink_to_fit();
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator, std::size_t N, typename Large>
+void SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::reserve(size_type n)
+{
+    if (_large)
+        _contents._table.reserve(n);
+    else if (n > N)
+        promote(n);
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator, std::size_t N, typename Large>
+inline void SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::parallelism(size_type threads)
+{
+    if (_large)
+        _contents._table.parallelism(threads);
+    else
+        _threads = threads ? threads : std::max<size_type>(1, std::thread::hardware_concurrency());
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator, std::size_t N, typename Large>
+inline typename SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::size_type
+            SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::parallelism() const
+{
+    return _large ? _contents._table.parallelism() : _threads;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator, std::size_t N, typename Large>
+std::pair<typename SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::const_iterator, typename SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::const_iterator>
+            SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::subrange(size_type index, size_type parts) const
+{
+    if (_large)
+    {
+        auto [first, last] = _contents._table.subrange(index, parts);
+        return { const_iterator(first), const_iterator(last) };
+    }
+    if (index == 0)
+        return { begin(), end() };
+    return { end(), end() };
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator, std::size_t N, typename Large>
+inline typename SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::size_type
+            SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::scan_parts() const
+{
+    return _large ? _contents._table.scan_parts() : 1;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator, std::size_t N, typename Large>
+template<typename F>
+void SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::parallel_for_each(F f) const
+{
+    if (_large)
+    {
+        _contents._table.parallel_for_each(f);
+        return;
+    }
+    for (size_type i = 0; i < _count; ++i)
+        f(keys()[i]);
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator, std::size_t N, typename Large>
+MemoryUsage SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::memory_usage() const
+{
+    return _large ? _contents._table.memory_usage() : MemoryUsage();
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator, std::size_t N, typename Large>
+template<typename KeyBytes>
+MemoryUsage SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::memory_usage(KeyBytes key_bytes) const
+{
+    if (_large)
+        return _contents._table.memory_usage(key_bytes);
+    MemoryUsage usage;
+    for (size_type i = 0; i < _count; ++i)
+        usage.key_heap += key_bytes(keys()[i]);
+    return usage;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator, std::size_t N, typename Large>
+void SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::swap(SmallHashTable& other) noexcept
+{
+    if (this == &other)
+        return;
+    if (_large && other._large)
+    {
+        using std::swap;
+        _contents._table.swap(other._contents._table);
+        swap(_bucket_hint, other._bucket_hint);
+        swap(_hash_fn, other._hash_fn);
+        swap(_key_eq, other._key_eq);
+        swap(_alloc, other._alloc);
+        return;
+    }
+
+    SmallHashTable temp(std::move(other));
+    other = std::move(*this);
+    *this = std::move(temp);
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator, std::size_t N, typename Large>
+inline typename SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::iterator
+            SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::begin()
+{
+    return _large ? iterator(_contents._table.begin()) : iterator(InlineKey(), keys());
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator, std::size_t N, typename Large>
+inline typename SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::iterator
+            SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::end()
+{
+    return _large ? iterator(_contents._table.end()) : iterator(InlineKey(), keys() + _count);
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator, std::size_t N, typename Large>
+inline typename SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::const_iterator
+            SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::begin() const
+{
+    return _large ? const_iterator(_contents._table.begin()) : const_iterator(InlineKey(), keys());
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator, std::size_t N, typename Large>
+inline typename SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::const_iterator
+            SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::end() const
+{
+    return _large ? const_iterator(_contents._table.end()) : const_iterator(InlineKey(), keys() + _count);
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator, std::size_t N, typename Large>
+inline typename SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::const_iterator
+            SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::cbegin() const
+{
+    return begin();
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator, std::size_t N, typename Large>
+inline typename SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::const_iterator
+            SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::cend() const
+{
+    return end();
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator, std::size_t N, typename Large>
+bool SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::operator==(const SmallHashTable& other) const
+{
+    if (_large && other._large)
+        return _contents._table == other._contents._table;
+    if (size() != other.size())
+        return false;
+    for (const Key& key : *this)
+    {
+        if (!other.count(key))
+            return false;
+    }
+    return true;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator, std::size_t N, typename Large>
+inline bool SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, Large>::operator!=(const SmallHashTable& other) const
+{
+    return !(*this == other);
+}
+
+template<typename K, typename M, typename H, typename E, typename A, std::size_t N, typename L>
+inline void swap(SmallHashTable<K, M, H, E, A, N, L>& lhs, SmallHashTable<K, M, H, E, A, N, L>& rhs) noexcept
+{
+    lhs.swap(rhs);
+}
+
+// Keeps up to N keys inline, then moves to the table Inner selects.
+template<std::size_t N = 8, typename Inner = ChainedStorage<>>
+struct SmallStorage
+{
+    template<typename Key, typename T, typename Hash, typename KeyEqual, typename Allocator>
+    using table = SmallHashTable<Key, T, Hash, KeyEqual, Allocator, N, typename Inner::template table<Key, T, Hash, KeyEqual, Allocator>>;
+};
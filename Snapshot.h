@@ -0,0 +1,282 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "BucketPolicy.h"
+#include "Unordered_Set.h"
+
+// Snapshots of an Unordered_Set on disk. Trivially copyable keys are written
+// as a ready-made open-addressing table, one control byte per slot followed
+// by the slots themselves, which Mapped_Unordered_Set serves straight from
+// the page cache and load_snapshot() copies out. Other keys are written as
+// a plain sequence of records through snapshot_traits. Slots are placed by
+// Hash, so a mapped table must be read with a Hash that gives the same
+// values as the one it was written with.
+
+constexpr char SNAPSHOT_MAGIC[8] = { 'U', 'S', 'E', 'T', 'S', 'N', 'A', 'P' };
+constexpr std::uint32_t SNAPSHOT_VERSION = 1;
+// Written in host byte order; reads back byte-swapped on a host of the other.
+constexpr std::uint32_t SNAPSHOT_BYTE_ORDER = 0x01020304;
+
+enum class SnapshotLayout : std::uint32_t
+{
+    Table = 1,
+    Records = 2,
+};
+
+struct SnapshotHeader
+{
+    char _magic[8];
+    std::uint32_t _version;
+    std::uint32_t _byte_order;
+    SnapshotLayout _layout;
+    // sizeof and alignof the key for a table, 0 for records.
+    std::uint32_t _key_size;
+    std::uint32_t _key_align;
+    // sizeof(std::size_t) of the writer, which its hashes were taken at.
+    std::uint32_t _word_size;
+    std::uint64_t _count;
+    // Table only: slot count (a power of two) and where the slots start.
+    std::uint64_t _capacity;
+    std::uint64_t _slots_offset;
+    std::uint64_t _reserved;
+};
+
+static_assert(sizeof(SnapshotHeader) == 64, "snapshot header layout changed");
+
+// Control byte of a table slot: 0 when empty, otherwise the high bit and
+// seven more bits of the mixed hash.
+inline std::uint8_t snapshot_tag(std::size_t hash)
+{
+    return static_cast<std::uint8_t>(0x80 | (hash >> (sizeof(std::size_t) * 8 - 7)));
+}
+
+// At most half full, so a miss ends after a couple of slots.
+inline std::uint64_t snapshot_capacity(std::uint64_t count)
+{
+    std::uint64_t capacity = 16;
+    while (capacity < count * 2)
+        capacity *= 2;
+    return capacity;
+}
+
+inline std::uint64_t snapshot_slots_offset(std::uint64_t capacity, std::size_t key_align)
+{
+    std::uint64_t align = std::max<std::uint64_t>(key_align, 64);
+    return (sizeof(SnapshotHeader) + capacity + align - 1) / align * align;
+}
+
+// Throws unless header describes a snapshot this build can read as Key.
+template<typename Key>
+void check_snapshot_header(const SnapshotHeader& header, const std::string& path)
+{
+    if (std::memcmp(header._magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0)
+        throw std::runtime_error("snapshot: " + path + " is not a set snapshot");
+    if (header._byte_order != SNAPSHOT_BYTE_ORDER)
+        throw std::runtime_error("snapshot: " + path + " was written with the other byte order");
+    if (header._version != SNAPSHOT_VERSION)
+        throw std::runtime_error("snapshot: " + path + " has unsupported version " + std::to_string(header._version));
+    if (header._layout == SnapshotLayout::Table
+        && (header._key_size != sizeof(Key) || header._key_align != alignof(Key)
+            || header._word_size != sizeof(std::size_t)))
+        throw std::runtime_error("snapshot: " + path + " holds a different key type");
+}
+
+// Throws unless the table header describes fits in a file of length bytes:
+// a power-of-two slot count above _count, the control bytes between the
+// header and the slots, and aligned slots that end inside the file. Every
+// bound is checked by subtraction, so no corrupt field can overflow it.
+template<typename Key>
+void check_snapshot_table(const SnapshotHeader& header, std::uint64_t length, const std::string& path)
+{
+    std::uint64_t capacity = header._capacity;
+    std::uint64_t offset = header._slots_offset;
+    if (capacity == 0 || (capacity & (capacity - 1)) != 0 || header._count >= capacity
+        || capacity > std::numeric_limits<std::size_t>::max() / sizeof(Key))
+        throw std::runtime_error("snapshot: " + path + " has a corrupt table header");
+    if (offset < sizeof(SnapshotHeader) || offset - sizeof(SnapshotHeader) < capacity || offset % alignof(Key) != 0)
+        throw std::runtime_error("snapshot: " + path + " has a corrupt table header");
+    if (offset > length || (length - offset) / sizeof(Key) < capacity)
+        throw std::runtime_error("snapshot: " + path + " is truncated");
+}
+
+// Throws unless exactly _count of the control bytes are set. With _count
+// below _capacity that leaves an empty slot for every probe to stop at.
+inline void check_snapshot_ctrl(const std::uint8_t* ctrl, const SnapshotHeader& header, const std::string& path)
+{
+    std::uint64_t used = 0;
+    for (std::uint64_t i = 0; i < header._capacity; ++i)
+        used += ctrl[i] != 0;
+    if (used != header._count)
+        throw std::runtime_error("snapshot: " + path + " has a corrupt table");
+}
+
+// Record format for keys that are not trivially copyable. Specialize with
+//   static void write(std::ostream&, const Key&);
+//   static Key read(std::istream&);
+template<typename Key>
+struct snapshot_traits;
+
+template<>
+struct snapshot_traits<std::string>
+{
+    static void write(std::ostream& out, const std::string& key)
+    {
+        std::uint64_t length = key.size();
+        out.write(reinterpret_cast<const char*>(&length), sizeof(length));
+        out.write(key.data(), static_cast<std::streamsize>(key.size()));
+    }
+
+    static std::string read(std::istream& in)
+    {
+        std::uint64_t length = 0;
+        in.read(reinterpret_cast<char*>(&length), sizeof(length));
+        // Grown as the bytes arrive, so a corrupt length runs out of file
+        // rather than memory.
+        std::string key;
+        char buffer[4096];
+        while (in && key.size() < length)
+        {
+            std::size_t chunk = static_cast<std::size_t>(std::min<std::uint64_t>(sizeof(buffer), length - key.size()));
+            in.read(buffer, static_cast<std::streamsize>(chunk));
+            key.append(buffer, static_cast<std::size_t>(in.gcount()));
+        }
+        return key;
+    }
+};
+
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator, typename Storage>
+void save_snapshot(const Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>& set, const std::string& path)
+{
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out)
+        throw std::runtime_error("snapshot: cannot create " + path);
+
+    SnapshotHeader header{};
+    std::memcpy(header._magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+    header._version = SNAPSHOT_VERSION;
+    header._byte_order = SNAPSHOT_BYTE_ORDER;
+    header._word_size = sizeof(std::size_t);
+    header._count = set.size();
+
+    if constexpr (std::is_trivially_copyable<Key>::value)
+    {
+        std::uint64_t capacity = snapshot_capacity(set.size());
+        std::uint64_t mask = capacity - 1;
+        header._layout = SnapshotLayout::Table;
+        header._key_size = sizeof(Key);
+        header._key_align = alignof(Key);
+        header._capacity = capacity;
+        header._slots_offset = snapshot_slots_offset(capacity, alignof(Key));
+
+        std::vector<std::uint8_t> ctrl(static_cast<std::size_t>(capacity), 0);
+        std::vector<char> slots(static_cast<std::size_t>(capacity * sizeof(Key)), 0);
+        Hash hash_fn = set.hash_function();
+        for (const Key& key : set)
+        {
+            std::size_t hash = hash_finish<Hash>(hash_fn(key));
+            std::uint64_t index = hash & mask;
+            while (ctrl[index])
+                index = (index + 1) & mask;
+            ctrl[index] = snapshot_tag(hash);
+            std::memcpy(slots.data() + index * sizeof(Key), &key, sizeof(Key));
+        }
+
+        std::vector<char> padding(static_cast<std::size_t>(header._slots_offset - sizeof(header) - capacity), 0);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(ctrl.data()), static_cast<std::streamsize>(ctrl.size()));
+        out.write(padding.data(), static_cast<std::streamsize>(padding.size()));
+        out.write(slots.data(), static_cast<std::streamsize>(slots.size()));
+    }
+    else
+    {
+        header._layout = SnapshotLayout::Records;
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        for (const Key& key : set)
+            snapshot_traits<Key>::write(out, key);
+    }
+
+    out.flush();
+    if (!out)
+        throw std::runtime_error("snapshot: failed writing " + path);
+}
+
+// Adds every key of the snapshot at path to set, sizing it once up front.
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator, typename Storage>
+void load_snapshot(Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>& set, const std::string& path)
+{
+    std::ifstream in(path, std::ios::binary);
+    if (!in)
+        throw std::runtime_error("snapshot: cannot open " + path);
+
+    SnapshotHeader header{};
+    in.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!in)
+        throw std::runtime_error("snapshot: " + path + " is truncated");
+    check_snapshot_header<Key>(header, path);
+
+    in.seekg(0, std::ios::end);
+    std::uint64_t length = static_cast<std::uint64_t>(in.tellg());
+    in.seekg(sizeof(header));
+    if (!in)
+        throw std::runtime_error("snapshot: cannot read " + path);
+
+    if (header._layout == SnapshotLayout::Table)
+    {
+        if constexpr (std::is_trivially_copyable<Key>::value)
+        {
+            check_snapshot_table<Key>(header, length, path);
+            std::vector<std::uint8_t> ctrl(static_cast<std::size_t>(header._capacity));
+            in.read(reinterpret_cast<char*>(ctrl.data()), static_cast<std::streamsize>(ctrl.size()));
+            if (!in)
+                throw std::runtime_error("snapshot: " + path + " is truncated");
+            check_snapshot_ctrl(ctrl.data(), header, path);
+            set.reserve(set.size() + static_cast<std::size_t>(header._count));
+            in.seekg(static_cast<std::streamoff>(header._slots_offset));
+
+            std::vector<char> slots(static_cast<std::size_t>(header._capacity * sizeof(Key)));
+            in.read(slots.data(), static_cast<std::streamsize>(slots.size()));
+            if (!in)
+                throw std::runtime_error("snapshot: " + path + " is truncated");
+
+            for (std::size_t i = 0; i < ctrl.size(); ++i)
+            {
+                if (!ctrl[i])
+                    continue;
+                alignas(Key) unsigned char storage[sizeof(Key)];
+                std::memcpy(storage, slots.data() + i * sizeof(Key), sizeof(Key));
+                set.insert(*reinterpret_cast<const Key*>(storage));
+            }
+            return;
+        }
+        throw std::runtime_error("snapshot: " + path + " holds a different key type");
+    }
+
+    if constexpr (std::is_trivially_copyable<Key>::value)
+    {
+        throw std::runtime_error("snapshot: " + path + " holds a different key type");
+    }
+    else
+    {
+        // Every record takes at least a byte, which bounds what a corrupt
+        // _count can make us reserve.
+        std::uint64_t most = std::min<std::uint64_t>(header._count, length - sizeof(header));
+        set.reserve(set.size() + static_cast<std::size_t>(most));
+        for (std::uint64_t i = 0; i < header._count; ++i)
+        {
+            Key key = snapshot_traits<Key>::read(in);
+            if (!in)
+                throw std::runtime_error("snapshot: " + path + " is truncated");
+            set.insert(std::move(key));
+        }
+    }
+}
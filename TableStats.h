@@ -0,0 +1,142 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <vector>
+
+// Define HASHTABLE_STATS (the same way in every translation unit) to have
+// HashTable count what its lookups and resizes cost. Without it the counters
+// compile away and stats() only reports the shape of the table.
+#if defined(HASHTABLE_STATS)
+constexpr bool HASHTABLE_STATS_ENABLED = true;
+#else
+constexpr bool HASHTABLE_STATS_ENABLED = false;
+#endif
+
+struct HashTableStats
+{
+    // Chain searches; inserts count too, since they look for the key first.
+    std::uint64_t lookups = 0;
+    std::uint64_t hits = 0;
+    std::uint64_t misses = 0;
+    // Nodes visited by all searches, and by the longest one.
+    std::uint64_t probes = 0;
+    std::uint64_t max_probe = 0;
+    // KeyEqual calls; with cached hashes only nodes of the same hash get one.
+    std::uint64_t comparisons = 0;
+    // Resizes started, and the time spent in those done at once.
+    std::uint64_t rehashes = 0;
+    std::uint64_t rehash_ns = 0;
+    // Node and bucket array allocations.
+    std::uint64_t allocations = 0;
+    // Times an over-long chain made the table draw a new salt (chain_limit).
+    std::uint64_t reseeds = 0;
+
+    std::size_t size = 0;
+    std::size_t bucket_count = 0;
+    // chain_lengths[i] buckets hold i elements.
+    std::vector<std::size_t> chain_lengths;
+};
+
+// Base of HashTable holding the counters; the disabled one is empty and all
+// of its hooks do nothing. Counters are relaxed atomics, as const lookups
+// may run on several threads at once, and belong to the object: copies and
+// moves start from zero and swap() leaves them in place.
+template<bool Enabled>
+class TableCounters
+{
+protected:
+    void stat_lookup(std::size_t, bool) const {}
+    void stat_comparison() const {}
+    void stat_allocation() const {}
+    std::uint64_t stat_clock() const { return 0; }
+    void stat_rehash(std::uint64_t) const {}
+    void stat_reseed() const {}
+    void stat_read(HashTableStats&) const {}
+    void stat_reset() {}
+};
+
+template<>
+class TableCounters<true>
+{
+    mutable std::atomic<std::uint64_t> _lookups{ 0 };
+    mutable std::atomic<std::uint64_t> _hits{ 0 };
+    mutable std::atomic<std::uint64_t> _probes{ 0 };
+    mutable std::atomic<std::uint64_t> _max_probe{ 0 };
+    mutable std::atomic<std::uint64_t> _comparisons{ 0 };
+    mutable std::atomic<std::uint64_t> _rehashes{ 0 };
+    mutable std::atomic<std::uint64_t> _rehash_ns{ 0 };
+    mutable std::atomic<std::uint64_t> _allocations{ 0 };
+    mutable std::atomic<std::uint64_t> _reseeds{ 0 };
+
+protected:
+    TableCounters() = default;
+    TableCounters(const TableCounters&) {}
+    TableCounters& operator=(const TableCounters&) { return *this; }
+
+    void stat_lookup(std::size_t probes, bool hit) const
+    {
+        _lookups.fetch_add(1, std::memory_order_relaxed);
+        if (hit)
+            _hits.fetch_add(1, std::memory_order_relaxed);
+        _probes.fetch_add(probes, std::memory_order_relaxed);
+        std::uint64_t longest = _max_probe.load(std::memory_order_relaxed);
+        while (probes > longest && !_max_probe.compare_exchange_weak(longest, probes, std::memory_order_relaxed))
+        {
+        }
+    }
+
+    void stat_comparison() const
+    {
+        _comparisons.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void stat_allocation() const
+    {
+        _allocations.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    std::uint64_t stat_clock() const
+    {
+        return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    // started is stat_clock() when the rehash began, or 0 to count it untimed.
+    void stat_rehash(std::uint64_t started) const
+    {
+        _rehashes.fetch_add(1, std::memory_order_relaxed);
+        if (started)
+            _rehash_ns.fetch_add(stat_clock() - started, std::memory_order_relaxed);
+    }
+
+    void stat_reseed() const
+    {
+        _reseeds.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void stat_read(HashTableStats& stats) const
+    {
+        stats.lookups = _lookups.load(std::memory_order_relaxed);
+        stats.hits = _hits.load(std::memory_order_relaxed);
+        // Lookups racing with the read may be counted as hits only.
+        stats.misses = stats.lookups > stats.hits ? stats.lookups - stats.hits : 0;
+        stats.probes = _probes.load(std::memory_order_relaxed);
+        stats.max_probe = _max_probe.load(std::memory_order_relaxed);
+        stats.comparisons = _comparisons.load(std::memory_order_relaxed);
+        stats.rehashes = _rehashes.load(std::memory_order_relaxed);
+        stats.rehash_ns = _rehash_ns.load(std::memory_order_relaxed);
+        stats.allocations = _allocations.load(std::memory_order_relaxed);
+        stats.reseeds = _reseeds.load(std::memory_order_relaxed);
+    }
+
+    void stat_reset()
+    {
+        for (std::atomic<std::uint64_t>* counter : { &_lookups, &_hits, &_probes, &_max_probe,
+                &_comparisons, &_rehashes, &_rehash_ns, &_allocations, &_reseeds })
+            counter->store(0, std::memory_order_relaxed);
+    }
+};
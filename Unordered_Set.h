@@ -1,19 +1,44 @@
 #pragma once
 
 #include "HashTable.h"
-
-template<typename Key, typename Hash = std::hash<Key>, typename KeyEqual = std::equal_to<Key>>
+#include "FlatHashTable.h"
+#include "SmallHashTable.h"
+#include "DenseHashTable.h"
+#include "Hashers.h"
+
+// Storage selects the backend: ChainedStorage<BucketPolicy> (separately
+// allocated nodes, the default), FlatStorage (open addressing over one
+// contiguous slot array, always power-of-two sized), DenseStorage (the keys
+// in one array in insertion order, indexed by position; erase moves the last
+// key into the gap) or SmallStorage<N, Inner> (up to N keys inline in the
+// set, then Inner's table once it outgrows them). Allocator is rebound to
+// whatever the backend allocates; PoolAllocator suits node churn.
+// With a transparent Hash and KeyEqual (e.g. StringHash and std::equal_to<>)
+// lookups and insert accept any compatible key type.
+// Hashers.h also has IntegerHash, FastStringHash and seeded versions of both
+// for untrusted keys; they declare is_avalanching, so no table remixes them.
+template<
+	typename Key,
+	typename Hash = std::hash<Key>,
+	typename KeyEqual = std::equal_to<Key>,
+	typename Allocator = std::allocator<Key>,
+	typename Storage = ChainedStorage<>
+>
 class Unordered_Set
 {
 private:
-	using Table = HashTable<Key, EmptyStruct, Hash, KeyEqual, false>;
+	using Table = typename Storage::template table<Key, EmptyStruct, Hash, KeyEqual, Allocator>;
 	Table _table;
 
+	template<typename K, typename R>
+	using if_transparent = std::enable_if_t<is_transparent_lookup<Hash, KeyEqual, K>::value, R>;
+
 public:
 	using key_type = Key;
 	using value_type = Key;
 	using hasher = Hash;
 	using key_equal = KeyEqual;
+	using allocator_type = Allocator;
 	using size_type = typename Table::size_type;
 	using difference_type = std::ptrdiff_t;
 
@@ -30,6 +55,8 @@ public:
 
 		TableIterator _it;
 
+		friend class Unordered_Set;
+
 	public:
 		using iterator_category = std::forward_iterator_tag;
 		using value_type = Key;
@@ -55,16 +82,53 @@ public:
 	using iterator = SetIterator<false>;
 	using const_iterator = SetIterator<true>;
 
+private:
+	// Output iterator handed to the table's find_batch: wraps each table
+	// iterator written through it before passing it on to out.
+	template<typename Iterator, typename OutputIt>
+	struct WrapOutput
+	{
+		OutputIt _out;
+
+		WrapOutput& operator*() { return *this; }
+		WrapOutput& operator++() { return *this; }
+		WrapOutput& operator++(int) { return *this; }
+
+		template<typename TableIterator>
+		WrapOutput& operator=(const TableIterator& it)
+		{
+			*_out = Iterator(it);
+			++_out;
+			return *this;
+		}
+	};
+
+public:
+
+	// Owns an extracted element; value() (or key()) gives mutable access to it.
+	using node_type = typename Table::node_type;
+
+	struct insert_return_type
+	{
+		iterator position;
+		bool inserted;
+		node_type node;
+	};
+
 	Unordered_Set();
 	~Unordered_Set();
-	explicit Unordered_Set(size_type bucket_count, const hasher& hash = hasher(), const key_equal& equal = key_equal());
+	explicit Unordered_Set(size_type bucket_count, const hasher& hash = hasher(), const key_equal& equal = key_equal(),
+		const allocator_type& alloc = allocator_type());
+	explicit Unordered_Set(const allocator_type& alloc);
 
 	template<typename InputIt>
 	Unordered_Set(InputIt first, InputIt last, 
-		size_type bucket_count = 16, const hasher& hash = hasher(), const key_equal& equal = key_equal());
+		size_type bucket_count = 16, const hasher& hash = hasher(), const key_equal& equal = key_equal(),
+		const allocator_type& alloc = allocator_type());
 
 	Unordered_Set(std::initializer_list<value_type> init,
-		size_type bucket_count = 16, const hasher& hash = hasher(), const key_equal& equal = key_equal());
+		size_type bucket_count = 16, const hasher& hash = hasher(), const key_equal& equal = key_equal(),
+		const allocator_type& alloc = allocator_type());
 
 	Unordered_Set(const Unordered_Set& other);
 	Unordered_Set(Unordered_Set&& other) noexcept;
@@ -73,6 +137,10 @@ public:
 	Unordered_Set& operator=(Unordered_Set&& other) noexcept;
 	Unordered_Set& operator=(std::initializer_list<value_type> ilist);
 
+	allocator_type get_allocator() const;
+	hasher hash_function() const;
+	key_equal key_eq() const;
+
 	iterator begin() noexcept;
 	iterator end() noexcept;
 	const_iterator begin() const noexcept;
@@ -86,16 +154,63 @@ public:
 	std::pair<iterator, bool> insert(const value_type& value);
 	std::pair<iterator, bool> insert(value_type&& value);
 
+	template<typename K>
+	if_transparent<K, std::pair<iterator, bool>> insert(K&& key);
+
 	template<typename InputIt>
 	void insert(InputIt first, InputIt last);
 
 	void insert(std::initializer_list<value_type> ilist);
 
+	// Constructs the key in place; a duplicate is rejected before anything
+	// is built when args is a single Key.
 	template<typename... Args>
 	std::pair<iterator, bool> emplace(Args&&... args);
 
+	node_type extract(const_iterator pos);
+	node_type extract(iterator pos);
+	node_type extract(const key_type& key);
+
+	insert_return_type insert(node_type&& node);
+
+	// Moves the elements of source that are not present here, relinking
+	// nodes instead of copying them; duplicates stay in source.
+	void merge(Unordered_Set& source);
+	void merge(Unordered_Set&& source);
+
+	// In-place set algebra: keep only the keys also in other, drop those in
+	// other, or add copies of the ones missing here. Node hashes are reused
+	// rather than recomputed when Hash is stateless, and subtract() looks
+	// up the keys of whichever set is smaller.
+	void intersect(const Unordered_Set& other);
+	void subtract(const Unordered_Set& other);
+	void unite(const Unordered_Set& other);
+
+	bool is_subset_of(const Unordered_Set& other) const;
+
+	template<typename K, typename H, typename E, typename A, typename S>
+	friend Unordered_Set<K, H, E, A, S> set_intersection(const Unordered_Set<K, H, E, A, S>& a, const Unordered_Set<K, H, E, A, S>& b);
+	template<typename K, typename H, typename E, typename A, typename S>
+	friend Unordered_Set<K, H, E, A, S> set_difference(const Unordered_Set<K, H, E, A, S>& a, const Unordered_Set<K, H, E, A, S>& b);
+
 	size_type erase(const key_type& key);
 
+	template<typename K>
+	if_transparent<K, size_type> erase(const K& key);
+
+	// Batched lookups for probing with many keys at once: each group of keys
+	// is hashed and prefetched before any is resolved, so their cache misses
+	// overlap. count results are written to out in key order.
+	template<typename OutputIt>
+	OutputIt find_batch(const key_type* keys, size_type count, OutputIt out);
+	template<typename OutputIt>
+	OutputIt find_batch(const key_type* keys, size_type count, OutputIt out) const;
+	template<typename OutputIt>
+	OutputIt contains_batch(const key_type* keys, size_type count, OutputIt out) const;
+
+	// Returns how many of the keys were new.
+	size_type insert_batch(const value_type* values, size_type count);
+
 	void clear() noexcept;
 
 	void swap(Unordered_Set& other) noexcept;
@@ -110,6 +225,22 @@ public:
 	std::pair<iterator, iterator> equal_range(const key_type& key);
 	std::pair<const_iterator, const_iterator> equal_range(const key_type& key) const;
 
+	template<typename K>
+	if_transparent<K, size_type> count(const K& key) const;
+
+	template<typename K>
+	if_transparent<K, iterator> find(const K& key);
+	template<typename K>
+	if_transparent<K, const_iterator> find(const K& key) const;
+
+	template<typename K>
+	if_transparent<K, bool> contains(const K& key) const;
+
+	template<typename K>
+	if_transparent<K, std::pair<iterator, iterator>> equal_range(const K& key);
+	template<typename K>
+	if_transparent<K, std::pair<const_iterator, const_iterator>> equal_range(const K& key) const;
+
 	size_type bucket_count() const noexcept;
 	size_type bucket_size(size_type index) const;
 	size_type bucket(const key_type& key) const;
@@ -118,338 +249,832 @@ public:
 	float max_load_factor() const noexcept;
 	void max_load_factor(float ml);
 
+	// Shrink the table once erases push the load under this; 0 (the default) never does.
+	float min_load_factor() const noexcept;
+	void min_load_factor(float ml);
+	void shrink_to_fit();
+
 	void rehash(size_type count);
 	void reserve(size_type count);
 
+	// Chained storage only: amortizes each resize over later inserts and erases.
+	void incremental_rehash(bool enable);
+	bool incremental_rehash() const;
+	bool rehash_in_progress() const;
+
+	// Chained storage only: past limit colliding nodes in one bucket the set
+	// reseeds its hashes and relinks everything (see HashTable::chain_limit).
+	void chain_limit(size_type limit);
+	size_type chain_limit() const;
+
+	// Chained storage only: lookup and rehash counters (see TableStats.h)
+	// and the chain-length histogram.
+	HashTableStats stats() const;
+	void reset_stats();
+
+	// Bytes each element takes in the backend, and the heap bytes the set
+	// holds (see MemoryUsage.h). key_bytes, given a key, returns what it
+	// owns out of line, e.g. StringHeapBytes for std::string keys.
+	static constexpr size_type node_size = Table::node_size;
+	MemoryUsage memory_usage() const;
+	template<typename KeyBytes>
+	MemoryUsage memory_usage(KeyBytes key_bytes) const;
+
+	// Dense storage only: the keys as one array of size() elements, in
+	// iteration order.
+	const key_type* data() const noexcept;
+	const auto& values() const noexcept;
+
+	// Threads used by scans of large sets, and with chained storage also by
+	// rehashes, range inserts and clear().
+	void parallelism(size_type threads);
+	size_type parallelism() const;
+
+	// Disjoint pieces for parallel scans; subrange(i, parts) for i in
+	// [0, parts) together cover the set.
+	std::pair<const_iterator, const_iterator> subrange(size_type index, size_type parts) const;
+	size_type scan_parts() const;
+
+	// f runs concurrently on up to scan_parts() threads and must not throw.
+	template<typename F>
+	void parallel_for_each(F f) const;
+
 	bool operator==(const Unordered_Set& other) const;
 	bool operator!=(const Unordered_Set& other) const;
 };
 
-template<typename Key, typename Hash, typename KeyEqual>
-inline Unordered_Set<Key, Hash, KeyEqual>::Unordered_Set() = default;
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator, typename Storage>
+inline Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::Unordered_Set() = default;
 
-template<typename Key, typename Hash, typename KeyEqual>
-inline Unordered_Set<Key, Hash, KeyEqual>::~Unordered_Set() = default;
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator, typename Storage>
+inline Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::~Unordered_Set() = default;
 
-template<typename Key, typename Hash, typename KeyEqual>
-inline Unordered_Set<Key, Hash, KeyEqual>::Unordered_Set(size_type bucket_count, const hasher& hash, const key_equal& equal)
-	: _table(bucket_count, hash, equal)
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator, typename Storage>
+inline Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::Unordered_Set(size_type bucket_count, const hasher& hash, const key_equal& equal,
+	const allocator_type& alloc)
+	: _table(bucket_count, hash, equal, alloc)
 {
 }
 
-template<typename Key, typename Hash, typename KeyEqual>
-inline Unordered_Set<Key, Hash, KeyEqual>::Unordered_Set(std::initializer_list<value_type> init, 
-	size_type bucket_count, const hasher& hash, const key_equal& equal)
-	: _table(bucket_count, hash, equal)
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator, typename Storage>
+inline Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::Unordered_Set(const allocator_type& alloc)
+	: _table(16, hasher(), key_equal(), alloc)
 {
-	for (const auto& v : init)
-		_table.insert(v);
 }
 
-template<typename Key, typename Hash, typename KeyEqual>
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator, typename Storage>
+inline Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::Unordered_Set(std::initializer_list<value_type> init, 
+	size_type bucket_count, const hasher& hash, const key_equal& equal, const allocator_type& alloc)
+	: _table(bucket_count, hash, equal, alloc)
+{
+	_table.insert_range(init.begin(), init.end());
+}
+
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator, typename Storage>
 template<typename InputIt>
-inline Unordered_Set<Key, Hash, KeyEqual>::Unordered_Set(InputIt first, InputIt last,
-	size_type bucket_count, const hasher& hash, const key_equal& equal)
-	: _table(bucket_count, hash, equal)
+inline Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::Unordered_Set(InputIt first, InputIt last,
+	size_type bucket_count, const hasher& hash, const key_equal& equal, const allocator_type& alloc)
+	: _table(bucket_count, hash, equal, alloc)
 {
-	for (; first != last; ++first)
-		_table.insert(*first);
+	_table.insert_range(first, last);
 }
 
-template<typename Key, typename Hash, typename KeyEqual>
-inline Unordered_Set<Key, Hash, KeyEqual>::Unordered_Set(const Unordered_Set& other)
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator, typename Storage>
+inline Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::Unordered_Set(const Unordered_Set& other)
 	: _table(other._table)
 {
 }
 
-template<typename Key, typename Hash, typename KeyEqual>
-inline Unordered_Set<Key, Hash, KeyEqual>::Unordered_Set(Unordered_Set&& other) noexcept
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator, typename Storage>
+inline Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::Unordered_Set(Unordered_Set&& other) noexcept
 	: _table(std::move(other._table))
 {
 }
 
-template<typename Key, typename Hash, typename KeyEqual>
-inline Unordered_Set<Key, Hash, KeyEqual>& Unordered_Set<Key, Hash, KeyEqual>::operator=(const Unordered_Set& other)
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator, typename Storage>
+inline Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>& Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::operator=(const Unordered_Set& other)
 {
 	_table = other._table;
 	return *this;
 }
 
-template<typename Key, typename Hash, typename KeyEqual>
-inline Unordered_Set<Key, Hash, KeyEqual>& Unordered_Set<Key, Hash, KeyEqual>::operator=(Unordered_Set&& other) noexcept
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator, typename Storage>
+inline Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>& Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::operator=(Unordered_Set&& other) noexcept
 {
 	_table = std::move(other._table);
 	return *this;
 }
 
-template<typename Key, typename Hash, typename KeyEqual>
-Unordered_Set<Key, Hash, KeyEqual>& Unordered_Set<Key, Hash, KeyEqual>::operator=(std::initializer_list<value_type> ilist)
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator, typename Storage>
+Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>& Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::operator=(std::initializer_list<value_type> ilist)
 {
 	_table.clear();
-	for (const auto& val : ilist)
-		_table.insert(val);
+	_table.insert_range(ilist.begin(), ilist.end());
 	return *this;
 }
 
-template<typename Key, typename Hash, typename KeyEqual>
-typename Unordered_Set<Key, Hash, KeyEqual>::iterator Unordered_Set<Key, Hash, KeyEqual>::begin() noexcept
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator, typename Storage>
+inline typename Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::allocator_type 
+		Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::get_allocator() const
+{
+	return allocator_type(_table.get_allocator());
+}
+
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator, typename Storage>
+inline typename Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::hasher 
+		Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::hash_function() const
+{
+	return _table.hash_function();
+}
+
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator, typename Storage>
+inline typename Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::key_equal 
+		Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::key_eq() const
+{
+	return _table.key_eq();
+}
+
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator, typename Storage>
+typename Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::iterator Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::begin() noexcept
 {
 	return iterator(_table.begin());
 }
 
-template<typename Key, typename Hash, typename KeyEqual>
-typename Unordered_Set<Key, Hash, KeyEqual>::iterator Unordered_Set<Key, Hash, KeyEqual>::end() noexcept
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator, typename Storage>
+typename Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::iterator Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::end() noexcept
 {
 	return iterator(_table.end());
 }
 
-template<typename Key, typename Hash, typename KeyEqual>
-typename Unordered_Set<Key, Hash, KeyEqual>::const_iterator Unordered_Set<Key, Hash, KeyEqual>::begin() const noexcept
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator, typename Storage>
+typename Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::const_iterator Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::begin() const noexcept
 {
-	return _table.begin();
+	return const_iterator(_table.begin());
 }
 
-template<typename Key, typename Hash, typename KeyEqual>
-typename Unordered_Set<Key, Hash, KeyEqual>::const_iterator Unordered_Set<Key, Hash, KeyEqual>::end() const noexcept
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator, typename Storage>
+typename Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::const_iterator Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::end() const noexcept
 {
-	return _table.end();
+	return const_iterator(_table.end());
 }
 
-template<typename Key, typename Hash, typename KeyEqual>
-typename Unordered_Set<Key, Hash, KeyEqual>::const_iterator Unordered_Set<Key, Hash, KeyEqual>::cbegin() const noexcept
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator, typename Storage>
+typename Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::const_iterator Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::cbegin() const noexcept
 {
-	return _table.cbegin();
+	return const_iterator(_table.cbegin());
 }
 
-template<typename Key, typename Hash, typename KeyEqual>
-typename Unordered_Set<Key, Hash, KeyEqual>::const_iterator Unordered_Set<Key, Hash, KeyEqual>::cend() const noexcept
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator, typename Storage>
+typename Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::const_iterator Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::cend() const noexcept
 {
-	return _table.cend();
+	return const_iterator(_table.cend());
 }
 
-template<typename Key, typename Hash, typename KeyEqual>
-bool Unordered_Set<Key, Hash, KeyEqual>::empty() const noexcept
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator, typename Storage>
+bool Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::empty() const noexcept
 {
 	return _table.empty();
 }
 
-template<typename Key, typename Hash, typename KeyEqual>
-typename Unordered_Set<Key, Hash, KeyEqual>::size_type Unordered_Set<Key, Hash, KeyEqual>::size() const noexcept
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator, typename Storage>
+typename Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::size_type Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::size() const noexcept
 {
 	return _table.size();
 }
 
-template<typename Key, typename Hash, typename KeyEqual>
-void Unordered_Set<Key, Hash, KeyEqual>::clear() noexcept
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator, typename Storage>
+void Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::clear() noexcept
 {
 	_table.clear();
 }
 
-template<typename Key, typename Hash, typename KeyEqual>
-std::pair<typename Unordered_Set<Key, Hash, KeyEqual>::iterator, bool> 
-		Unordered_Set<Key, Hash, KeyEqual>::insert(const value_type& value)
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator, typename Storage>
+std::pair<typename Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::iterator, bool> 
+		Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::insert(const value_type& value)
 {
 	auto [it, success] = _table.insert(value);
 	return { iterator(it), success };
 }
 
-template<typename Key, typename Hash, typename KeyEqual>
-std::pair<typename Unordered_Set<Key, Hash, KeyEqual>::iterator, bool> Unordered_Set<Key, Hash, KeyEqual>::insert(value_type&& value)
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator, typename Storage>
+std::pair<typename Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::iterator, bool> Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::insert(value_type&& value)
 {
 	auto [it, success] = _table.insert(std::move(value));
 	return { iterator(it), success };
 }
 
-template<typename Key, typename Hash, typename KeyEqual>
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator, typename Storage>
+template<typename K>
+inline typename Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::template if_transparent<K, std::pair<typename Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::iterator, bool>> 
+		Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::insert(K&& key)
+{
+	auto [it, success] = _table.try_emplace(std::forward<K>(key));
+	return { iterator(it), success };
+}
+
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator, typename Storage>
 template<typename InputIt>
-inline void Unordered_Set<Key, Hash, KeyEqual>::insert(InputIt first, InputIt last)
+inline void Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::insert(InputIt first, InputIt last)
 {
-	for (; first != last; ++first)
-		_table.insert(*first);
+	_table.insert_range(first, last);
 }
 
-template<typename Key, typename Hash, typename KeyEqual>
-void Unordered_Set<Key, Hash, KeyEqual>::insert(std::initializer_list<value_type> ilist)
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator, typename Storage>
+void Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::insert(std::initializer_list<value_type> ilist)
 {
-	for (const auto& val : ilist)
-		_table.insert(val);
+	_table.insert_range(ilist.begin(), ilist.end());
 }
 
-template<typename Key, typename Hash, typename KeyEqual>
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator, typename Storage>
 template<typename... Args>
-std::pair<typename Unordered_Set<Key, Hash, KeyEqual>::iterator, bool> Unordered_Set<Key, Hash, KeyEqual>::emplace(Args&&... args)
+std::pair<typename Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::iterator, bool> Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::emplace(Args&&... args)
 {
 	auto [it, success] = _table.emplace(std::forward<Args>(args)...);
 	return { iterator(it), success };
 }
 
-template<typename Key, typename Hash, typename KeyEqual>
-typename Unordered_Set<Key, Hash, KeyEqual>::size_type Unordered_Set<Key, Hash, KeyEqual>::erase(const key_type& key)
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator, typename Storage>
+template<typename OutputIt>
+inline OutputIt Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::find_batch(const key_type* keys, size_type count, OutputIt out)
+{
+	return _table.find_batch(keys, count, WrapOutput<iterator, OutputIt>{ out })._out;
+}
+
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator, typename Storage>
+template<typename OutputIt>
+inline OutputIt Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::find_batch(const key_type* keys, size_type count, OutputIt out) const
+{
+	return _table.find_batch(keys, count, WrapOutput<const_iterator, OutputIt>{ out })._out;
+}
+
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator, typename Storage>
+template<typename OutputIt>
+inline OutputIt Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::contains_batch(const key_type* keys, size_type count, OutputIt out) const
+{
+	return _table.contains_batch(keys, count, out);
+}
+
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator, typename Storage>
+inline typename Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::size_type 
+		Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::insert_batch(const value_type* values, size_type count)
+{
+	return _table.insert_batch(values, count);
+}
+
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator, typename Storage>
+inline typename Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::node_type 
+		Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::extract(const_iterator pos)
+{
+	return _table.extract(pos._it);
+}
+
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator, typename Storage>
+inline typename Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::node_type 
+		Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::extract(iterator pos)
+{
+	return _table.extract(pos._it);
+}
+
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator, typename Storage>
+inline typename Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::node_type 
+		Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::extract(const key_type& key)
+{
+	return _table.extract(key);
+}
+
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator, typename Storage>
+typename Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::insert_return_type 
+		Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::insert(node_type&& node)
+{
+	auto result = _table.insert(std::move(node));
+	return { iterator(result.position), result.inserted, std::move(result.node) };
+}
+
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator, typename Storage>
+inline void Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::merge(Unordered_Set& source)
+{
+	_table.merge(source._table);
+}
+
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator, typename Storage>
+inline void Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::merge(Unordered_Set&& source)
+{
+	_table.merge(source._table);
+}
+
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator, typename Storage>
+inline void Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::intersect(const Unordered_Set& other)
+{
+	_table.erase_filtered(other._table, false);
+}
+
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator, typename Storage>
+inline void Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::subtract(const Unordered_Set& other)
+{
+	_table.erase_filtered(other._table, true);
+}
+
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator, typename Storage>
+inline void Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::unite(const Unordered_Set& other)
+{
+	_table.insert_filtered(other._table, _table, false);
+}
+
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator, typename Storage>
+inline bool Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::is_subset_of(const Unordered_Set& other) const
+{
+	return _table.is_subset_of(other._table);
+}
+
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator, typename Storage>
+typename Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::size_type Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::erase(const key_type& key)
+{
+	return _table.erase(key);
+}
+
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator, typename Storage>
+template<typename K>
+inline typename Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::template if_transparent<K, typename Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::size_type> 
+		Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::erase(const K& key)
 {
 	return _table.erase(key);
 }
 
-template<typename Key, typename Hash, typename KeyEqual>
-inline void Unordered_Set<Key, Hash, KeyEqual>::swap(Unordered_Set& other) noexcept
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator, typename Storage>
+inline void Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::swap(Unordered_Set& other) noexcept
 {
 	_table.swap(other._table);
 }
 
-template<typename Key, typename Hash, typename KeyEqual>
-typename Unordered_Set<Key, Hash, KeyEqual>::size_type Unordered_Set<Key, Hash, KeyEqual>::count(const key_type& key) const
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator, typename Storage>
+typename Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::size_type Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::count(const key_type& key) const
 {
 	return _table.count(key);
 }
 
-template<typename Key, typename Hash, typename KeyEqual>
-typename Unordered_Set<Key, Hash, KeyEqual>::iterator Unordered_Set<Key, Hash, KeyEqual>::find(const key_type& key)
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator, typename Storage>
+typename Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::iterator Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::find(const key_type& key)
 {
 	return iterator(_table.find(key));
 }
 
-template<typename Key, typename Hash, typename KeyEqual>
-typename Unordered_Set<Key, Hash, KeyEqual>::const_iterator Unordered_Set<Key, Hash, KeyEqual>::find(const key_type& key) const
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator, typename Storage>
+typename Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::const_iterator Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::find(const key_type& key) const
 {
 	return const_iterator(_table.find(key));
 }
 
-template<typename Key, typename Hash, typename KeyEqual>
-bool Unordered_Set<Key, Hash, KeyEqual>::contains(const key_type& key) const
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator, typename Storage>
+bool Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::contains(const key_type& key) const
 {
 	return find(key) != end();
 }
 
-template<typename Key, typename Hash, typename KeyEqual>
-std::pair<typename Unordered_Set<Key, Hash, KeyEqual>::iterator, typename Unordered_Set<Key, Hash, KeyEqual>::iterator> 
-		Unordered_Set<Key, Hash, KeyEqual>::equal_range(const key_type& key)
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator, typename Storage>
+std::pair<typename Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::iterator, typename Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::iterator> 
+		Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::equal_range(const key_type& key)
+{
+	auto [first, last] = _table.equal_range(key);
+	return { iterator(first), iterator(last) };
+}
+
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator, typename Storage>
+std::pair<typename Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::const_iterator, typename Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::const_iterator> 
+		Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::equal_range(const key_type& key) const
 {
-	return _table.equal_range(key);
+	auto [first, last] = _table.equal_range(key);
+	return { const_iterator(first), const_iterator(last) };
 }
 
-template<typename Key, typename Hash, typename KeyEqual>
-std::pair<typename Unordered_Set<Key, Hash, KeyEqual>::const_iterator, typename Unordered_Set<Key, Hash, KeyEqual>::const_iterator> 
-		Unordered_Set<Key, Hash, KeyEqual>::equal_range(const key_type& key) const
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator, typename Storage>
+template<typename K>
+inline typename Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::template if_transparent<K, typename Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::size_type> 
+		Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::count(const K& key) const
 {
-	return _table.equal_range(key);
+	return _table.count(key);
+}
+
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator, typename Storage>
+template<typename K>
+inline typename Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::template if_transparent<K, typename Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::iterator> 
+		Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::find(const K& key)
+{
+	return iterator(_table.find(key));
 }
 
-template<typename Key, typename Hash, typename KeyEqual>
-typename Unordered_Set<Key, Hash, KeyEqual>::size_type Unordered_Set<Key, Hash, KeyEqual>::bucket_count() const noexcept
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator, typename Storage>
+template<typename K>
+inline typename Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::template if_transparent<K, typename Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::const_iterator> 
+		Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::find(const K& key) const
+{
+	return const_iterator(_table.find(key));
+}
+
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator, typename Storage>
+template<typename K>
+inline typename Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::template if_transparent<K, bool> 
+		Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::contains(const K& key) const
+{
+	return find(key) != end();
+}
+
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator, typename Storage>
+template<typename K>
+inline typename Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::template if_transparent<K, std::pair<typename Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::iterator, typename Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::iterator>> 
+		Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::equal_range(const K& key)
+{
+	auto [first, last] = _table.equal_range(key);
+	return { iterator(first), iterator(last) };
+}
+
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator, typename Storage>
+template<typename K>
+inline typename Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::template if_transparent<K, std::pair<typename Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::const_iterator, typename Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::const_iterator>> 
+		Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::equal_range(const K& key) const
+{
+	auto [first, last] = _table.equal_range(key);
+	return { const_iterator(first), const_iterator(last) };
+}
+
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator, typename Storage>
+typename Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::size_type Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::bucket_count() const noexcept
 {
 	return _table.bucket_count();
 }
 
-template<typename Key, typename Hash, typename KeyEqual>
-typename Unordered_Set<Key, Hash, KeyEqual>::size_type Unordered_Set<Key, Hash, KeyEqual>::bucket_size(size_type index) const
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator, typename Storage>
+typename Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::size_type Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::bucket_size(size_type index) const
 {
 	return _table.bucket_size(index);
 }
 
-template<typename Key, typename Hash, typename KeyEqual>
-typename Unordered_Set<Key, Hash, KeyEqual>::size_type Unordered_Set<Key, Hash, KeyEqual>::bucket(const key_type& key) const
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator, typename Storage>
+typename Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::size_type Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::bucket(const key_type& key) const
 {
 	return _table.bucket(key);
 }
 
-template<typename Key, typename Hash, typename KeyEqual>
-float Unordered_Set<Key, Hash, KeyEqual>::load_factor() const noexcept
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator, typename Storage>
+float Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::load_factor() const noexcept
 {
 	return _table.load_factor();
 }
 
-template<typename Key, typename Hash, typename KeyEqual>
-float Unordered_Set<Key, Hash, KeyEqual>::max_load_factor() const noexcept
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator, typename Storage>
+float Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::max_load_factor() const noexcept
 {
 	return _table.max_load_factor();
 }
 
-template<typename Key, typename Hash, typename KeyEqual>
-void Unordered_Set<Key, Hash, KeyEqual>::max_load_factor(float ml)
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator, typename Storage>
+void Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::max_load_factor(float ml)
 {
 	_table.max_load_factor(ml);
 }
 
-template<typename Key, typename Hash, typename KeyEqual>
-void Unordered_Set<Key, Hash, KeyEqual>::rehash(size_type count)
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator, typename Storage>
+float Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::min_load_factor() const noexcept
+{
+	return _table.min_load_factor();
+}
+
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator, typename Storage>
+void Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::min_load_factor(float ml)
+{
+	_table.min_load_factor(ml);
+}
+
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator, typename Storage>
+void Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::shrink_to_fit()
+{
+	_table.shrink_to_fit();
+}
+
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator, typename Storage>
+void Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::rehash(size_type count)
 {
 	_table.reserve(count);
 }
 
-template<typename Key, typename Hash, typename KeyEqual>
-void Unordered_Set<Key, Hash, KeyEqual>::reserve(size_type count)
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator, typename Storage>
+void Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::reserve(size_type count)
 {
 	_table.reserve(count);
 }
 
-template<typename Key, typename Hash, typename KeyEqual>
-inline bool Unordered_Set<Key, Hash, KeyEqual>::operator==(const Unordered_Set& other) const
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator, typename Storage>
+inline void Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::incremental_rehash(bool enable)
+{
+	_table.incremental_rehash(enable);
+}
+
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator, typename Storage>
+inline bool Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::incremental_rehash() const
+{
+	return _table.incremental_rehash();
+}
+
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator, typename Storage>
+inline bool Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::rehash_in_progress() const
+{
+	return _table.rehash_in_progress();
+}
+
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator, typename Storage>
+inline void Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::chain_limit(size_type limit)
+{
+	_table.chain_limit(limit);
+}
+
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator, typename Storage>
+inline typename Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::size_type Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::chain_limit() const
+{
+	return _table.chain_limit();
+}
+
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator, typename Storage>
+inline HashTableStats Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::stats() const
+{
+	return _table.stats();
+}
+
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator, typename Storage>
+inline void Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::reset_stats()
+{
+	_table.reset_stats();
+}
+
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator, typename Storage>
+inline MemoryUsage Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::memory_usage() const
+{
+	return _table.memory_usage();
+}
+
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator, typename Storage>
+template<typename KeyBytes>
+inline MemoryUsage Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::memory_usage(KeyBytes key_bytes) const
+{
+	return _table.memory_usage(key_bytes);
+}
+
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator, typename Storage>
+inline const typename Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::key_type*
+		Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::data() const noexcept
+{
+	return _table.data();
+}
+
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator, typename Storage>
+inline const auto& Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::values() const noexcept
+{
+	return _table.values();
+}
+
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator, typename Storage>
+inline void Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::parallelism(size_type threads)
+{
+	_table.parallelism(threads);
+}
+
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator, typename Storage>
+inline typename Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::size_type 
+		Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::parallelism() const
+{
+	return _table.parallelism();
+}
+
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator, typename Storage>
+std::pair<typename Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::const_iterator, typename Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::const_iterator> 
+		Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::subrange(size_type index, size_type parts) const
+{
+	auto [first, last] = _table.subrange(index, parts);
+	return { const_iterator(first), const_iterator(last) };
+}
+
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator, typename Storage>
+inline typename Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::size_type 
+		Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::scan_parts() const
+{
+	return _table.scan_parts();
+}
+
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator, typename Storage>
+template<typename F>
+inline void Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::parallel_for_each(F f) const
+{
+	_table.parallel_for_each(f);
+}
+
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator, typename Storage>
+inline bool Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::operator==(const Unordered_Set& other) const
 {
 	return _table == other._table;
 }
 
-template<typename Key, typename Hash, typename KeyEqual>
-inline bool Unordered_Set<Key, Hash, KeyEqual>::operator!=(const Unordered_Set& other) const
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator, typename Storage>
+inline bool Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::operator!=(const Unordered_Set& other) const
 {
 	return !(*this == other);
 }
 
 
-template<typename Key, typename Hash, typename KeyEqual>
-void swap(Unordered_Set<Key, Hash, KeyEqual>& lhs, Unordered_Set<Key, Hash, KeyEqual>& rhs) noexcept
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator, typename Storage>
+void swap(Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>& lhs, Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>& rhs) noexcept
 {
 	lhs.swap(rhs);
 }
 
-template<typename Key, typename Hash, typename KeyEqual>
+// The elements of scan that satisfy keep, one vector per scanning thread.
+template<typename Set, typename Pred>
+std::vector<std::vector<typename Set::value_type>> parallel_collect(const Set& scan, Pred keep)
+{
+	typename Set::size_type parts = scan.scan_parts();
+	std::vector<std::vector<typename Set::value_type>> found(parts);
+	run_parallel(parts, [&](typename Set::size_type i) {
+		auto [first, last] = scan.subrange(i, parts);
+		for (; first != last; ++first)
+			if (keep(*first))
+				found[i].push_back(*first);
+	});
+	return found;
+}
+
+template<typename Set, typename Parts>
+void insert_parts(Set& result, const Parts& parts)
+{
+	typename Set::size_type total = result.size();
+	for (const auto& part : parts)
+		total += part.size();
+	result.reserve(total);
+	for (const auto& part : parts)
+		result.insert(part.begin(), part.end());
+}
+
+// Parallel set algebra: the smaller operand is scanned, split across its
+// scan_parts() threads, and probed against the other. The result is built
+// once from what the workers found, with the scanned set's parallelism.
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator, typename Storage>
+Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage> parallel_intersection(const Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>& a,
+	const Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>& b)
+{
+	const auto& small = a.size() <= b.size() ? a : b;
+	const auto& large = a.size() <= b.size() ? b : a;
+	Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage> result(small.get_allocator());
+	result.parallelism(small.parallelism());
+	insert_parts(result, parallel_collect(small, [&](const Key& key) { return large.contains(key); }));
+	return result;
+}
+
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator, typename Storage>
+Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage> parallel_union(const Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>& a,
+	const Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>& b)
+{
+	const auto& small = a.size() <= b.size() ? a : b;
+	const auto& large = a.size() <= b.size() ? b : a;
+	Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage> result(large);
+	insert_parts(result, parallel_collect(small, [&](const Key& key) { return !large.contains(key); }));
+	return result;
+}
+
+// Every element of a has to be visited here, so a is the scanned side.
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator, typename Storage>
+Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage> parallel_difference(const Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>& a,
+	const Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>& b)
+{
+	Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage> result(a.get_allocator());
+	result.parallelism(a.parallelism());
+	insert_parts(result, parallel_collect(a, [&](const Key& key) { return !b.contains(key); }));
+	return result;
+}
+
+// Set algebra into a new set: the smaller operand of an intersection is
+// walked, the result grows once for the most it can hold and is filled with
+// copies. A union starts from a copy of the larger operand. When the first
+// operand is an rvalue it becomes the result, and the union of two rvalues
+// splices the nodes of the smaller into the larger.
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator, typename Storage>
+Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage> set_intersection(const Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>& a,
+	const Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>& b)
+{
+	Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage> result(16, a.hash_function(), a.key_eq(), a.get_allocator());
+	result._table.insert_filtered(a._table, b._table, true);
+	return result;
+}
+
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator, typename Storage>
+Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage> set_intersection(Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>&& a,
+	const Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>& b)
+{
+	a.intersect(b);
+	return std::move(a);
+}
+
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator, typename Storage>
+Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage> set_union(const Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>& a,
+	const Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>& b)
+{
+	const auto& small = a.size() <= b.size() ? a : b;
+	const auto& large = a.size() <= b.size() ? b : a;
+	Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage> result(large);
+	result.unite(small);
+	return result;
+}
+
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator, typename Storage>
+Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage> set_union(Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>&& a,
+	const Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>& b)
+{
+	a.unite(b);
+	return std::move(a);
+}
+
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator, typename Storage>
+Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage> set_union(Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>&& a,
+	Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>&& b)
+{
+	if (a.size() < b.size())
+	{
+		b.merge(a);
+		return std::move(b);
+	}
+	a.merge(b);
+	return std::move(a);
+}
+
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator, typename Storage>
+Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage> set_difference(const Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>& a,
+	const Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>& b)
+{
+	Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage> result(16, a.hash_function(), a.key_eq(), a.get_allocator());
+	result._table.insert_filtered(a._table, b._table, false);
+	return result;
+}
+
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator, typename Storage>
+Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage> set_difference(Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>&& a,
+	const Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>& b)
+{
+	a.subtract(b);
+	return std::move(a);
+}
+
+// Whether every key of a is also in b.
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator, typename Storage>
+bool is_subset(const Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>& a, const Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>& b)
+{
+	return a.is_subset_of(b);
+}
+
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator, typename Storage>
 template<bool IsConst>
-inline Unordered_Set<Key, Hash, KeyEqual>::SetIterator<IsConst>::SetIterator(TableIterator it)
+inline Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::SetIterator<IsConst>::SetIterator(TableIterator it)
 	: _it(it) 
 {
 }
 
-template<typename Key, typename Hash, typename KeyEqual>
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator, typename Storage>
 template<bool IsConst>
-typename Unordered_Set<Key, Hash, KeyEqual>::SetIterator<IsConst>::reference 
-		Unordered_Set<Key, Hash, KeyEqual>::SetIterator<IsConst>::operator*() const
+typename Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::SetIterator<IsConst>::reference 
+		Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::SetIterator<IsConst>::operator*() const
 {
-	return _it->first;
+	return *_it;
 }
 
-template<typename Key, typename Hash, typename KeyEqual>
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator, typename Storage>
 template<bool IsConst>
-typename Unordered_Set<Key, Hash, KeyEqual>::SetIterator<IsConst>::pointer 
-		Unordered_Set<Key, Hash, KeyEqual>::SetIterator<IsConst>::operator->() const
+typename Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::SetIterator<IsConst>::pointer 
+		Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::SetIterator<IsConst>::operator->() const
 {
-	return &(_it->first);
+	return &*_it;
 }
 
-template<typename Key, typename Hash, typename KeyEqual>
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator, typename Storage>
 template<bool IsConst>
-Unordered_Set<Key, Hash, KeyEqual>::SetIterator<IsConst>& Unordered_Set<Key, Hash, KeyEqual>::SetIterator<IsConst>::operator++()
+Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::SetIterator<IsConst>& Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::SetIterator<IsConst>::operator++()
 {
 	++_it;
 	return *this;
 }
 
-template<typename Key, typename Hash, typename KeyEqual>
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator, typename Storage>
 template<bool IsConst>
-Unordered_Set<Key, Hash, KeyEqual>::SetIterator<IsConst> Unordered_Set<Key, Hash, KeyEqual>::SetIterator<IsConst>::operator++(int)
+Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::SetIterator<IsConst> Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::SetIterator<IsConst>::operator++(int)
 {
 	SetIterator tmp = *this;
 	++_it;
 	return tmp;
 }
 
-template<typename Key, typename Hash, typename KeyEqual>
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator, typename Storage>
 template<bool IsConst>
-bool Unordered_Set<Key, Hash, KeyEqual>::SetIterator<IsConst>::operator==(const SetIterator& rhs) const
+bool Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::SetIterator<IsConst>::operator==(const SetIterator& rhs) const
 {
 	return _it == rhs._it;
 }
 
-template<typename Key, typename Hash, typename KeyEqual>
+template<typename Key, typename Hash, typename KeyEqual, typename Allocator, typename Storage>
 template<bool IsConst>
-bool Unordered_Set<Key, Hash, KeyEqual>::SetIterator<IsConst>::operator!=(const SetIterator& rhs) const
+bool Unordered_Set<Key, Hash, KeyEqual, Allocator, Storage>::SetIterator<IsConst>::operator!=(const SetIterator& rhs) const
 {
 	return _it != rhs._it;
 }
\ No newline at end of file
@@ -0,0 +1,76 @@
+// Scalar contains() loop versus contains_batch() on tables far larger than
+// the cache, where every probe misses. Build with optimizations, e.g.
+//   g++ -std=c++17 -O2 -I.. batch_lookup.cpp -o batch_lookup
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "../Unordered_Set.h"
+
+namespace
+{
+    constexpr std::size_t PROBES = 4'000'000;
+
+    template<typename F>
+    double ns_per_probe(F&& f)
+    {
+        auto start = std::chrono::steady_clock::now();
+        f();
+        std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+        return elapsed.count() / PROBES;
+    }
+
+    template<typename Set>
+    void run(const char* name, std::size_t size)
+    {
+        std::mt19937_64 rng(size);
+        Set set;
+        set.reserve(size);
+        for (std::size_t i = 0; i < size; ++i)
+            set.insert(rng());
+
+        // Half hits, half misses, in random order.
+        std::vector<std::uint64_t> probes(PROBES);
+        std::mt19937_64 replay(size);
+        for (std::size_t i = 0; i < PROBES; ++i)
+            probes[i] = (i & 1) ? rng() : replay();
+        std::shuffle(probes.begin(), probes.end(), rng);
+
+        std::unique_ptr<bool[]> found(new bool[PROBES]);
+        std::size_t hits = 0;
+
+        double scalar = ns_per_probe([&] {
+            for (std::size_t i = 0; i < PROBES; ++i)
+                found[i] = set.contains(probes[i]);
+        });
+        for (std::size_t i = 0; i < PROBES; ++i)
+            hits += found[i];
+
+        double batch = ns_per_probe([&] {
+            set.contains_batch(probes.data(), PROBES, found.get());
+        });
+        for (std::size_t i = 0; i < PROBES; ++i)
+            hits -= found[i];
+
+        std::printf("%-8s %10zu keys   scalar %6.1f ns   batch %6.1f ns   speedup %.2fx%s\n",
+            name, size, scalar, batch, scalar / batch, hits ? "   MISMATCH" : "");
+    }
+}
+
+int main()
+{
+    using Chained = Unordered_Set<std::uint64_t>;
+    using Flat = Unordered_Set<std::uint64_t, std::hash<std::uint64_t>, std::equal_to<std::uint64_t>,
+        std::allocator<std::uint64_t>, FlatStorage>;
+
+    for (std::size_t size : { 1u << 16, 1u << 20, 1u << 23 })
+    {
+        run<Chained>("chained", size);
+        run<Flat>("flat", size);
+    }
+    return 0;
+}
@@ -0,0 +1,478 @@
+// Side-by-side workloads for std::unordered_set and the Unordered_Set
+// backends, over integer, string and 64-byte keys. Build with optimizations,
+// e.g.
+//   g++ -std=c++17 -O2 -I.. suite.cpp -o suite
+// and run with
+//   ./suite [--sizes=1000,100000,1000000] [--filter=text]
+// --filter keeps the runs whose "workload/key/backend" name contains text.
+// Cache misses come from perf_event on Linux and read n/a where it is not
+// permitted (e.g. perf_event_paranoid > 2). Peak RSS is the process high
+// water mark, so run one backend and size per process to compare footprints.
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <random>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+#include "../Unordered_Set.h"
+
+namespace
+{
+    // Operations timed per workload: at least the set size, within bounds.
+    constexpr std::size_t MIN_OPS = std::size_t(1) << 20;
+    constexpr std::size_t MAX_OPS = std::size_t(1) << 24;
+    // Skew of the Zipfian key choice.
+    constexpr double ZIPF_S = 0.99;
+
+    struct Blob
+    {
+        std::uint64_t words[8];
+
+        bool operator==(const Blob& other) const
+        {
+            return std::memcmp(words, other.words, sizeof(words)) == 0;
+        }
+    };
+
+    struct BlobHash
+    {
+        std::size_t operator()(const Blob& blob) const
+        {
+            std::uint64_t h = 0;
+            for (std::uint64_t word : blob.words)
+                h = (h ^ word) * 0x9e3779b97f4a7c15ull;
+            return static_cast<std::size_t>(h ^ (h >> 32));
+        }
+    };
+
+    // Distinct keys from one 64-bit draw each.
+    template<typename Key>
+    Key make_key(std::uint64_t x);
+
+    template<>
+    std::uint64_t make_key<std::uint64_t>(std::uint64_t x)
+    {
+        return x;
+    }
+
+    // Longer than the small-string buffer, so every key owns a heap block.
+    template<>
+    std::string make_key<std::string>(std::uint64_t x)
+    {
+        char buffer[32];
+        std::snprintf(buffer, sizeof(buffer), "key:%016llx", static_cast<unsigned long long>(x));
+        return buffer;
+    }
+
+    template<>
+    Blob make_key<Blob>(std::uint64_t x)
+    {
+        Blob blob;
+        for (std::uint64_t k = 0; k < 8; ++k)
+            blob.words[k] = x ^ (k * 0x9e3779b97f4a7c15ull);
+        return blob;
+    }
+
+    // 2n distinct keys in random order; the first n are loaded, the rest miss.
+    template<typename Key>
+    std::vector<Key> make_keys(std::size_t n)
+    {
+        std::mt19937_64 rng(n);
+        std::unordered_set<std::uint64_t> seen;
+        std::vector<Key> keys;
+        keys.reserve(2 * n);
+        while (keys.size() < 2 * n)
+        {
+            std::uint64_t x = rng();
+            if (seen.insert(x).second)
+                keys.push_back(make_key<Key>(x));
+        }
+        return keys;
+    }
+
+    // Ranks in [0, n) drawn uniformly or from a Zipf-like power law, by
+    // inverting its continuous CDF.
+    class KeyChooser
+    {
+        std::mt19937_64 _rng;
+        std::uniform_real_distribution<double> _unit{ 0.0, 1.0 };
+        std::size_t _n;
+        bool _zipf;
+        double _span;
+
+    public:
+        KeyChooser(std::size_t n, bool zipf, std::uint64_t seed)
+            : _rng(seed)
+            , _n(n)
+            , _zipf(zipf)
+            , _span(std::pow(static_cast<double>(n) + 1, 1 - ZIPF_S) - 1)
+        {
+        }
+
+        std::size_t next()
+        {
+            double u = _unit(_rng);
+            if (!_zipf)
+                return std::min(_n - 1, static_cast<std::size_t>(u * _n));
+            double x = std::pow(1 + u * _span, 1 / (1 - ZIPF_S)) - 1;
+            return std::min(_n - 1, static_cast<std::size_t>(x));
+        }
+    };
+
+    class MissCounter
+    {
+#if defined(__linux__)
+        int _fd = -1;
+#endif
+
+    public:
+        MissCounter()
+        {
+#if defined(__linux__)
+            perf_event_attr attr;
+            std::memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_CACHE_MISSES;
+            attr.disabled = 1;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            _fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+#endif
+        }
+
+        ~MissCounter()
+        {
+#if defined(__linux__)
+            if (_fd >= 0)
+                close(_fd);
+#endif
+        }
+
+        MissCounter(const MissCounter&) = delete;
+        MissCounter& operator=(const MissCounter&) = delete;
+
+        bool available() const
+        {
+#if defined(__linux__)
+            return _fd >= 0;
+#else
+            return false;
+#endif
+        }
+
+        void start()
+        {
+#if defined(__linux__)
+            if (_fd >= 0)
+            {
+                ioctl(_fd, PERF_EVENT_IOC_RESET, 0);
+                ioctl(_fd, PERF_EVENT_IOC_ENABLE, 0);
+            }
+#endif
+        }
+
+        std::uint64_t stop()
+        {
+            std::uint64_t count = 0;
+#if defined(__linux__)
+            if (_fd >= 0)
+            {
+                ioctl(_fd, PERF_EVENT_IOC_DISABLE, 0);
+                if (read(_fd, &count, sizeof(count)) != sizeof(count))
+                    count = 0;
+            }
+#endif
+            return count;
+        }
+    };
+
+    double peak_rss_mb()
+    {
+#if defined(_WIN32)
+        PROCESS_MEMORY_COUNTERS counters;
+        if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+            return 0;
+        return counters.PeakWorkingSetSize / (1024.0 * 1024.0);
+#else
+        rusage usage;
+        if (getrusage(RUSAGE_SELF, &usage) != 0)
+            return 0;
+#if defined(__APPLE__)
+        return usage.ru_maxrss / (1024.0 * 1024.0);
+#else
+        return usage.ru_maxrss / 1024.0;
+#endif
+#endif
+    }
+
+    MissCounter& misses()
+    {
+        static MissCounter counter;
+        return counter;
+    }
+
+    std::string g_filter;
+    // Folded into every result so the optimizer keeps the work.
+    volatile std::size_t g_sink;
+
+    // Times body(), which performs ops operations, and prints one row.
+    template<typename F>
+    void measure(const std::string& name, std::size_t size, std::size_t ops, F&& body)
+    {
+        misses().start();
+        auto start = std::chrono::steady_clock::now();
+        g_sink = g_sink + body();
+        std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+        std::uint64_t missed = misses().stop();
+
+        char miss_column[32] = "n/a";
+        if (misses().available())
+            std::snprintf(miss_column, sizeof(miss_column), "%.2f", static_cast<double>(missed) / ops);
+        std::printf("%-40s %11zu %10.1f %12s %10.1f\n",
+            name.c_str(), size, elapsed.count() / ops, miss_column, peak_rss_mb());
+        std::fflush(stdout);
+    }
+
+    template<typename Set>
+    bool has(const Set& set, const typename Set::key_type& key)
+    {
+        return set.find(key) != set.end();
+    }
+
+    template<typename Set>
+    Set load(const std::vector<typename Set::key_type>& keys, std::size_t n)
+    {
+        Set set;
+        for (std::size_t i = 0; i < n; ++i)
+            set.insert(keys[i]);
+        return set;
+    }
+
+    template<typename Set>
+    void run(const char* key_name, const char* backend, const std::vector<typename Set::key_type>& keys, std::size_t n)
+    {
+        std::size_t ops = std::min(std::max(n, MIN_OPS), MAX_OPS);
+        auto selected = [&](const char* workload) {
+            std::string name = std::string(workload) + "/" + key_name + "/" + backend;
+            return name.find(g_filter) != std::string::npos ? name : std::string();
+        };
+        std::string name;
+
+        if (!(name = selected("insert")).empty())
+            measure(name, n, n, [&] { return load<Set>(keys, n).size(); });
+
+        if (!(name = selected("insert_reserved")).empty())
+            measure(name, n, n, [&] {
+                Set set;
+                set.reserve(n);
+                for (std::size_t i = 0; i < n; ++i)
+                    set.insert(keys[i]);
+                return set.size();
+            });
+
+        Set set = load<Set>(keys, n);
+        std::mt19937_64 rng(n);
+        std::vector<std::size_t> hits(ops), missing(ops);
+        for (std::size_t i = 0; i < ops; ++i)
+        {
+            hits[i] = rng() % n;
+            missing[i] = n + rng() % n;
+        }
+
+        if (!(name = selected("find_hit")).empty())
+            measure(name, n, ops, [&] {
+                std::size_t found = 0;
+                for (std::size_t i : hits)
+                    found += has(set, keys[i]);
+                return found;
+            });
+
+        if (!(name = selected("find_miss")).empty())
+            measure(name, n, ops, [&] {
+                std::size_t found = 0;
+                for (std::size_t i : missing)
+                    found += has(set, keys[i]);
+                return found;
+            });
+
+        if (!(name = selected("iterate")).empty())
+            measure(name, n, n, [&] {
+                std::size_t visited = 0;
+                for (auto it = set.begin(); it != set.end(); ++it)
+                    ++visited;
+                return visited;
+            });
+
+        if (!(name = selected("copy")).empty())
+            measure(name, n, n, [&] {
+                Set copy(set);
+                return copy.size();
+            });
+
+        // Destruction alone: trivially destructible keys are not visited, and
+        // a pool drops its nodes in one go.
+        if (!(name = selected("destroy")).empty())
+        {
+            auto copy = std::make_unique<Set>(set);
+            measure(name, n, n, [&] {
+                copy.reset();
+                return std::size_t(0);
+            });
+        }
+
+        if (!(name = selected("clear")).empty())
+        {
+            Set copy(set);
+            measure(name, n, n, [&] {
+                copy.clear();
+                return copy.size();
+            });
+        }
+
+        if (!(name = selected("rehash")).empty())
+        {
+            Set copy(set);
+            measure(name, n, n, [&] {
+                copy.rehash(copy.bucket_count() * 2);
+                return copy.bucket_count();
+            });
+        }
+
+        // Erase one loaded key and insert one missing key, so the size holds.
+        if (!(name = selected("churn")).empty())
+        {
+            Set copy(set);
+            std::vector<std::size_t> slots(2 * n);
+            for (std::size_t i = 0; i < 2 * n; ++i)
+                slots[i] = i;
+            measure(name, n, ops, [&] {
+                std::size_t changed = 0;
+                for (std::size_t i = 0; i < ops; ++i)
+                {
+                    std::size_t out = hits[i] % n;
+                    std::size_t in = n + missing[i] % n;
+                    changed += copy.erase(keys[slots[out]]);
+                    copy.insert(keys[slots[in]]);
+                    std::swap(slots[out], slots[in]);
+                }
+                return changed;
+            });
+        }
+
+        // 80% find, 10% insert, 10% erase over all 2n keys.
+        for (bool zipf : { false, true })
+        {
+            if ((name = selected(zipf ? "mixed_zipf" : "mixed_uniform")).empty())
+                continue;
+            KeyChooser chooser(2 * n, zipf, n);
+            std::vector<std::uint32_t> picks(ops);
+            std::vector<std::size_t> ranks(ops);
+            for (std::size_t i = 0; i < ops; ++i)
+            {
+                picks[i] = static_cast<std::uint32_t>(rng() % 10);
+                ranks[i] = chooser.next();
+            }
+            Set copy(set);
+            measure(name, n, ops, [&] {
+                std::size_t result = 0;
+                for (std::size_t i = 0; i < ops; ++i)
+                {
+                    const auto& key = keys[ranks[i]];
+                    if (picks[i] == 0)
+                        result += copy.insert(key).second;
+                    else if (picks[i] == 1)
+                        result += copy.erase(key);
+                    else
+                        result += has(copy, key);
+                }
+                return result;
+            });
+        }
+    }
+
+    template<typename Key, typename Hash>
+    void run_key(const char* key_name, std::size_t n)
+    {
+        using Std = std::unordered_set<Key, Hash>;
+        using Chained = Unordered_Set<Key, Hash>;
+        using Pooled = Unordered_Set<Key, Hash, std::equal_to<Key>, PoolAllocator<Key>>;
+        using Flat = Unordered_Set<Key, Hash, std::equal_to<Key>, std::allocator<Key>, FlatStorage>;
+        using Dense = Unordered_Set<Key, Hash, std::equal_to<Key>, std::allocator<Key>, DenseStorage>;
+        using SmallDense = Unordered_Set<Key, Hash, std::equal_to<Key>, std::allocator<Key>, SmallStorage<4, DenseStorage>>;
+
+        std::vector<Key> keys = make_keys<Key>(n);
+        run<Std>(key_name, "std", keys, n);
+        run<Chained>(key_name, "chained", keys, n);
+        run<Pooled>(key_name, "chained_pool", keys, n);
+        run<Flat>(key_name, "flat", keys, n);
+        run<Dense>(key_name, "dense", keys, n);
+        run<SmallDense>(key_name, "small_dense", keys, n);
+    }
+
+    std::vector<std::size_t> parse_sizes(const char* list)
+    {
+        std::vector<std::size_t> sizes;
+        while (*list)
+        {
+            char* end = nullptr;
+            unsigned long long size = std::strtoull(list, &end, 10);
+            if (end == list)
+                break;
+            if (size > 0)
+                sizes.push_back(static_cast<std::size_t>(size));
+            list = *end == ',' ? end + 1 : end;
+        }
+        return sizes;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    std::vector<std::size_t> sizes = { 1000, 100000, 1000000 };
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strncmp(argv[i], "--sizes=", 8) == 0)
+            sizes = parse_sizes(argv[i] + 8);
+        else if (std::strncmp(argv[i], "--filter=", 9) == 0)
+            g_filter = argv[i] + 9;
+        else
+        {
+            std::fprintf(stderr, "usage: %s [--sizes=N,N,...] [--filter=text]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    std::printf("%-40s %11s %10s %12s %10s\n", "workload/key/backend", "size", "ns/op", "misses/op", "peak MB");
+    for (std::size_t n : sizes)
+    {
+        run_key<std::uint64_t, std::hash<std::uint64_t>>("u64", n);
+        run_key<std::string, std::hash<std::string>>("string", n);
+        run_key<Blob, BlobHash>("blob64", n);
+    }
+    return 0;
+}
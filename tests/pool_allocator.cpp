@@ -0,0 +1,146 @@
+// Checks that HashTable only drops a PoolAllocator's pool in bulk while the
+// pool holds nothing but the table's nodes. Build with sanitizers, e.g.
+//   g++ -std=c++17 -g -fsanitize=address,undefined -I.. pool_allocator.cpp -o pool_allocator
+// and run ./pool_allocator; it prints each failed check and exits with 1.
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <string>
+
+#include "Unordered_Set.h"
+
+namespace
+{
+    int g_failures = 0;
+
+    void check(bool ok, const char* what)
+    {
+        if (!ok)
+        {
+            std::printf("FAILED: %s\n", what);
+            ++g_failures;
+        }
+    }
+
+    // Too large for a pool block, so its nodes come from ::operator new.
+    struct Key300
+    {
+        int id;
+        char pad[300];
+
+        bool operator==(const Key300& other) const { return id == other.id; }
+    };
+
+    struct Key300Hash
+    {
+        std::size_t operator()(const Key300& key) const { return std::hash<int>()(key.id); }
+    };
+
+    Key300 key300(int id)
+    {
+        Key300 key;
+        key.id = id;
+        std::memset(key.pad, 0, sizeof(key.pad));
+        return key;
+    }
+
+    // A table of up to 64 buckets has a one-word occupancy bitmap, which
+    // must not be a pool block freed along with the nodes.
+    void small_bitmap()
+    {
+        Unordered_Set<int, std::hash<int>, std::equal_to<int>, PoolAllocator<int>> set(1);
+        set.insert(1);
+        set.clear();
+        check(set.empty(), "small_bitmap: clear empties the set");
+        set.insert(2);
+        check(set.count(2) == 1 && set.size() == 1, "small_bitmap: set is usable after clear");
+        check(set.get_allocator().allocated_blocks() == 1, "small_bitmap: only the node is a pool block");
+    }
+
+    void large_nodes()
+    {
+        using Set = Unordered_Set<Key300, Key300Hash, std::equal_to<Key300>, PoolAllocator<Key300>>;
+        Set set;
+        set.insert(key300(1));
+        set.clear();
+        check(set.empty(), "large_nodes: clear empties the set");
+        for (int i = 0; i < 100; ++i)
+            set.insert(key300(i));
+        check(set.size() == 100 && set.count(key300(42)) == 1, "large_nodes: set is usable after clear");
+    }
+
+    // Two sets on one pool: clearing or destroying one must leave the
+    // other's nodes alone.
+    void shared_pool()
+    {
+        using Set = Unordered_Set<std::string, std::hash<std::string>, std::equal_to<std::string>, PoolAllocator<std::string>>;
+        PoolAllocator<std::string> alloc;
+        Set keep(16, std::hash<std::string>(), std::equal_to<std::string>(), alloc);
+        for (int i = 0; i < 100; ++i)
+            keep.insert("keep" + std::to_string(i));
+        {
+            Set other(16, std::hash<std::string>(), std::equal_to<std::string>(), alloc);
+            other.insert("a");
+            other.clear();
+            other.insert("b");
+        }
+        bool all = keep.size() == 100;
+        for (int i = 0; i < 100; ++i)
+            all = all && keep.count("keep" + std::to_string(i)) == 1;
+        check(all, "shared_pool: the other set's nodes survive");
+    }
+
+    // Trivially destructible nodes skip clear() in the destructor; that
+    // must not free the chunks another set still uses, or leak large nodes.
+    void destroy_shared()
+    {
+        using Set = Unordered_Set<int, std::hash<int>, std::equal_to<int>, PoolAllocator<int>>;
+        PoolAllocator<int> alloc;
+        Set keep(16, std::hash<int>(), std::equal_to<int>(), alloc);
+        for (int i = 0; i < 100; ++i)
+            keep.insert(i);
+        {
+            Set other(16, std::hash<int>(), std::equal_to<int>(), alloc);
+            other.insert(-1);
+        }
+        bool all = keep.size() == 100;
+        for (int i = 0; i < 100; ++i)
+            all = all && keep.count(i) == 1;
+        check(all, "destroy_shared: the other set's nodes survive");
+
+        // One unpooled node against one pooled block of another set: the
+        // counts match although the pool holds none of the large set.
+        using Large = Unordered_Set<Key300, Key300Hash, std::equal_to<Key300>, PoolAllocator<Key300>>;
+        Set single(16, std::hash<int>(), std::equal_to<int>(), PoolAllocator<int>());
+        single.insert(7);
+        {
+            Large large(16, Key300Hash(), std::equal_to<Key300>(), PoolAllocator<Key300>(single.get_allocator()));
+            large.insert(key300(1));
+        }
+        single.insert(8);
+        check(single.count(7) == 1 && single.count(8) == 1, "destroy_shared: a large-node set leaves the pool alone");
+    }
+
+    // The bulk path is still taken when the pool holds only our nodes.
+    void exclusive_pool()
+    {
+        Unordered_Set<int, std::hash<int>, std::equal_to<int>, PoolAllocator<int>> set;
+        for (int i = 0; i < 1000; ++i)
+            set.insert(i);
+        std::size_t chunks = set.get_allocator().pool()->chunk_count();
+        set.clear();
+        check(chunks > 0 && set.get_allocator().pool()->chunk_count() == 0, "exclusive_pool: clear drops the whole pool");
+    }
+}
+
+int main()
+{
+    small_bitmap();
+    large_nodes();
+    shared_pool();
+    destroy_shared();
+    exclusive_pool();
+    if (g_failures == 0)
+        std::printf("pool_allocator: all checks passed\n");
+    return g_failures == 0 ? 0 : 1;
+}
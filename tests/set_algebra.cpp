@@ -0,0 +1,97 @@
+// Checks set_intersection, set_union, set_difference and is_subset on every
+// Storage backend: the results, and how often they call Hash. Build with
+// sanitizers, e.g.
+//   g++ -std=c++17 -g -fsanitize=address,undefined -I.. set_algebra.cpp -o set_algebra
+// and run ./set_algebra; it prints each failed check and exits with 1.
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <string>
+
+#include "Unordered_Set.h"
+
+namespace
+{
+    int g_failures = 0;
+
+    void check(bool ok, const char* backend, const char* what)
+    {
+        if (!ok)
+        {
+            std::printf("FAILED: %s: %s\n", backend, what);
+            ++g_failures;
+        }
+    }
+
+    struct CountingHash
+    {
+        static inline std::size_t calls = 0;
+
+        std::size_t operator()(const std::string& key) const
+        {
+            ++calls;
+            return std::hash<std::string>()(key);
+        }
+    };
+
+    template<typename Storage, typename Allocator = std::allocator<std::string>>
+    using Set = Unordered_Set<std::string, CountingHash, std::equal_to<std::string>, Allocator, Storage>;
+
+    // a holds [0, n) and b holds [n / 2, n + n / 2). cached says the backend
+    // keeps each key's hash, so no operation may call Hash; otherwise each
+    // may hash every key of both operands once.
+    template<typename S>
+    void run(const char* backend, int n, bool cached)
+    {
+        S a;
+        S b;
+        for (int i = 0; i < n; ++i)
+            a.insert(std::to_string(i));
+        for (int i = n / 2; i < n + n / 2; ++i)
+            b.insert(std::to_string(i));
+        std::size_t bound = cached ? 0 : a.size() + b.size();
+        std::size_t half = static_cast<std::size_t>(n / 2);
+
+        CountingHash::calls = 0;
+        S both = set_intersection(a, b);
+        check(CountingHash::calls <= bound, backend, "intersection calls Hash");
+        check(both.size() == n - half && both.contains(std::to_string(n - 1)) && !both.contains("0"),
+            backend, "intersection keeps the common keys");
+
+        CountingHash::calls = 0;
+        S either = set_union(a, b);
+        check(CountingHash::calls <= bound, backend, "union calls Hash");
+        check(either.size() == n + half && either.contains("0") && either.contains(std::to_string(n + half - 1)),
+            backend, "union keeps the keys of both");
+
+        CountingHash::calls = 0;
+        S only_a = set_difference(a, b);
+        check(CountingHash::calls <= bound, backend, "difference calls Hash");
+        check(only_a.size() == half && (half == 0 || only_a.contains("0")) && !only_a.contains(std::to_string(n - 1)),
+            backend, "difference keeps the keys only in a");
+
+        CountingHash::calls = 0;
+        bool subset = is_subset(both, b) && !is_subset(a, b);
+        check(CountingHash::calls <= bound, backend, "is_subset calls Hash");
+        check(subset, backend, "intersection is a subset, a is not");
+    }
+}
+
+int main()
+{
+    run<Set<ChainedStorage<>>>("chained", 1000, true);
+    run<Set<ChainedStorage<>, PoolAllocator<std::string>>>("chained_pool", 1000, true);
+    run<Set<FlatStorage>>("flat", 1000, false);
+    run<Set<DenseStorage>>("dense", 1000, true);
+    run<Set<SmallStorage<8>>>("small", 1000, true);
+    run<Set<SmallStorage<8, DenseStorage>>>("small_dense", 1000, true);
+
+    // Inline keys carry no hash, so a small set is only held to the bound
+    // once it has moved to its Large table.
+    run<Set<SmallStorage<8>>>("small inline", 6, false);
+    run<Set<SmallStorage<8, DenseStorage>>>("small_dense inline", 6, false);
+
+    if (g_failures == 0)
+        std::printf("set_algebra: all checks passed\n");
+    return g_failures == 0 ? 0 : 1;
+}